@@ -64,6 +64,10 @@ namespace ceph {
       return 0;
     }
 
+    ErasureCodeCapabilities get_capabilities() override {
+      return ErasureCodeCapabilities();
+    }
+
     int minimum_to_decode(const set<int> &want_to_read,
                                   const set<int> &available_chunks,
                                   set<int> *minimum) override;
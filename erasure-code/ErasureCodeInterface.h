@@ -168,6 +168,21 @@ namespace ceph {
   }
 
 
+  /**
+   * What an instance offers beyond whole chunk encode and decode.  It
+   * does not change once the instance is initialized: callers on hot
+   * paths query it once and keep a copy.
+   */
+  struct ErasureCodeCapabilities {
+    /// chunks are rows of w symbols of packetsize bytes, encoded with
+    /// a bitmatrix, and a lost chunk can be rebuilt from some symbols
+    bool symbol_recovery = false;
+    unsigned int w = 0;
+    int packetsize = 0;
+    int *bitmatrix = nullptr;               ///< m*w x k*w, owned by the instance
+    unsigned int max_symbol_failures = 0;   ///< lost chunks a symbol plan covers
+  };
+
   class ErasureCodeInterface {
   public:
     virtual ~ErasureCodeInterface() {}
@@ -255,6 +270,14 @@ namespace ceph {
  
     virtual int get_packetsize() = 0;//add by LYF
 
+    /**
+     * Return the capabilities of the instance. Only meaningful
+     * after a successful call to **init**.
+     *
+     * @return the capabilities of the instance
+     */
+    virtual ErasureCodeCapabilities get_capabilities() = 0;
+
     /**
      * Return the size (in bytes) of a single chunk created by a call
      * to the **decode** method. The returned size multiplied by
@@ -87,6 +87,35 @@ ErasureCodePlugin *ErasureCodePluginRegistry::get(const std::string &name)
     return 0;
 }
 
+std::string ErasureCodePluginRegistry::codec_key(const std::string &plugin,
+						const ErasureCodeProfile &profile)
+{
+  // the profile is sorted, and neither keys nor values contain a NUL
+  std::string key = plugin;
+  for (ErasureCodeProfile::const_iterator i = profile.begin();
+       i != profile.end();
+       ++i) {
+    key += '\0';
+    key += i->first;
+    key += '=';
+    key += i->second;
+  }
+  return key;
+}
+
+ErasureCodeInterfaceRef ErasureCodePluginRegistry::get_codec(const std::string &key)
+{
+  assert(lock.is_locked());
+  std::map<std::string,std::weak_ptr<ErasureCodeInterface> >::iterator i =
+    codecs.find(key);
+  if (i == codecs.end())
+    return ErasureCodeInterfaceRef();
+  ErasureCodeInterfaceRef codec = i->second.lock();
+  if (!codec)
+    codecs.erase(i);
+  return codec;
+}
+
 int ErasureCodePluginRegistry::factory(const std::string &plugin_name,
 				       const std::string &directory,
 				       ErasureCodeProfile &profile,
@@ -94,8 +123,15 @@ int ErasureCodePluginRegistry::factory(const std::string &plugin_name,
 				       ostream *ss)
 {
   ErasureCodePlugin *plugin;
+  const std::string requested = codec_key(plugin_name, profile);
   {
     Mutex::Locker l(lock);
+    ErasureCodeInterfaceRef codec = get_codec(requested);
+    if (codec) {
+      profile = codec->get_profile();
+      *erasure_code = codec;
+      return 0;
+    }
     plugin = get(plugin_name);
     if (plugin == 0) {
       loading = true;
@@ -114,6 +150,26 @@ int ErasureCodePluginRegistry::factory(const std::string &plugin_name,
 	<< (*erasure_code)->get_profile() << std::endl;
     return -EINVAL;
   }
+
+  // the codec was built without the lock held, another caller may have
+  // built the same one meanwhile: keep theirs
+  const std::string normalized = codec_key(plugin_name, profile);
+  Mutex::Locker l(lock);
+  ErasureCodeInterfaceRef codec = get_codec(normalized);
+  if (codec)
+    *erasure_code = codec;
+  else
+    codecs[normalized] = *erasure_code;
+  codecs[requested] = *erasure_code;
+  // forget the codecs nobody uses any more
+  for (std::map<std::string,std::weak_ptr<ErasureCodeInterface> >::iterator i =
+	 codecs.begin();
+       i != codecs.end();) {
+    if (i->second.expired())
+      codecs.erase(i++);
+    else
+      ++i;
+  }
   return 0;
 }
 
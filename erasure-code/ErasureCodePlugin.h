@@ -48,6 +48,12 @@ namespace ceph {
     bool loading;
     bool disable_dlclose;
     std::map<std::string,ErasureCodePlugin*> plugins;
+    /// codecs built by factory(), by plugin and profile.  A codec does
+    /// not change once init() returned, so every caller asking for the
+    /// same profile, e.g. the PGs of a pool, shares one instance and the
+    /// matrices, schedules and caches it holds.  Held weakly, a codec
+    /// goes away with its last user
+    std::map<std::string,std::weak_ptr<ErasureCodeInterface> > codecs;
 
     static ErasureCodePluginRegistry singleton;
 
@@ -58,12 +64,22 @@ namespace ceph {
       return singleton;
     }
 
+    /**
+     * Return the codec of plugin for profile, normalized like the
+     * plugin factory does.  The codec may be shared with other
+     * callers of the same plugin and profile, which call it
+     * concurrently: it must not be init()ed again.
+     */
     int factory(const std::string &plugin,
 		const std::string &directory,
 		ErasureCodeProfile &profile,
 		ErasureCodeInterfaceRef *erasure_code,
 		ostream *ss);
 
+    static std::string codec_key(const std::string &plugin,
+				 const ErasureCodeProfile &profile);
+    ErasureCodeInterfaceRef get_codec(const std::string &key);
+
     int add(const std::string &name, ErasureCodePlugin *plugin);
     int remove(const std::string &name);
     ErasureCodePlugin *get(const std::string &name);
@@ -14,6 +14,9 @@
 #include "xor_op.h"
 #include <stdio.h>
 #include "arch/intel.h"
+#ifdef EC_ISA_VECTOR_AVX
+#include <immintrin.h>
+#endif
 // -----------------------------------------------------------------------------
 
 
@@ -46,6 +49,49 @@ vector_xor(vector_op_t* cw,
 }
 
 
+// -----------------------------------------------------------------------------
+
+static void
+// -----------------------------------------------------------------------------
+region_byte_xor(unsigned char** src,
+                unsigned char* parity,
+                int src_size,
+                unsigned offset,
+                unsigned size)
+// -----------------------------------------------------------------------------
+{
+  // ---------------------------------------------------------
+  // parity[offset, offset + size) with byte-wise region xor,
+  // src[0] may be parity itself
+  // ---------------------------------------------------------
+  if (!size) {
+    return;
+  }
+  memmove(parity + offset, src[0] + offset, size);
+  for (int i = 1; i < src_size; i++) {
+    byte_xor(src[i] + offset, parity + offset, src[i] + offset + size);
+  }
+}
+
+#ifdef EC_ISA_VECTOR_AVX
+// -----------------------------------------------------------------------------
+
+static unsigned
+// -----------------------------------------------------------------------------
+region_avx_width()
+// -----------------------------------------------------------------------------
+{
+  // ---------------------------------------------------------
+  // vector size of the widest region xor the CPU (and the OS,
+  // which must save the registers) supports, 0 if none
+  // ---------------------------------------------------------
+  static const unsigned width =
+    __builtin_cpu_supports("avx512f") ? 64 :
+    __builtin_cpu_supports("avx2") ? 32 : 0;
+  return width;
+}
+#endif
+
 // -----------------------------------------------------------------------------
 
 void
@@ -53,7 +99,8 @@ void
 region_xor(unsigned char** src,
            unsigned char* parity,
            int src_size,
-           unsigned size)
+           unsigned size,
+           bool stream)
 {
   if (!size) {
     // nothing to do
@@ -71,6 +118,22 @@ region_xor(unsigned char** src,
     return;
   }
 
+#ifdef EC_ISA_VECTOR_AVX
+  // ----------------------------------------------------------
+  // AVX-512/AVX2 region xor take care of alignment themselves
+  // ----------------------------------------------------------
+  switch (region_avx_width()) {
+  case 64:
+    region_avx512_xor((char**) src, (char*) parity, src_size, size,
+                      stream && size >= EC_ISA_STREAM_MIN_SIZE);
+    return;
+  case 32:
+    region_avx2_xor((char**) src, (char*) parity, src_size, size,
+                    stream && size >= EC_ISA_STREAM_MIN_SIZE);
+    return;
+  }
+#endif
+
   unsigned size_left = size;
 
   // ----------------------------------------------------------
@@ -95,7 +158,8 @@ region_xor(unsigned char** src,
 
       size_left -= region_size;
       // 64-byte region xor
-      region_sse2_xor((char**) src, (char*) parity, src_size, region_size);
+      region_sse2_xor((char**) src, (char*) parity, src_size, region_size,
+                      stream && size >= EC_ISA_STREAM_MIN_SIZE);
     } else
 #endif
     {
@@ -116,15 +180,10 @@ region_xor(unsigned char** src,
     }
   }
 
-  if (size_left) {
-    // --------------------------------------------------
-    // xor the not aligned part with byte-wise region xor
-    // --------------------------------------------------
-    memcpy(parity + size - size_left, src[0] + size - size_left, size_left);
-    for (int i = 1; i < src_size; i++) {
-      byte_xor(src[i] + size - size_left, parity + size - size_left, src[i] + size);
-    }
-  }
+  // --------------------------------------------------
+  // xor the not aligned part with byte-wise region xor
+  // --------------------------------------------------
+  region_byte_xor(src, parity, src_size, size - size_left, size_left);
 }
 
 // -----------------------------------------------------------------------------
@@ -134,7 +193,8 @@ void
 region_sse2_xor(char** src,
                 char* parity,
                 int src_size,
-                unsigned size)
+                unsigned size,
+                bool stream)
 // -----------------------------------------------------------------------------
 {
 #ifdef __x86_64__
@@ -167,13 +227,225 @@ region_sse2_xor(char** src,
       asm volatile("pxor %xmm6,%xmm2");
       asm volatile("pxor %xmm7,%xmm3");
     }
-    asm volatile("movntdq %%xmm0,%0" : "=m" (p[i]));
-    asm volatile("movntdq %%xmm1,%0" : "=m" (p[i + 16]));
-    asm volatile("movntdq %%xmm2,%0" : "=m" (p[i + 32]));
-    asm volatile("movntdq %%xmm3,%0" : "=m" (p[i + 48]));
+    if (stream) {
+      asm volatile("movntdq %%xmm0,%0" : "=m" (p[i]));
+      asm volatile("movntdq %%xmm1,%0" : "=m" (p[i + 16]));
+      asm volatile("movntdq %%xmm2,%0" : "=m" (p[i + 32]));
+      asm volatile("movntdq %%xmm3,%0" : "=m" (p[i + 48]));
+    } else {
+      asm volatile("movdqa %%xmm0,%0" : "=m" (p[i]));
+      asm volatile("movdqa %%xmm1,%0" : "=m" (p[i + 16]));
+      asm volatile("movdqa %%xmm2,%0" : "=m" (p[i + 32]));
+      asm volatile("movdqa %%xmm3,%0" : "=m" (p[i + 48]));
+    }
   }
 
-  asm volatile("sfence" : : : "memory");
+  if (stream)
+    asm volatile("sfence" : : : "memory");
 #endif // __x86_64__
   return;
 }
+
+#ifdef EC_ISA_VECTOR_AVX
+// -----------------------------------------------------------------------------
+// one pass of the AVX2/AVX-512 region xor: parity = src[0] ^ ... ^ src[N-1]
+// with the source loop unrolled, parity is aligned to the vector size and
+// size is a multiple of it, sources may be unaligned
+// -----------------------------------------------------------------------------
+typedef void (*region_xor_pass_t)(unsigned char** src, int src_size,
+                                  unsigned char* parity, unsigned size,
+                                  bool stream);
+
+template <int N>
+__attribute__((target("avx2")))
+static void
+region_avx2_xor_pass(unsigned char** src,
+                     unsigned char* parity,
+                     unsigned size,
+                     bool stream)
+{
+  unsigned char* s[N];
+  for (int d = 0; d < N; d++) {
+    s[d] = src[d];
+  }
+  unsigned i = 0;
+  for (; i + 64 <= size; i += 64) {
+    __m256i x0 = _mm256_loadu_si256((const __m256i*) (s[0] + i));
+    __m256i x1 = _mm256_loadu_si256((const __m256i*) (s[0] + i + 32));
+    for (int d = 1; d < N; d++) {
+      x0 = _mm256_xor_si256(x0, _mm256_loadu_si256((const __m256i*) (s[d] + i)));
+      x1 = _mm256_xor_si256(x1, _mm256_loadu_si256((const __m256i*) (s[d] + i + 32)));
+    }
+    if (stream) {
+      _mm256_stream_si256((__m256i*) (parity + i), x0);
+      _mm256_stream_si256((__m256i*) (parity + i + 32), x1);
+    } else {
+      _mm256_store_si256((__m256i*) (parity + i), x0);
+      _mm256_store_si256((__m256i*) (parity + i + 32), x1);
+    }
+  }
+  if (i < size) {
+    __m256i x0 = _mm256_loadu_si256((const __m256i*) (s[0] + i));
+    for (int d = 1; d < N; d++) {
+      x0 = _mm256_xor_si256(x0, _mm256_loadu_si256((const __m256i*) (s[d] + i)));
+    }
+    if (stream) {
+      _mm256_stream_si256((__m256i*) (parity + i), x0);
+    } else {
+      _mm256_store_si256((__m256i*) (parity + i), x0);
+    }
+  }
+}
+
+template <int N>
+__attribute__((target("avx512f")))
+static void
+region_avx512_xor_pass(unsigned char** src,
+                       unsigned char* parity,
+                       unsigned size,
+                       bool stream)
+{
+  unsigned char* s[N];
+  for (int d = 0; d < N; d++) {
+    s[d] = src[d];
+  }
+  unsigned i = 0;
+  for (; i + 128 <= size; i += 128) {
+    __m512i x0 = _mm512_loadu_si512(s[0] + i);
+    __m512i x1 = _mm512_loadu_si512(s[0] + i + 64);
+    for (int d = 1; d < N; d++) {
+      x0 = _mm512_xor_si512(x0, _mm512_loadu_si512(s[d] + i));
+      x1 = _mm512_xor_si512(x1, _mm512_loadu_si512(s[d] + i + 64));
+    }
+    if (stream) {
+      _mm512_stream_si512((__m512i*) (parity + i), x0);
+      _mm512_stream_si512((__m512i*) (parity + i + 64), x1);
+    } else {
+      _mm512_store_si512(parity + i, x0);
+      _mm512_store_si512(parity + i + 64, x1);
+    }
+  }
+  if (i < size) {
+    __m512i x0 = _mm512_loadu_si512(s[0] + i);
+    for (int d = 1; d < N; d++) {
+      x0 = _mm512_xor_si512(x0, _mm512_loadu_si512(s[d] + i));
+    }
+    if (stream) {
+      _mm512_stream_si512((__m512i*) (parity + i), x0);
+    } else {
+      _mm512_store_si512(parity + i, x0);
+    }
+  }
+}
+
+#define EC_ISA_XOR_PASS_DISPATCH(PASS)                                  \
+  static void                                                           \
+  PASS(unsigned char** src, int src_size, unsigned char* parity,        \
+       unsigned size, bool stream)                                      \
+  {                                                                     \
+    switch (src_size) {                                                 \
+    case 1: PASS<1>(src, parity, size, stream); break;                  \
+    case 2: PASS<2>(src, parity, size, stream); break;                  \
+    case 3: PASS<3>(src, parity, size, stream); break;                  \
+    case 4: PASS<4>(src, parity, size, stream); break;                  \
+    case 5: PASS<5>(src, parity, size, stream); break;                  \
+    case 6: PASS<6>(src, parity, size, stream); break;                  \
+    case 7: PASS<7>(src, parity, size, stream); break;                  \
+    default: PASS<8>(src, parity, size, stream); break;                 \
+    }                                                                   \
+  }
+
+EC_ISA_XOR_PASS_DISPATCH(region_avx2_xor_pass)
+EC_ISA_XOR_PASS_DISPATCH(region_avx512_xor_pass)
+#undef EC_ISA_XOR_PASS_DISPATCH
+
+// -----------------------------------------------------------------------------
+
+static void
+// -----------------------------------------------------------------------------
+region_wide_xor(region_xor_pass_t pass,
+                unsigned width,
+                char** src,
+                char* parity,
+                int src_size,
+                unsigned size,
+                bool stream)
+// -----------------------------------------------------------------------------
+{
+  unsigned char** s = (unsigned char**) src;
+  unsigned char* p = (unsigned char*) parity;
+
+  // ------------------------------------------------------------
+  // bytes up to the first aligned parity vector, then the vectors
+  // ------------------------------------------------------------
+  unsigned head = (width - (uintptr_t) p % width) % width;
+  if (head > size) {
+    head = size;
+  }
+  unsigned end = head + (size - head) / width * width;
+  region_byte_xor(s, p, src_size, 0, head);
+
+  // ------------------------------------------------------------
+  // with more sources than one pass takes, go block by block and
+  // add the passes up in an L1 buffer: only the last pass of a
+  // block writes (or streams) the parity, which is never re-read
+  // ------------------------------------------------------------
+  unsigned block = src_size <= EC_ISA_XOR_PASS_SOURCES ?
+    end - head : EC_ISA_XOR_BLOCK_SIZE;
+  unsigned char partial[EC_ISA_XOR_BLOCK_SIZE] __attribute__((aligned(64)));
+  unsigned char* from[EC_ISA_XOR_PASS_SOURCES];
+  for (unsigned offset = head; offset < end; offset += block) {
+    unsigned length = end - offset < block ? end - offset : block;
+    int d = 0;
+    while (d < src_size) {
+      int n = 0;
+      if (d) {
+        from[n++] = partial;
+      }
+      while (n < EC_ISA_XOR_PASS_SOURCES && d < src_size) {
+        from[n++] = s[d++] + offset;
+      }
+      if (d == src_size) {
+        pass(from, n, p + offset, length, stream);
+      } else {
+        pass(from, n, partial, length, false);
+      }
+    }
+  }
+  if (stream && end > head) {
+    asm volatile("sfence" : : : "memory");
+  }
+
+  region_byte_xor(s, p, src_size, end, size - end);
+}
+
+// -----------------------------------------------------------------------------
+
+void
+// -----------------------------------------------------------------------------
+region_avx2_xor(char** src,
+                char* parity,
+                int src_size,
+                unsigned size,
+                bool stream)
+// -----------------------------------------------------------------------------
+{
+  region_wide_xor(region_avx2_xor_pass, 32, src, parity, src_size, size,
+                  stream);
+}
+
+// -----------------------------------------------------------------------------
+
+void
+// -----------------------------------------------------------------------------
+region_avx512_xor(char** src,
+                  char* parity,
+                  int src_size,
+                  unsigned size,
+                  bool stream)
+// -----------------------------------------------------------------------------
+{
+  region_wide_xor(region_avx512_xor_pass, 64, src, parity, src_size, size,
+                  stream);
+}
+#endif // EC_ISA_VECTOR_AVX
@@ -28,6 +28,23 @@
 
 #define EC_ISA_ADDRESS_ALIGNMENT 32u
 #define EC_ISA_VECTOR_SSE2_WORDSIZE 64u
+// smallest region written with non-temporal stores in streaming mode,
+// the min_stream_packetsize of the jerasure schedule kernels
+#define EC_ISA_STREAM_MIN_SIZE 1024u
+// sources combined per pass by the AVX2/AVX-512 region xor
+#define EC_ISA_XOR_PASS_SOURCES 8
+// bytes done with all passes before moving on, the parity stays in L1
+#define EC_ISA_XOR_BLOCK_SIZE 4096u
+
+// -------------------------------------------------------------------------
+// AVX2/AVX-512 region xor use per-function target attributes, they only
+// need a compiler that knows the instructions and are picked at runtime
+// -------------------------------------------------------------------------
+#if defined(__x86_64__) && \
+  ((defined(__clang__) && __clang_major__ >= 4) || \
+   (!defined(__clang__) && __GNUC__ >= 5))
+#define EC_ISA_VECTOR_AVX 1
+#endif
 
 #if __GNUC__ > 4 || \
   ( (__GNUC__ == 4) && (__GNUC_MINOR__ >= 4) ) ||\
@@ -70,9 +87,12 @@ vector_xor(vector_op_t* cw, vector_op_t* dw, vector_op_t* ew);
 
 // -------------------------------------------------------------------------
 // compute region XOR like parity = src[0] ^ src[1] ... ^ src[src_size-]
+// if stream is set and the region is at least EC_ISA_STREAM_MIN_SIZE,
+// parity is written around the cache because nobody reads it back soon
 // -------------------------------------------------------------------------
 void
-region_xor(unsigned char** src, unsigned char* parity, int src_size, unsigned size);
+region_xor(unsigned char** src, unsigned char* parity, int src_size, unsigned size,
+           bool stream = false);
 
 // -------------------------------------------------------------------------
 // compute region XOR like parity = src[0] ^ src[1] ... ^ src[src_size-]
@@ -82,7 +102,25 @@ void
 region_sse2_xor(char** src /* array of 64-byte aligned source pointer to xor */,
                 char* parity /* 64-byte aligned output pointer containing the parity */,
                 int src_size /* size of the source pointer array */,
-                unsigned size /* size of the region to xor */);
+                unsigned size /* size of the region to xor */,
+                bool stream /* use non-temporal stores for parity */);
+
+#ifdef EC_ISA_VECTOR_AVX
+// -------------------------------------------------------------------------
+// compute region XOR like parity = src[0] ^ src[1] ... ^ src[src_size-]
+// using 256-bit (AVX2) or 512-bit (AVX-512F) operations, combining up to
+// EC_ISA_XOR_PASS_SOURCES sources per pass. Pointers and size need no
+// alignment: the unaligned head and tail of parity are done bytewise.
+// The caller checks that the CPU supports the instructions.
+// -------------------------------------------------------------------------
+void
+region_avx2_xor(char** src, char* parity, int src_size, unsigned size,
+                bool stream);
+
+void
+region_avx512_xor(char** src, char* parity, int src_size, unsigned size,
+                  bool stream);
+#endif
 
 
 #endif // EC_ISA_XOR_OP_H
@@ -17,6 +17,7 @@
 
 #include "common/debug.h"
 #include "ErasureCodeJerasure.h"
+#include "ErasureCodeJerasureKernel.h"
 #include "crush/CrushWrapper.h"
 #include "osd/osd_types.h"
 extern "C" {
@@ -246,6 +247,22 @@ int ErasureCodeJerasure::get_packetsize()
   return get_symbol_size();//add by LYF
 }
 
+ErasureCodeCapabilities ErasureCodeJerasure::get_capabilities()
+{
+  ErasureCodeCapabilities caps;
+  caps.w = w;
+  caps.packetsize = get_packetsize();
+  caps.bitmatrix = get_bitmatrix();
+  // the reed_sol techniques return a GF(2^w) matrix, there are no
+  // symbols to choose from; cauchy_orig and liberation are not planned
+  const string t(technique);
+  caps.symbol_recovery = caps.bitmatrix && caps.packetsize > 0 && w > 0 &&
+    (t == "cauchy_good" || t == "liber8tion" || t == "blaum_roth");
+  // a plan rebuilds a single data chunk
+  caps.max_symbol_failures = caps.symbol_recovery ? 1 : 0;
+  return caps;
+}
+
 bool ErasureCodeJerasure::is_prime(int value)
 {
   int prime55[] = {
@@ -261,6 +278,122 @@ bool ErasureCodeJerasure::is_prime(int value)
   return false;
 }
 
+jerasure_flat_schedule *ErasureCodeJerasure::smart_flat_schedule(int *bitmatrix,
+								int packetsize)
+{
+  int **smart = jerasure_smart_bitmatrix_to_schedule(k, m, w, bitmatrix);
+  jerasure_flat_schedule *flat = jerasure_schedule_to_flat(smart, packetsize);
+  jerasure_free_schedule(smart);
+  return flat;
+}
+
+int ErasureCodeJerasure::schedule_decode(int *bitmatrix,
+					 int packetsize,
+					 int *erasures,
+					 char **data,
+					 char **coding,
+					 int blocksize)
+{
+  if (!schedule_cache)
+    return jerasure_schedule_decode_lazy(k, m, w, bitmatrix, erasures,
+					 data, coding, blocksize, packetsize, 1);
+  ErasureCodeJerasureScheduleCache::schedule_ref schedule =
+    schedule_cache->get_decoding_schedule(
+      ErasureCodeJerasureScheduleCache::profile_key(get_schedule_technique(),
+						    k, m, w, packetsize),
+      k, m, w, packetsize, bitmatrix, erasures);
+  if (!schedule)
+    return -1;
+  return jerasure_flat_schedule_decode(k, m, w, schedule->get(),
+				       erasures, data, coding, blocksize,
+				       kernel_flags);
+}
+
+int ErasureCodeJerasure::parse_xor_engine(ErasureCodeProfile &profile,
+					  ostream *ss)
+{
+  int err = to_string("jerasure-xor-engine", profile, &xor_engine, "auto", ss);
+  if (xor_engine != "auto" && xor_engine != "jerasure" && xor_engine != "isa") {
+    *ss << "jerasure-xor-engine=" << xor_engine
+	<< " must be one of auto, jerasure or isa" << std::endl;
+    xor_engine = "auto";
+    return -EINVAL;
+  }
+  // the profile is shared by every OSD of the pool, some of which may
+  // have been built without the isa plugin
+  if (xor_engine == "isa" && !ErasureCodeJerasureKernel::have_isa_xor())
+    *ss << "jerasure-xor-engine=isa is not available in this build,"
+	<< " using jerasure" << std::endl;
+  return err;
+}
+
+void ErasureCodeJerasure::prepare_xor_engine(jerasure_flat_schedule *schedule)
+{
+  if (xor_engine == "jerasure" || !ErasureCodeJerasureKernel::have_isa_xor())
+    kernel_flags = 0;
+  else if (xor_engine == "isa")
+    kernel_flags = ErasureCodeJerasureKernel::isa_xor;
+  else
+    kernel_flags = ErasureCodeJerasureKernel::choose_xor_flags(k, m, w, schedule);
+  dout(10) << __func__ << " technique=" << technique << " k=" << k
+	   << " m=" << m << " w=" << w << " xor engine "
+	   << (kernel_flags & ErasureCodeJerasureKernel::isa_xor ? "isa" : "jerasure")
+	   << dendl;
+}
+
+int ErasureCodeJerasure::parse_packetsize_autotune(ErasureCodeProfile &profile,
+						   bool *autotune,
+						   ostream *ss)
+{
+  int err = to_bool("jerasure-packetsize-autotune", profile, autotune,
+		    "false", ss);
+  // a packetsize set by the operator, or by a previous autotune, is kept
+  ErasureCodeProfile::const_iterator p = profile.find("packetsize");
+  if (p != profile.end() && p->second.size() > 0) {
+    *autotune = false;
+  } else if (*autotune && !creates_profile) {
+    // tuning here would pick a packetsize for this host only.  The
+    // profile may come from a monitor that does not know the key, and
+    // failing would fail the PG: it is a hint, use the default
+    *ss << "jerasure-packetsize-autotune=true but the profile has no"
+	<< " packetsize: it is tuned where the profile is created, using "
+	<< DEFAULT_PACKETSIZE << std::endl;
+    dout(0) << __func__ << " jerasure-packetsize-autotune=true without a"
+	    << " packetsize, using " << DEFAULT_PACKETSIZE << dendl;
+    *autotune = false;
+  }
+  return err;
+}
+
+int ErasureCodeJerasure::autotune_packetsize(ErasureCodeProfile &profile,
+					     int *packetsize,
+					     ostream *ss)
+{
+  int *bitmatrix = coding_bitmatrix();
+  if (!bitmatrix) {
+    *ss << "jerasure-packetsize-autotune: no bitmatrix for technique="
+	<< technique << " k=" << k << " m=" << m << " w=" << w << std::endl;
+    return -EINVAL;
+  }
+  int r;
+  if (packetsize_tuner)
+    r = packetsize_tuner->get_packetsize(get_schedule_technique(),
+					 k, m, w, bitmatrix);
+  else
+    r = ErasureCodeJerasurePacketsizeTuner::tune(k, m, w, bitmatrix);
+  free(bitmatrix);
+  if (r < 0) {
+    *ss << "jerasure-packetsize-autotune: benchmark failed for technique="
+	<< technique << " k=" << k << " m=" << m << " w=" << w
+	<< " (" << r << ")" << std::endl;
+    return r;
+  }
+  *packetsize = r;
+  // persisted so that every OSD uses the packetsize chosen here
+  profile["packetsize"] = std::to_string(r);
+  return 0;
+}
+
 // 
 // ErasureCodeJerasureReedSolomonVandermonde
 //
@@ -414,8 +547,8 @@ void ErasureCodeJerasureCauchy::jerasure_encode(char **data,
 						char **coding,
 						int blocksize)
 {
-  jerasure_schedule_encode(k, m, w, schedule,
-			   data, coding, blocksize, packetsize);
+  jerasure_flat_schedule_encode(k, m, w, schedule,
+				data, coding, blocksize, kernel_flags);
 }
 
 int ErasureCodeJerasureCauchy::jerasure_decode(int *erasures,
@@ -423,8 +556,8 @@ int ErasureCodeJerasureCauchy::jerasure_decode(int *erasures,
 					       char **coding,
 					       int blocksize)
 {
-  return jerasure_schedule_decode_lazy(k, m, w, bitmatrix,
-				       erasures, data, coding, blocksize, packetsize, 1);
+  return schedule_decode(bitmatrix, packetsize,
+			 erasures, data, coding, blocksize);
 }
 
 int ErasureCodeJerasureCauchy::jerasure_decode_for_xor(int *erasures,
@@ -435,7 +568,7 @@ int ErasureCodeJerasureCauchy::jerasure_decode_for_xor(int *erasures,
                  Control* control)
 {
   int r= jerasure_schedule_decode_lazy_hybrid_solution(k, m, w, bitmatrix, erasures, data, 
-               coding, blocksize, packetsize, parity_group_selection, control);
+               coding, blocksize, packetsize, parity_group_selection, control, kernel_flags);
   free(control);
   return r;
 }
@@ -460,16 +593,25 @@ int ErasureCodeJerasureCauchy::parse(ErasureCodeProfile &profile,
 				     ostream *ss)
 {
   int err = ErasureCodeJerasure::parse(profile, ss);
+  bool autotune;
+  err |= parse_packetsize_autotune(profile, &autotune, ss);
+  err |= parse_xor_engine(profile, ss);
   err |= to_int("packetsize", profile, &packetsize, DEFAULT_PACKETSIZE, ss);
   err |= to_bool("jerasure-per-chunk-alignment", profile,
 		 &per_chunk_alignment, "false", ss);
-  return err;
+  if (err)
+    return err;
+  err = parse_matrix(profile, ss);
+  if (err || !autotune)
+    return err;
+  return autotune_packetsize(profile, &packetsize, ss);
 }
 
-void ErasureCodeJerasureCauchy::prepare_schedule(int *matrix)
+void ErasureCodeJerasureCauchy::prepare()
 {
-  bitmatrix = jerasure_matrix_to_bitmatrix(k, m, w, matrix);
-  schedule = jerasure_smart_bitmatrix_to_schedule(k, m, w, bitmatrix);
+  bitmatrix = coding_bitmatrix();
+  schedule = smart_flat_schedule(bitmatrix, packetsize);
+  prepare_xor_engine(schedule);
 }
 
 int* ErasureCodeJerasureCauchy::get_matrix()//add by LYF
@@ -485,21 +627,73 @@ int ErasureCodeJerasureCauchy::get_symbol_size()//add by LYF
 // 
 // ErasureCodeJerasureCauchyOrig
 //
-void ErasureCodeJerasureCauchyOrig::prepare()
+int *ErasureCodeJerasureCauchyOrig::coding_bitmatrix()
 {
   int *matrix = cauchy_original_coding_matrix(k, m, w);
-  prepare_schedule(matrix);
+  if (!matrix)
+    return NULL;
+  int *bitmatrix = jerasure_matrix_to_bitmatrix(k, m, w, matrix);
   free(matrix);
+  return bitmatrix;
 }
 
 // 
 // ErasureCodeJerasureCauchyGood
 //
-void ErasureCodeJerasureCauchyGood::prepare()
+int ErasureCodeJerasureCauchyGood::parse_matrix(ErasureCodeProfile &profile,
+						ostream *ss)
 {
-  int *matrix = cauchy_good_general_coding_matrix(k, m, w);
-  prepare_schedule(matrix);
+  bool search;
+  int err = to_bool("jerasure-cauchy-search", profile, &search, "false", ss);
+  if (err || !search)
+    return err;
+  // the points found where the profile was created
+  ErasureCodeProfile::const_iterator p = profile.find("jerasure-cauchy-points");
+  if (p != profile.end() && p->second.size() > 0) {
+    err = ErasureCodeJerasureCauchySearch::parse_points(k, m, w, p->second,
+							&points, ss);
+  } else {
+    ErasureCodeJerasureCauchySearch::result_ref searched;
+    if (cauchy_search)
+      searched = cauchy_search->get_matrix(k, m, w);
+    else
+      searched = ErasureCodeJerasureCauchySearch::search(k, m, w);
+    if (!searched) {
+      *ss << "jerasure-cauchy-search: no cauchy_good matrix for k=" << k
+	  << " m=" << m << " w=" << w << std::endl;
+      return -EINVAL;
+    }
+    points = searched->points;
+    // persisted so that every OSD rebuilds the matrix chosen here
+    profile["jerasure-cauchy-points"] =
+      ErasureCodeJerasureCauchySearch::format_points(m, points);
+    // read only, for the operator to compare with the default matrix
+    profile["jerasure-encode-xors"] = std::to_string(searched->encode_xors);
+    profile["jerasure-default-encode-xors"] =
+      std::to_string(searched->default_encode_xors);
+    profile["jerasure-recovery-symbols"] =
+      std::to_string(searched->recovery_symbols);
+    profile["jerasure-default-recovery-symbols"] =
+      std::to_string(searched->default_recovery_symbols);
+  }
+  if (!err && !points.empty())
+    schedule_technique = "cauchy_good_" +
+      ErasureCodeJerasureCauchySearch::format_points(m, points);
+  return err;
+}
+
+int *ErasureCodeJerasureCauchyGood::coding_bitmatrix()
+{
+  int *matrix;
+  if (points.empty())
+    matrix = cauchy_good_general_coding_matrix(k, m, w);
+  else
+    matrix = ErasureCodeJerasureCauchySearch::points_matrix(k, m, w, points);
+  if (!matrix)
+    return NULL;
+  int *bitmatrix = jerasure_matrix_to_bitmatrix(k, m, w, matrix);
   free(matrix);
+  return bitmatrix;
 }
 
 // 
@@ -510,15 +704,15 @@ ErasureCodeJerasureLiberation::~ErasureCodeJerasureLiberation()
   if (bitmatrix)
     free(bitmatrix);
   if (schedule)
-    jerasure_free_schedule(schedule);
+    jerasure_free_flat_schedule(schedule);
 }
 
 void ErasureCodeJerasureLiberation::jerasure_encode(char **data,
                                                     char **coding,
                                                     int blocksize)
 {
-  jerasure_schedule_encode(k, m, w, schedule, data,
-			   coding, blocksize, packetsize);
+  jerasure_flat_schedule_encode(k, m, w, schedule, data,
+				coding, blocksize, kernel_flags);
 }
 
 int ErasureCodeJerasureLiberation::jerasure_decode(int *erasures,
@@ -526,8 +720,8 @@ int ErasureCodeJerasureLiberation::jerasure_decode(int *erasures,
                                                     char **coding,
                                                     int blocksize)
 {
-  return jerasure_schedule_decode_lazy(k, m, w, bitmatrix, erasures, data,
-				       coding, blocksize, packetsize, 1);
+  return schedule_decode(bitmatrix, packetsize, erasures, data,
+			 coding, blocksize);
 }
 
 int ErasureCodeJerasureLiberation::jerasure_decode_for_xor(int *erasures,
@@ -538,7 +732,7 @@ int ErasureCodeJerasureLiberation::jerasure_decode_for_xor(int *erasures,
                                                     Control * control)
 {
   int r = jerasure_schedule_decode_lazy_hybrid_solution(k, m, w, bitmatrix, erasures, data, 
-               coding, blocksize, packetsize, parity_group_selection, control);
+               coding, blocksize, packetsize, parity_group_selection, control, kernel_flags);
   free(control);
   return r;
 }
@@ -611,6 +805,9 @@ int ErasureCodeJerasureLiberation::parse(ErasureCodeProfile &profile,
 					 ostream *ss)
 {
   int err = ErasureCodeJerasure::parse(profile, ss);
+  bool autotune;
+  err |= parse_packetsize_autotune(profile, &autotune, ss);
+  err |= parse_xor_engine(profile, ss);
   err |= to_int("packetsize", profile, &packetsize, DEFAULT_PACKETSIZE, ss);
 
   bool error = false;
@@ -624,13 +821,21 @@ int ErasureCodeJerasureLiberation::parse(ErasureCodeProfile &profile,
     revert_to_default(profile, ss);
     err = -EINVAL;
   }
-  return err;
+  if (err || !autotune)
+    return err;
+  return autotune_packetsize(profile, &packetsize, ss);
 }
 
 void ErasureCodeJerasureLiberation::prepare()
 {
-  bitmatrix = liberation_coding_bitmatrix(k, w);
-  schedule = jerasure_smart_bitmatrix_to_schedule(k, m, w, bitmatrix);
+  bitmatrix = coding_bitmatrix();
+  schedule = smart_flat_schedule(bitmatrix, packetsize);
+  prepare_xor_engine(schedule);
+}
+
+int *ErasureCodeJerasureLiberation::coding_bitmatrix()
+{
+  return liberation_coding_bitmatrix(k, w);
 }
 
 int* ErasureCodeJerasureLiberation::get_matrix()//add by LYF
@@ -661,10 +866,9 @@ bool ErasureCodeJerasureBlaumRoth::check_w(ostream *ss) const
   }
 }
 
-void ErasureCodeJerasureBlaumRoth::prepare()
+int *ErasureCodeJerasureBlaumRoth::coding_bitmatrix()
 {
-  bitmatrix = blaum_roth_coding_bitmatrix(k, w);
-  schedule = jerasure_smart_bitmatrix_to_schedule(k, m, w, bitmatrix);
+  return blaum_roth_coding_bitmatrix(k, w);
 }
 
 // 
@@ -678,6 +882,9 @@ int ErasureCodeJerasureLiber8tion::parse(ErasureCodeProfile &profile,
   err |= to_int("m", profile, &m, DEFAULT_M, ss);
   profile.erase("w");
   err |= to_int("w", profile, &w, DEFAULT_W, ss);
+  bool autotune;
+  err |= parse_packetsize_autotune(profile, &autotune, ss);
+  err |= parse_xor_engine(profile, ss);
   err |= to_int("packetsize", profile, &packetsize, DEFAULT_PACKETSIZE, ss);
 
   bool error = false;
@@ -689,11 +896,12 @@ int ErasureCodeJerasureLiber8tion::parse(ErasureCodeProfile &profile,
     revert_to_default(profile, ss);
     err = -EINVAL;
   }
-  return err;
+  if (err || !autotune)
+    return err;
+  return autotune_packetsize(profile, &packetsize, ss);
 }
 
-void ErasureCodeJerasureLiber8tion::prepare()
+int *ErasureCodeJerasureLiber8tion::coding_bitmatrix()
 {
-  bitmatrix = liber8tion_coding_bitmatrix(k);
-  schedule = jerasure_smart_bitmatrix_to_schedule(k, m, w, bitmatrix);
+  return liber8tion_coding_bitmatrix(k);
 }
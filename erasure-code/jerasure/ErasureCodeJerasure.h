@@ -19,6 +19,9 @@
 #define CEPH_ERASURE_CODE_JERASURE_H
 
 #include "erasure-code/ErasureCode.h"
+#include "ErasureCodeJerasureScheduleCache.h"
+#include "ErasureCodeJerasureCauchySearch.h"
+#include "ErasureCodeJerasurePacketsizeTuner.h"
 extern "C" {
 #include "control.h"
 }
@@ -37,6 +40,17 @@ public:
   string ruleset_root;
   string ruleset_failure_domain;
   bool per_chunk_alignment;
+  // jerasure-xor-engine: auto, jerasure or isa
+  string xor_engine;
+  // JERASURE_KERNEL_FLAGS the schedules run with, see prepare_xor_engine
+  int kernel_flags;
+  // owned by the plugin, NULL when the instance was not created by it
+  ErasureCodeJerasureScheduleCache *schedule_cache;
+  ErasureCodeJerasureCauchySearch *cauchy_search;
+  ErasureCodeJerasurePacketsizeTuner *packetsize_tuner;
+  // true where profiles are created, not on an OSD: only there does
+  // jerasure-packetsize-autotune benchmark, see parse_packetsize_autotune
+  bool creates_profile;
 
   explicit ErasureCodeJerasure(const char *_technique) :
     k(0),
@@ -48,7 +62,12 @@ public:
     technique(_technique),
     ruleset_root(DEFAULT_RULESET_ROOT),
     ruleset_failure_domain(DEFAULT_RULESET_FAILURE_DOMAIN),
-    per_chunk_alignment(false)
+    per_chunk_alignment(false),
+    kernel_flags(0),
+    schedule_cache(NULL),
+    cauchy_search(NULL),
+    packetsize_tuner(NULL),
+    creates_profile(false)
   {}
 
   ~ErasureCodeJerasure() override {}
@@ -93,6 +112,7 @@ public:
 
   int* get_bitmatrix() override;//add by LYF
   int get_packetsize() override;//add by LYF
+  ErasureCodeCapabilities get_capabilities() override;
 
   virtual void jerasure_encode(char **data,
                                char **coding,
@@ -113,10 +133,24 @@ public:
 
   virtual int* get_matrix() = 0;//add by LYF
   virtual int get_symbol_size() = 0;//add by LYF
+  // the coding bitmatrix for k, m and w, to be freed by the caller,
+  // NULL for the techniques that code with a matrix
+  virtual int *coding_bitmatrix() { return NULL; }
 
   static bool is_prime(int value);
 protected:
   virtual int parse(ErasureCodeProfile &profile, ostream *ss);
+  jerasure_flat_schedule *smart_flat_schedule(int *bitmatrix, int packetsize);
+  int schedule_decode(int *bitmatrix, int packetsize, int *erasures,
+		      char **data, char **coding, int blocksize);
+  // distinguishes the bitmatrices of a technique in the schedule cache
+  virtual const char *get_schedule_technique() const { return technique; }
+  int parse_packetsize_autotune(ErasureCodeProfile &profile, bool *autotune,
+				ostream *ss);
+  int autotune_packetsize(ErasureCodeProfile &profile, int *packetsize,
+			  ostream *ss);
+  int parse_xor_engine(ErasureCodeProfile &profile, ostream *ss);
+  void prepare_xor_engine(jerasure_flat_schedule *schedule);
 };
 
 class ErasureCodeJerasureReedSolomonVandermonde : public ErasureCodeJerasure {
@@ -199,7 +233,7 @@ private:
 class ErasureCodeJerasureCauchy : public ErasureCodeJerasure {
 public:
   int *bitmatrix;
-  int **schedule;
+  jerasure_flat_schedule *schedule;
   int packetsize;
 
   explicit ErasureCodeJerasureCauchy(const char *technique) :
@@ -216,7 +250,7 @@ public:
     if (bitmatrix)
       free(bitmatrix);
     if (schedule)
-      free(schedule);
+      jerasure_free_flat_schedule(schedule);
   }
 
   void jerasure_encode(char **data,
@@ -233,11 +267,15 @@ public:
                                int* parity_group_selection, 
                                Control* control) override;//add  by LYF
   unsigned get_alignment() const override;
-  void prepare_schedule(int *matrix);
+  void prepare() override;
   int* get_matrix() override;//add by LYF
   int get_symbol_size() override;//add by LYF
-private:
+protected:
   int parse(ErasureCodeProfile &profile, ostream *ss) override;
+  // called by parse once k, m and w are known
+  virtual int parse_matrix(ErasureCodeProfile &profile, ostream *ss) {
+    return 0;
+  }
 };
 
 class ErasureCodeJerasureCauchyOrig : public ErasureCodeJerasureCauchy {
@@ -246,22 +284,32 @@ public:
     ErasureCodeJerasureCauchy("cauchy_orig")
   {}
 
-  void prepare() override;
+  int *coding_bitmatrix() override;
 };
 
 class ErasureCodeJerasureCauchyGood : public ErasureCodeJerasureCauchy {
 public:
+  // X then Y, set from jerasure-cauchy-points by jerasure-cauchy-search=true
+  std::vector<int> points;
+  std::string schedule_technique;
+
   ErasureCodeJerasureCauchyGood() :
-    ErasureCodeJerasureCauchy("cauchy_good")
+    ErasureCodeJerasureCauchy("cauchy_good"),
+    schedule_technique("cauchy_good")
   {}
 
-  void prepare() override;
+  int *coding_bitmatrix() override;
+private:
+  int parse_matrix(ErasureCodeProfile &profile, ostream *ss) override;
+  const char *get_schedule_technique() const override {
+    return schedule_technique.c_str();
+  }
 };
 
 class ErasureCodeJerasureLiberation : public ErasureCodeJerasure {
 public:
   int *bitmatrix;
-  int **schedule;
+  jerasure_flat_schedule *schedule;
   int packetsize;
 
   explicit ErasureCodeJerasureLiberation(const char *technique = "liberation") :
@@ -297,6 +345,7 @@ public:
   virtual int revert_to_default(ErasureCodeProfile &profile,
 				ostream *ss);
   void prepare() override;
+  int *coding_bitmatrix() override;
   int* get_matrix() override;//add by LYF
   int get_symbol_size() override;//add by LYF
 private:
@@ -311,7 +360,7 @@ public:
   }
 
   bool check_w(ostream *ss) const override;
-  void prepare() override;
+  int *coding_bitmatrix() override;
 };
 
 class ErasureCodeJerasureLiber8tion : public ErasureCodeJerasureLiberation {
@@ -324,7 +373,7 @@ public:
     DEFAULT_W = "8";
   }
 
-  void prepare() override;
+  int *coding_bitmatrix() override;
 private:
   int parse(ErasureCodeProfile &profile, ostream *ss) override;
 };
@@ -0,0 +1,435 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <set>
+#include <sstream>
+#include "common/debug.h"
+#include "ErasureCodeJerasureCauchySearch.h"
+extern "C" {
+#include "jerasure.h"
+#include "cauchy.h"
+}
+
+#define dout_context g_ceph_context
+#define dout_subsys ceph_subsys_osd
+#undef dout_prefix
+#define dout_prefix _prefix(_dout)
+
+static ostream& _prefix(std::ostream* _dout)
+{
+  return *_dout << "ErasureCodeJerasureCauchySearch: ";
+}
+
+namespace {
+
+// xorshift64*, the same sequence on every platform unlike rand()
+class search_rng_t {
+  uint64_t state;
+public:
+  explicit search_rng_t(uint64_t seed) : state(seed ? seed : 1) {}
+  uint32_t next() {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return (state * 2685821657736338717ULL) >> 32;
+  }
+};
+
+// C(n, r) or limit + 1 if it is larger than limit
+uint64_t choose(uint64_t n, uint64_t r, uint64_t limit)
+{
+  if (r > n)
+    return 0;
+  uint64_t c = 1;
+  for (uint64_t i = 0; i < r; i++) {
+    c = c * (n - i) / (i + 1);
+    if (c > limit)
+      return limit + 1;
+  }
+  return c;
+}
+
+// advance idx, r increasing indexes in [0, n), to the next combination
+bool next_combination(std::vector<int> &idx, int n)
+{
+  int r = idx.size();
+  int i = r - 1;
+  while (i >= 0 && idx[i] == n - r + i)
+    i--;
+  if (i < 0)
+    return false;
+  idx[i]++;
+  for (int j = i + 1; j < r; j++)
+    idx[j] = idx[j - 1] + 1;
+  return true;
+}
+
+// X = points[0..m), Y = points[m..m+k), rescaled like cauchy_good
+int *points_to_matrix(int k, int m, int w, const std::vector<int> &points)
+{
+  std::vector<int> p(points);
+  int *matrix = cauchy_xy_coding_matrix(k, m, w, &p[0], &p[m]);
+  if (matrix)
+    cauchy_improve_coding_matrix(k, m, w, matrix);
+  return matrix;
+}
+
+struct cost_t {
+  int ones;
+  int recovery_symbols;
+  int total() const { return ones + recovery_symbols; }
+};
+
+bool evaluate(int k, int m, int w, int *matrix, cost_t *cost)
+{
+  int *bitmatrix = jerasure_matrix_to_bitmatrix(k, m, w, matrix);
+  if (!bitmatrix)
+    return false;
+  cost->ones = ErasureCodeJerasureCauchySearch::count_ones(k, m, w, bitmatrix);
+  cost->recovery_symbols =
+    ErasureCodeJerasureCauchySearch::count_recovery_symbols(k, m, w, bitmatrix);
+  free(bitmatrix);
+  return cost->recovery_symbols >= 0;
+}
+
+int encode_xors(int k, int m, int w, int *matrix)
+{
+  int *bitmatrix = jerasure_matrix_to_bitmatrix(k, m, w, matrix);
+  if (!bitmatrix)
+    return -1;
+  int xors = ErasureCodeJerasureCauchySearch::count_encode_xors(k, m, w, bitmatrix);
+  free(bitmatrix);
+  return xors;
+}
+
+bool evaluate_points(int k, int m, int w, const std::vector<int> &points,
+		     cost_t *cost)
+{
+  int *matrix = points_to_matrix(k, m, w, points);
+  if (!matrix)
+    return false;
+  bool ok = evaluate(k, m, w, matrix, cost);
+  free(matrix);
+  return ok;
+}
+
+} // anonymous namespace
+
+int ErasureCodeJerasureCauchySearch::count_ones(int k, int m, int w,
+						const int *bitmatrix)
+{
+  int ones = 0;
+  for (int i = 0; i < k * m * w * w; i++)
+    ones += bitmatrix[i] ? 1 : 0;
+  return ones;
+}
+
+int ErasureCodeJerasureCauchySearch::count_recovery_symbols(int k, int m, int w,
+							    const int *bitmatrix)
+{
+  const int columns = k * w;
+  const int rows = m * w;
+  const int words = (columns + 63) / 64;
+  std::vector<uint64_t> row_bits(rows * words, 0);
+  for (int r = 0; r < rows; r++)
+    for (int c = 0; c < columns; c++)
+      if (bitmatrix[r * columns + c])
+	row_bits[r * words + c / 64] |= 1ULL << (c % 64);
+
+  int total = 0;
+  std::vector<uint64_t> read(words);
+  std::vector<uint64_t> survivors(words);
+  std::vector<uint32_t> lost(rows);
+  std::vector<char> selected(rows);
+  for (int failed = 0; failed < k; failed++) {
+    std::fill(survivors.begin(), survivors.end(), ~0ULL);
+    for (int c = failed * w; c < (failed + 1) * w; c++)
+      survivors[c / 64] &= ~(1ULL << (c % 64));
+    for (int r = 0; r < rows; r++) {
+      lost[r] = 0;
+      for (int b = 0; b < w; b++)
+	if (bitmatrix[r * columns + failed * w + b])
+	  lost[r] |= 1u << b;
+    }
+    std::fill(read.begin(), read.end(), 0);
+    std::fill(selected.begin(), selected.end(), 0);
+    uint32_t basis[32] = { 0 };  // by highest bit
+    for (int found = 0; found < w; found++) {
+      int best = -1;
+      int best_read = INT_MAX;
+      uint32_t best_reduced = 0;
+      for (int r = 0; r < rows; r++) {
+	if (selected[r])
+	  continue;
+	uint32_t v = lost[r];
+	for (int b = w - 1; b >= 0 && v; b--)
+	  if ((v & (1u << b)) && basis[b])
+	    v ^= basis[b];
+	if (!v)
+	  continue;  // does not help decoding the lost symbols
+	int n = 0;
+	for (int i = 0; i < words; i++)
+	  n += __builtin_popcountll((read[i] | row_bits[r * words + i]) &
+				    survivors[i]);
+	if (n < best_read) {
+	  best = r;
+	  best_read = n;
+	  best_reduced = v;
+	}
+      }
+      if (best < 0)
+	return -1;
+      selected[best] = 1;
+      basis[31 - __builtin_clz(best_reduced)] = best_reduced;
+      for (int i = 0; i < words; i++)
+	read[i] |= row_bits[best * words + i];
+    }
+    int n = 0;
+    for (int i = 0; i < words; i++)
+      n += __builtin_popcountll(read[i] & survivors[i]);
+    // plus the w parity symbols themselves
+    total += n + w;
+  }
+  return total;
+}
+
+int ErasureCodeJerasureCauchySearch::count_encode_xors(int k, int m, int w,
+						       int *bitmatrix)
+{
+  int **schedule = jerasure_smart_bitmatrix_to_schedule(k, m, w, bitmatrix);
+  if (!schedule)
+    return -1;
+  int xors = 0;
+  for (int op = 0; schedule[op][0] != -1; op++)
+    if (schedule[op][4])
+      xors++;
+  jerasure_free_schedule(schedule);
+  return xors;
+}
+
+ErasureCodeJerasureCauchySearch::result_ref
+ErasureCodeJerasureCauchySearch::search(int k, int m, int w)
+{
+  int *default_matrix = cauchy_good_general_coding_matrix(k, m, w);
+  if (!default_matrix)
+    return result_ref();
+  std::shared_ptr<result_t> result(new result_t);
+  cost_t best;
+  if (!evaluate(k, m, w, default_matrix, &best)) {
+    free(default_matrix);
+    return result_ref();
+  }
+  result->default_ones = best.ones;
+  result->default_recovery_symbols = best.recovery_symbols;
+  result->default_encode_xors = encode_xors(k, m, w, default_matrix);
+  result->matrix.assign(default_matrix, default_matrix + k * m);
+  free(default_matrix);
+
+  const uint64_t field = w < 32 ? 1ULL << w : 1ULL << 32;
+  std::vector<int> best_points;
+  cost_t cost;
+  uint64_t space = choose(field - 1, m - 1, exhaustive_limit);
+  if (space <= (uint64_t)exhaustive_limit)
+    space *= choose(field - m, k, exhaustive_limit);
+  result->exhaustive = space <= (uint64_t)exhaustive_limit;
+
+  if (result->exhaustive) {
+    // X[0] = 0, X[1..m) from the other elements, Y from what is left
+    std::vector<int> points(k + m, 0);
+    std::vector<int> xi(m - 1);
+    for (int i = 0; i < m - 1; i++)
+      xi[i] = i;
+    do {
+      std::vector<int> rest;
+      for (int e = 1, i = 0; e < (int)field; e++) {
+	if (i < m - 1 && xi[i] == e - 1)
+	  points[1 + i++] = e;
+	else
+	  rest.push_back(e);
+      }
+      std::vector<int> yi(k);
+      for (int i = 0; i < k; i++)
+	yi[i] = i;
+      do {
+	for (int i = 0; i < k; i++)
+	  points[m + i] = rest[yi[i]];
+	if (evaluate_points(k, m, w, points, &cost) &&
+	    cost.total() < best.total()) {
+	  best = cost;
+	  best_points = points;
+	}
+      } while (next_combination(yi, rest.size()));
+    } while (next_combination(xi, field - 1));
+  } else {
+    // start from the cauchy_good point sets, a move either replaces a
+    // point by an unused element or swaps a point of X with one of Y
+    std::vector<int> points(k + m);
+    std::set<int> used;
+    for (int i = 0; i < k + m; i++) {
+      points[i] = i;
+      used.insert(i);
+    }
+    cost_t current;
+    if (evaluate_points(k, m, w, points, &current)) {
+      if (current.total() < best.total()) {
+	best = current;
+	best_points = points;
+      }
+      search_rng_t rng(((uint64_t)k << 32) | ((uint64_t)m << 16) | w);
+      const int64_t t0 = std::max(1, current.total() / 20);
+      for (int i = 0; i < anneal_iterations; i++) {
+	int pos = 1 + rng.next() % (k + m - 1);
+	int other = -1;
+	int previous = points[pos];
+	if (m > 1 && (used.size() == field || rng.next() % 2)) {
+	  other = pos < m ? m + rng.next() % k : 1 + rng.next() % (m - 1);
+	  std::swap(points[pos], points[other]);
+	} else {
+	  int e;
+	  do {
+	    e = w < 32 ? rng.next() & (field - 1) : rng.next();
+	  } while (used.count(e));
+	  points[pos] = e;
+	}
+	bool accept = false;
+	if (evaluate_points(k, m, w, points, &cost)) {
+	  int64_t t = t0 * (anneal_iterations - i) / anneal_iterations;
+	  int64_t delta = cost.total() - current.total();
+	  accept = delta <= 0 ||
+	    (t > 0 && (int64_t)(rng.next() % (t + delta)) < t);
+	}
+	if (accept) {
+	  if (other < 0) {
+	    used.erase(previous);
+	    used.insert(points[pos]);
+	  }
+	  current = cost;
+	  if (current.total() < best.total()) {
+	    best = current;
+	    best_points = points;
+	  }
+	} else if (other < 0) {
+	  points[pos] = previous;
+	} else {
+	  std::swap(points[pos], points[other]);
+	}
+      }
+    }
+  }
+
+  if (!best_points.empty()) {
+    int *matrix = points_to_matrix(k, m, w, best_points);
+    result->matrix.assign(matrix, matrix + k * m);
+    result->points = best_points;
+    free(matrix);
+  }
+  result->ones = best.ones;
+  result->recovery_symbols = best.recovery_symbols;
+  std::vector<int> matrix(result->matrix);
+  result->encode_xors = encode_xors(k, m, w, &matrix[0]);
+  return result;
+}
+
+std::string ErasureCodeJerasureCauchySearch::format_points(int m,
+							  const std::vector<int> &points)
+{
+  if (points.empty())
+    return "cauchy_good";
+  std::ostringstream value;
+  for (unsigned i = 0; i < points.size(); i++) {
+    if (i)
+      value << ((int)i == m ? "/" : ",");
+    value << (uint32_t)points[i];
+  }
+  return value.str();
+}
+
+int ErasureCodeJerasureCauchySearch::parse_points(int k, int m, int w,
+						  const std::string &value,
+						  std::vector<int> *points,
+						  std::ostream *ss)
+{
+  points->clear();
+  if (value == "cauchy_good")
+    return 0;
+  const uint64_t field = w < 32 ? 1ULL << w : 1ULL << 32;
+  std::set<uint64_t> used;
+  unsigned x = 0;
+  bool valid = false;
+  const char *p = value.c_str();
+  while (isdigit(*p)) {
+    char *end;
+    errno = 0;
+    uint64_t e = strtoull(p, &end, 10);
+    if (errno || e >= field || !used.insert(e).second)
+      break;
+    points->push_back((int)(uint32_t)e);
+    p = end;
+    if (!*p) {
+      valid = true;
+    } else if (*p == '/' && !x) {
+      x = points->size();
+      p++;
+    } else if (*p == ',') {
+      p++;
+    } else {
+      break;
+    }
+  }
+  if (!valid || (int)x != m || (int)points->size() != k + m) {
+    *ss << "jerasure-cauchy-points=" << value << " must be " << m
+	<< " X and " << k << " Y distinct elements of GF(2^" << w
+	<< "), as in X0,X1/Y0,Y1,Y2" << std::endl;
+    points->clear();
+    return -EINVAL;
+  }
+  return 0;
+}
+
+int *ErasureCodeJerasureCauchySearch::points_matrix(int k, int m, int w,
+						    const std::vector<int> &points)
+{
+  return points_to_matrix(k, m, w, points);
+}
+
+ErasureCodeJerasureCauchySearch::result_ref
+ErasureCodeJerasureCauchySearch::get_matrix(int k, int m, int w)
+{
+  std::ostringstream key;
+  key << k << "/" << m << "/" << w;
+  {
+    Mutex::Locker l(lock);
+    std::map<std::string, result_ref>::iterator i = matrices.find(key.str());
+    if (i != matrices.end())
+      return i->second;
+  }
+  // the search takes a while, do not hold the lock meanwhile: when two
+  // instances race they find the same matrix and the first one is kept
+  result_ref result = search(k, m, w);
+  if (!result)
+    return result;
+  dout(1) << __func__ << " k=" << k << " m=" << m << " w=" << w
+	  << (result->exhaustive ? " exhaustive" : " annealed")
+	  << " ones " << result->default_ones << " -> " << result->ones
+	  << " encode xors " << result->default_encode_xors
+	  << " -> " << result->encode_xors
+	  << " recovery symbols " << result->default_recovery_symbols
+	  << " -> " << result->recovery_symbols << dendl;
+  Mutex::Locker l(lock);
+  return matrices.insert(std::make_pair(key.str(), result)).first->second;
+}
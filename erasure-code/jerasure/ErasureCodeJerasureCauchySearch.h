@@ -0,0 +1,100 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#ifndef CEPH_ERASURE_CODE_JERASURE_CAUCHY_SEARCH_H
+#define CEPH_ERASURE_CODE_JERASURE_CAUCHY_SEARCH_H
+
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "common/Mutex.h"
+
+/*
+ * Search for a sparser cauchy_good coding matrix, enabled with
+ * jerasure-cauchy-search=true.
+ *
+ * cauchy_good_general_coding_matrix takes X = {0..m-1}, Y = {m..m+k-1}
+ * and only rescales the rows. Here the X and Y point sets are searched
+ * as well, each candidate being rescaled by
+ * cauchy_improve_coding_matrix, to lower
+ *
+ *   cost = ones of the bitmatrix (encode XORs)
+ *        + symbols read to rebuild each data chunk alone, summed
+ *
+ * where a rebuild picks, greedily, the w parity rows that decode the
+ * lost chunk while touching the fewest other symbols, as the symbol
+ * recovery planner does. Every candidate is a Cauchy matrix, hence
+ * MDS, and the cauchy_good matrix is kept if nothing beats it.
+ *
+ * Translating X and Y by a constant does not change the matrix, nor
+ * does the order of Y and of X past its first element, so X[0] = 0 and
+ * the sets are enumerated when there are at most exhaustive_limit of
+ * them. Larger spaces are annealed for anneal_iterations steps with a
+ * seed derived from k, m and w and integer arithmetic only.
+ *
+ * The search runs once, where the profile is created: the caller
+ * writes the points it found in the profile and every OSD rebuilds the
+ * matrix from them with points_matrix instead of searching again.
+ */
+class ErasureCodeJerasureCauchySearch {
+public:
+  static const int exhaustive_limit = 20000;
+  static const int anneal_iterations = 10000;
+
+  struct result_t {
+    std::vector<int> matrix;  // m x k, over GF(2^w)
+    std::vector<int> points;  // X then Y, empty if cauchy_good was kept
+    int ones;                 // in the (m*w) x (k*w) bitmatrix
+    int recovery_symbols;     // summed over the k data chunks
+    int encode_xors;          // of the smart schedule, for one stripe
+    int default_ones;         // same for cauchy_good_general_coding_matrix
+    int default_recovery_symbols;
+    int default_encode_xors;
+    bool exhaustive;
+  };
+  typedef std::shared_ptr<const result_t> result_ref;
+
+  ErasureCodeJerasureCauchySearch() :
+    lock("ErasureCodeJerasureCauchySearch::lock")
+  {}
+
+  /*
+   * Return the searched matrix for k, m and w, searching on the first
+   * call. Returns a null reference if cauchy_good cannot be built.
+   */
+  result_ref get_matrix(int k, int m, int w);
+
+  static result_ref search(int k, int m, int w);
+
+  /*
+   * The points of a searched matrix, as written in the profile:
+   * X and Y separated by a slash, for instance 0,5/1,2,3, or
+   * cauchy_good when the search kept cauchy_good.
+   */
+  static std::string format_points(int m, const std::vector<int> &points);
+  static int parse_points(int k, int m, int w, const std::string &value,
+			  std::vector<int> *points, std::ostream *ss);
+  // freshly allocated, the matrix searched from these points
+  static int *points_matrix(int k, int m, int w,
+			    const std::vector<int> &points);
+  static int count_ones(int k, int m, int w, const int *bitmatrix);
+  static int count_recovery_symbols(int k, int m, int w, const int *bitmatrix);
+  static int count_encode_xors(int k, int m, int w, int *bitmatrix);
+
+private:
+  Mutex lock; // protects matrices
+  std::map<std::string, result_ref> matrices;
+};
+
+#endif
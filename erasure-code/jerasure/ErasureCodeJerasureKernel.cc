@@ -0,0 +1,308 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <set>
+#include <utility>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "acconfig.h"
+#include "common/ceph_time.h"
+#include "ErasureCodeJerasureKernel.h"
+#ifdef HAVE_BETTER_YASM_ELF64
+#include "erasure-code/isa/xor_op.h"
+
+static_assert(ErasureCodeJerasureKernel::min_stream_packetsize ==
+	      EC_ISA_STREAM_MIN_SIZE,
+	      "both engines stream the same rows");
+#endif
+
+namespace {
+
+// dst = srcs[0] ^ ... ^ srcs[N-1], or dst ^= ... when ACCUMULATE.
+// N is a constant so the inner loop is fully unrolled and the running
+// value stays in a register for each word of the packet.
+template <int N, bool ACCUMULATE>
+void xor_row(char *dst, char * const *srcs, int packetsize)
+{
+  const uint64_t *s[N];
+  for (int j = 0; j < N; j++)
+    s[j] = reinterpret_cast<const uint64_t*>(srcs[j]);
+  uint64_t *d = reinterpret_cast<uint64_t*>(dst);
+  int words = packetsize / sizeof(uint64_t);
+  for (int i = 0; i < words; i++) {
+    uint64_t v = ACCUMULATE ? d[i] ^ s[0][i] : s[0][i];
+    for (int j = 1; j < N; j++)
+      v ^= s[j][i];
+    d[i] = v;
+  }
+  for (int b = words * sizeof(uint64_t); b < packetsize; b++) {
+    char v = ACCUMULATE ? dst[b] ^ srcs[0][b] : srcs[0][b];
+    for (int j = 1; j < N; j++)
+      v ^= srcs[j][b];
+    dst[b] = v;
+  }
+}
+
+#ifdef __SSE2__
+// Same as xor_row but dst is written with non-temporal stores. The
+// packetsize is a multiple of 16, dst is expected to be 16 bytes
+// aligned like the chunk buffers and falls back to xor_row otherwise.
+template <int N, bool ACCUMULATE>
+void xor_row_stream(char *dst, char * const *srcs, int packetsize)
+{
+  if (reinterpret_cast<uintptr_t>(dst) % sizeof(__m128i)) {
+    xor_row<N, ACCUMULATE>(dst, srcs, packetsize);
+    return;
+  }
+  const __m128i *s[N];
+  for (int j = 0; j < N; j++)
+    s[j] = reinterpret_cast<const __m128i*>(srcs[j]);
+  __m128i *d = reinterpret_cast<__m128i*>(dst);
+  int vectors = packetsize / sizeof(__m128i);
+  for (int i = 0; i < vectors; i++) {
+    __m128i v = _mm_loadu_si128(s[0] + i);
+    if (ACCUMULATE)
+      v = _mm_xor_si128(v, _mm_load_si128(d + i));
+    for (int j = 1; j < N; j++)
+      v = _mm_xor_si128(v, _mm_loadu_si128(s[j] + i));
+    _mm_stream_si128(d + i, v);
+  }
+}
+#endif
+
+#define ROW_KERNELS(ROW, ACCUMULATE)					\
+  { ROW<1, ACCUMULATE>,  ROW<2, ACCUMULATE>,				\
+    ROW<3, ACCUMULATE>,  ROW<4, ACCUMULATE>,				\
+    ROW<5, ACCUMULATE>,  ROW<6, ACCUMULATE>,				\
+    ROW<7, ACCUMULATE>,  ROW<8, ACCUMULATE>,				\
+    ROW<9, ACCUMULATE>,  ROW<10, ACCUMULATE>,				\
+    ROW<11, ACCUMULATE>, ROW<12, ACCUMULATE>,				\
+    ROW<13, ACCUMULATE>, ROW<14, ACCUMULATE>,				\
+    ROW<15, ACCUMULATE>, ROW<16, ACCUMULATE> }
+
+typedef void (*row_kernel_fn)(char *dst, char * const *srcs, int packetsize);
+
+const row_kernel_fn row_kernels[2][ErasureCodeJerasureKernel::max_row_sources] = {
+  ROW_KERNELS(xor_row, false),
+  ROW_KERNELS(xor_row, true)
+};
+
+#ifdef __SSE2__
+const row_kernel_fn stream_row_kernels[2][ErasureCodeJerasureKernel::max_row_sources] = {
+  ROW_KERNELS(xor_row_stream, false),
+  ROW_KERNELS(xor_row_stream, true)
+};
+#endif
+
+#undef ROW_KERNELS
+
+} // anonymous namespace
+
+ErasureCodeJerasureKernel::ErasureCodeJerasureKernel(const jerasure_flat_schedule *flat)
+  : packetsize(flat->packetsize)
+{
+  std::vector<int> row_src;
+  std::vector<int> row_src_off;
+  int op = 0;
+  while (op < flat->nops) {
+    int dst = flat->dst[op];
+    int dst_off = flat->dst_off[op];
+    // a copy starts a fresh row, an xor first folds into what is there
+    bool accumulate = flat->xor_op[op];
+    row_src.clear();
+    row_src_off.clear();
+    do {
+      row_src.push_back(flat->src[op]);
+      row_src_off.push_back(flat->src_off[op]);
+      op++;
+    } while (op < flat->nops &&
+	     flat->xor_op[op] &&
+	     flat->dst[op] == dst &&
+	     flat->dst_off[op] == dst_off);
+    add_row(dst, dst_off, accumulate, row_src, row_src_off);
+  }
+  find_final_rows();
+}
+
+void ErasureCodeJerasureKernel::add_row(int dst, int dst_off, bool accumulate,
+					const std::vector<int> &row_src,
+					const std::vector<int> &row_src_off)
+{
+  for (size_t first = 0; first < row_src.size(); first += max_row_sources) {
+    row_t row;
+    row.dst = dst;
+    row.dst_off = dst_off;
+    row.first = src.size();
+    row.count = std::min<size_t>(max_row_sources, row_src.size() - first);
+    row.accumulate = accumulate || first > 0;
+    row.kernel = get_row_kernel(row.count, accumulate || first > 0);
+    row.stream_kernel = get_stream_row_kernel(row.count, accumulate || first > 0);
+    src.insert(src.end(), row_src.begin() + first,
+	       row_src.begin() + first + row.count);
+    src_off.insert(src_off.end(), row_src_off.begin() + first,
+		   row_src_off.begin() + first + row.count);
+    rows.push_back(row);
+  }
+}
+
+void ErasureCodeJerasureKernel::find_final_rows()
+{
+  bool streamable = packetsize >= min_stream_packetsize && packetsize % 16 == 0;
+  // walk backwards: a row holds the last value of its packet if no
+  // later row reads or writes that packet
+  std::set<std::pair<int, int> > used_later;
+  for (std::vector<row_t>::reverse_iterator row = rows.rbegin();
+       row != rows.rend();
+       ++row) {
+    if (!used_later.insert(std::make_pair(row->dst, row->dst_off)).second ||
+	!streamable)
+      row->stream_kernel = NULL;
+    for (int j = 0; j < row->count; j++)
+      used_later.insert(std::make_pair(src[row->first + j],
+				       src_off[row->first + j]));
+  }
+}
+
+ErasureCodeJerasureKernel::row_kernel_t
+ErasureCodeJerasureKernel::get_row_kernel(int count, bool accumulate)
+{
+  return row_kernels[accumulate ? 1 : 0][count - 1];
+}
+
+ErasureCodeJerasureKernel::row_kernel_t
+ErasureCodeJerasureKernel::get_stream_row_kernel(int count, bool accumulate)
+{
+#ifdef __SSE2__
+  return stream_row_kernels[accumulate ? 1 : 0][count - 1];
+#else
+  return NULL;
+#endif
+}
+
+bool ErasureCodeJerasureKernel::have_isa_xor()
+{
+#ifdef HAVE_BETTER_YASM_ELF64
+  return true;
+#else
+  return false;
+#endif
+}
+
+int ErasureCodeJerasureKernel::choose_xor_flags(int k, int m, int w,
+						jerasure_flat_schedule *flat)
+{
+  if (!have_isa_xor() || flat->kernel != run_kernel)
+    return 0;
+  int stride = w * flat->packetsize;
+  int size = std::max(stride, choose_bytes / stride * stride);
+  char *buffer = NULL;
+  if (posix_memalign((void **)&buffer, 64, (size_t)(k + m) * size))
+    return 0;
+  for (size_t i = 0; i < (size_t)k * size; i++)
+    buffer[i] = i * 2654435761u >> 24;
+  char *data[k];
+  char *coding[m];
+  for (int i = 0; i < k; i++)
+    data[i] = buffer + (size_t)i * size;
+  for (int i = 0; i < m; i++)
+    coding[i] = buffer + (size_t)(k + i) * size;
+
+  const int engines[] = { 0, isa_xor };
+  int64_t ns[2];
+  for (int round = 0; round < choose_rounds; round++) {
+    for (int e = 0; e < 2; e++) {
+      ceph::mono_time start = ceph::mono_clock::now();
+      jerasure_flat_schedule_encode(k, m, w, flat, data, coding, size,
+				    engines[e]);
+      int64_t took = std::chrono::duration_cast<std::chrono::nanoseconds>(
+	ceph::mono_clock::now() - start).count();
+      if (round == 0 || took < ns[e])
+	ns[e] = took;
+    }
+  }
+  free(buffer);
+  return ns[1] < ns[0] ? isa_xor : 0;
+}
+
+void ErasureCodeJerasureKernel::run(char **ptrs, int flags) const
+{
+  char *srcs[max_row_sources + 1];
+  bool stream = flags & JERASURE_STREAM_OUTPUT;
+  bool streamed = false;
+#ifdef HAVE_BETTER_YASM_ELF64
+  if (flags & isa_xor) {
+    // region_xor overwrites its destination, an accumulating row reads
+    // it as the first source, each 64 bytes being read before written
+    for (std::vector<row_t>::const_iterator row = rows.begin();
+	 row != rows.end();
+	 ++row) {
+      char *dst = ptrs[row->dst] + row->dst_off;
+      int n = 0;
+      if (row->accumulate)
+	srcs[n++] = dst;
+      for (int j = 0; j < row->count; j++)
+	srcs[n++] = ptrs[src[row->first + j]] + src_off[row->first + j];
+      region_xor((unsigned char**)srcs, (unsigned char*)dst, n, packetsize,
+		 stream && row->stream_kernel);
+    }
+    return;
+  }
+#endif
+  for (std::vector<row_t>::const_iterator row = rows.begin();
+       row != rows.end();
+       ++row) {
+    for (int j = 0; j < row->count; j++)
+      srcs[j] = ptrs[src[row->first + j]] + src_off[row->first + j];
+    if (stream && row->stream_kernel) {
+      row->stream_kernel(ptrs[row->dst] + row->dst_off, srcs, packetsize);
+      streamed = true;
+    } else {
+      row->kernel(ptrs[row->dst] + row->dst_off, srcs, packetsize);
+    }
+  }
+#ifdef __SSE2__
+  // order the non-temporal stores before whoever reads the chunk next
+  if (streamed)
+    _mm_sfence();
+#endif
+}
+
+void ErasureCodeJerasureKernel::specialize(jerasure_flat_schedule *flat)
+{
+  // a row reading the packet it writes would see the partial result
+  // when run by the interpreter, keep those schedules interpreted
+  for (int op = 0; op < flat->nops; op++)
+    if (flat->src[op] == flat->dst[op] &&
+	flat->src_off[op] == flat->dst_off[op])
+      return;
+  flat->kernel_data = new ErasureCodeJerasureKernel(flat);
+  flat->kernel = run_kernel;
+  flat->kernel_release = release;
+}
+
+void ErasureCodeJerasureKernel::run_kernel(char **ptrs, jerasure_flat_schedule *flat,
+					   int flags)
+{
+  static_cast<ErasureCodeJerasureKernel*>(flat->kernel_data)->run(ptrs, flags);
+}
+
+void ErasureCodeJerasureKernel::release(jerasure_flat_schedule *flat)
+{
+  delete static_cast<ErasureCodeJerasureKernel*>(flat->kernel_data);
+  flat->kernel_data = NULL;
+  flat->kernel = NULL;
+  flat->kernel_release = NULL;
+}
@@ -0,0 +1,99 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#ifndef CEPH_ERASURE_CODE_JERASURE_KERNEL_H
+#define CEPH_ERASURE_CODE_JERASURE_KERNEL_H
+
+#include <vector>
+extern "C" {
+#include "jerasure.h"
+}
+
+/*
+ * Specialized runner for a flat jerasure schedule.
+ *
+ * The interpreter in jerasure_do_flat_scheduled_operations reloads and
+ * rewrites the destination packet for every operation. Here the
+ * consecutive operations that target the same destination packet are
+ * fused into a row, and each row is run by a kernel instantiated for
+ * its number of sources, which keeps the running XOR in a register and
+ * writes the destination once.
+ *
+ * Installed with jerasure_set_flat_schedule_specializer, so that every
+ * flat schedule (encode, conventional decode and symbol recovery
+ * decode) gets one; schedules it cannot handle stay interpreted.
+ *
+ * With JERASURE_STREAM_OUTPUT, the rows that write the last value of
+ * a packet nothing else in the schedule reads use non-temporal stores,
+ * provided the packets are at least min_stream_packetsize bytes: the
+ * decoded chunk then does not push the surviving packets, which are
+ * read again by the next rows, out of the cache.
+ *
+ * When the isa plugin is built, the isa_xor flag runs the rows with its
+ * multi-source region_xor (AVX-512, AVX2 or SSE2) instead. Which one is
+ * faster depends on the row lengths and the packetsize, choose_xor_flags
+ * times both on a schedule.
+ */
+class ErasureCodeJerasureKernel {
+public:
+  // rows with more sources are split into several kernel calls
+  static const int max_row_sources = 16;
+  // smaller packets are left in the cache even when streaming, same
+  // as EC_ISA_STREAM_MIN_SIZE for the isa_xor rows
+  static const int min_stream_packetsize = 1024;
+  // JERASURE_KERNEL_FLAGS bit, ignored when have_isa_xor() is false
+  static const int isa_xor = 0x100;
+  static const int choose_rounds = 3;   // fastest of, engines interleaved
+  static const int choose_bytes = 1 << 18;  // per chunk, at least a stripe
+
+  explicit ErasureCodeJerasureKernel(const jerasure_flat_schedule *flat);
+
+  void run(char **ptrs, int flags) const;
+
+  int get_row_count() const { return rows.size(); }
+
+  static bool have_isa_xor();
+  // 0 or isa_xor, whichever encodes faster with flat on this machine
+  static int choose_xor_flags(int k, int m, int w, jerasure_flat_schedule *flat);
+
+  // jerasure_flat_schedule hooks
+  static void specialize(jerasure_flat_schedule *flat);
+  static void run_kernel(char **ptrs, jerasure_flat_schedule *flat, int flags);
+  static void release(jerasure_flat_schedule *flat);
+
+private:
+  typedef void (*row_kernel_t)(char *dst, char * const *srcs, int packetsize);
+
+  struct row_t {
+    int dst;
+    int dst_off;
+    int first;   // index of the first source in src / src_off
+    int count;   // number of sources
+    bool accumulate;  // dst is xored into, not overwritten
+    row_kernel_t kernel;
+    row_kernel_t stream_kernel;  // NULL if the packet is read later
+  };
+
+  int packetsize;
+  std::vector<row_t> rows;
+  std::vector<int> src;
+  std::vector<int> src_off;
+
+  void add_row(int dst, int dst_off, bool accumulate,
+	       const std::vector<int> &row_src,
+	       const std::vector<int> &row_src_off);
+  void find_final_rows();
+  static row_kernel_t get_row_kernel(int count, bool accumulate);
+  static row_kernel_t get_stream_row_kernel(int count, bool accumulate);
+};
+
+#endif
@@ -0,0 +1,143 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sstream>
+#include "common/ceph_time.h"
+#include "common/debug.h"
+#include "ErasureCodeJerasurePacketsizeTuner.h"
+extern "C" {
+#include "jerasure.h"
+}
+
+#define dout_context g_ceph_context
+#define dout_subsys ceph_subsys_osd
+#undef dout_prefix
+#define dout_prefix _prefix(_dout)
+
+static ostream& _prefix(std::ostream* _dout)
+{
+  return *_dout << "ErasureCodeJerasurePacketsizeTuner: ";
+}
+
+const int ErasureCodeJerasurePacketsizeTuner::candidates[] = {
+  512, 1024, 2048, 4096, 8192
+};
+const int ErasureCodeJerasurePacketsizeTuner::candidates_count =
+  sizeof(candidates) / sizeof(candidates[0]);
+
+int ErasureCodeJerasurePacketsizeTuner::tune(int k, int m, int w,
+					     int *bitmatrix)
+{
+  int erasures[] = { 0, -1 };
+  int **encoding = jerasure_smart_bitmatrix_to_schedule(k, m, w, bitmatrix);
+  int **decoding = jerasure_generate_decoding_schedule(k, m, w, bitmatrix,
+						       erasures, 1);
+  jerasure_flat_schedule *encode[candidates_count];
+  jerasure_flat_schedule *decode[candidates_count];
+  bool ok = encoding && decoding;
+  for (int c = 0; c < candidates_count; c++) {
+    encode[c] = ok ? jerasure_schedule_to_flat(encoding, candidates[c]) : NULL;
+    decode[c] = ok ? jerasure_schedule_to_flat(decoding, candidates[c]) : NULL;
+    ok = ok && encode[c] && decode[c];
+  }
+  if (encoding)
+    jerasure_free_schedule(encoding);
+  if (decoding)
+    jerasure_free_schedule(decoding);
+
+  // every candidate divides the chunk, so they all run over the same bytes
+  const int size = w * candidates[candidates_count - 1] * stripes;
+  char *buffer = NULL;
+  if (ok && posix_memalign((void **)&buffer, 64, (size_t)(k + m) * size))
+    buffer = NULL;
+
+  int r = -ENOMEM;
+  if (ok && buffer) {
+    uint32_t x = 1;
+    for (size_t i = 0; i < (size_t)k * size; i++) {
+      x = x * 1103515245 + 12345;
+      buffer[i] = x >> 16;
+    }
+    char *data[k];
+    char *coding[m];
+    for (int i = 0; i < k; i++)
+      data[i] = buffer + (size_t)i * size;
+    for (int i = 0; i < m; i++)
+      coding[i] = buffer + (size_t)(k + i) * size;
+
+    int64_t ns[candidates_count];
+    for (int round = 0; round < rounds; round++) {
+      for (int c = 0; c < candidates_count; c++) {
+	ceph::mono_time start = ceph::mono_clock::now();
+	for (int pass = 0; pass < passes; pass++) {
+	  jerasure_flat_schedule_encode(k, m, w, encode[c], data, coding, size, 0);
+	  jerasure_flat_schedule_decode(k, m, w, decode[c], erasures,
+					data, coding, size, 0);
+	}
+	int64_t took = std::chrono::duration_cast<std::chrono::nanoseconds>(
+	  ceph::mono_clock::now() - start).count();
+	if (round == 0 || took < ns[c])
+	  ns[c] = took;
+      }
+    }
+
+    int64_t fastest = ns[0];
+    for (int c = 1; c < candidates_count; c++)
+      if (ns[c] < fastest)
+	fastest = ns[c];
+    for (int c = 0; c < candidates_count; c++) {
+      dout(10) << __func__ << " k=" << k << " m=" << m << " w=" << w
+	       << " packetsize=" << candidates[c] << " "
+	       << (int64_t)k * size * passes * 1000 / (ns[c] ? ns[c] : 1)
+	       << " MB/s" << dendl;
+      if (ns[c] * 100 <= fastest * (100 + tie_percent))
+	r = candidates[c];
+    }
+  } else if (!encoding || !decoding) {
+    r = -EINVAL;
+  }
+
+  free(buffer);
+  for (int c = 0; c < candidates_count; c++) {
+    if (encode[c])
+      jerasure_free_flat_schedule(encode[c]);
+    if (decode[c])
+      jerasure_free_flat_schedule(decode[c]);
+  }
+  return r;
+}
+
+int ErasureCodeJerasurePacketsizeTuner::get_packetsize(const char *technique,
+						       int k, int m, int w,
+						       int *bitmatrix)
+{
+  std::ostringstream key;
+  key << technique << "/" << k << "/" << m << "/" << w;
+  {
+    Mutex::Locker l(lock);
+    std::map<std::string, int>::iterator i = packetsizes.find(key.str());
+    if (i != packetsizes.end())
+      return i->second;
+  }
+  // benchmarking takes a while, do not hold the lock meanwhile: when two
+  // instances race the first result is kept
+  int packetsize = tune(k, m, w, bitmatrix);
+  if (packetsize < 0)
+    return packetsize;
+  dout(1) << __func__ << " " << key.str() << " packetsize=" << packetsize
+	  << dendl;
+  Mutex::Locker l(lock);
+  return packetsizes.insert(std::make_pair(key.str(), packetsize)).first->second;
+}
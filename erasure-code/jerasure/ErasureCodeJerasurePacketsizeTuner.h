@@ -0,0 +1,70 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#ifndef CEPH_ERASURE_CODE_JERASURE_PACKETSIZE_TUNER_H
+#define CEPH_ERASURE_CODE_JERASURE_PACKETSIZE_TUNER_H
+
+#include <map>
+#include <string>
+#include "common/Mutex.h"
+
+/*
+ * Pick the packetsize of a bitmatrix technique for this machine,
+ * enabled with jerasure-packetsize-autotune=true on a profile that
+ * does not set packetsize.
+ *
+ * A smaller packetsize keeps the k + m packets of a stripe in cache, a
+ * larger one interprets the schedule less often. Each candidate is
+ * timed encoding and decoding a data chunk with its smart schedules,
+ * the same flat schedules the hybrid decode runs, and the fastest
+ * wins. The hybrid decode also reads one packetsize symbol per pread,
+ * so a larger candidate within tie_percent of the fastest is preferred.
+ *
+ * Every candidate is a multiple of 16 bytes, which is what the
+ * alignment of the Cauchy and Liberation techniques and the streaming
+ * schedule kernels need. The largest is kept at 8192 because the
+ * stripe alignment, k * w * packetsize * sizeof(int), pads small
+ * objects.
+ *
+ * The caller writes the result in the profile: it is chosen once,
+ * where the profile is created, and the OSDs read it back instead of
+ * tuning on hardware of their own: an OSD given an autotune profile
+ * without a packetsize warns and uses the default packetsize.
+ */
+class ErasureCodeJerasurePacketsizeTuner {
+public:
+  static const int candidates[];
+  static const int candidates_count;
+  static const int tie_percent = 5;
+  static const int rounds = 3;        // fastest of, candidates interleaved
+  static const int passes = 8;        // encodes and decodes per timing
+  static const int stripes = 4;       // of the largest candidate per chunk
+
+  ErasureCodeJerasurePacketsizeTuner() :
+    lock("ErasureCodeJerasurePacketsizeTuner::lock")
+  {}
+
+  /*
+   * Return the packetsize for technique, k, m and w, tuning with
+   * bitmatrix on the first call. Returns a negative errno on failure.
+   */
+  int get_packetsize(const char *technique, int k, int m, int w,
+		     int *bitmatrix);
+
+  static int tune(int k, int m, int w, int *bitmatrix);
+
+private:
+  Mutex lock; // protects packetsizes
+  std::map<std::string, int> packetsizes;
+};
+
+#endif
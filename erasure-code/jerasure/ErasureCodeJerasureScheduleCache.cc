@@ -0,0 +1,109 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#include <algorithm>
+#include <sstream>
+#include "common/debug.h"
+#include "ErasureCodeJerasureScheduleCache.h"
+
+#define dout_context g_ceph_context
+#define dout_subsys ceph_subsys_osd
+#undef dout_prefix
+#define dout_prefix _prefix(_dout)
+
+static ostream& _prefix(std::ostream* _dout)
+{
+  return *_dout << "ErasureCodeJerasureScheduleCache: ";
+}
+
+std::string ErasureCodeJerasureScheduleCache::profile_key(const char *technique,
+							  int k, int m, int w,
+							  int packetsize)
+{
+  std::ostringstream key;
+  key << technique << "/" << k << "/" << m << "/" << w << "/" << packetsize;
+  return key.str();
+}
+
+std::string ErasureCodeJerasureScheduleCache::erasures_signature(const int *erasures)
+{
+  std::vector<int> erased;
+  for (int i = 0; erasures[i] != -1; i++)
+    erased.push_back(erasures[i]);
+  // the schedule does not depend on the order erasures are listed in
+  std::sort(erased.begin(), erased.end());
+  std::ostringstream signature;
+  for (auto e : erased)
+    signature << "-" << e;
+  return signature.str();
+}
+
+ErasureCodeJerasureScheduleCache::schedule_ref
+ErasureCodeJerasureScheduleCache::get_decoding_schedule(const std::string &profile,
+							int k, int m, int w,
+							int packetsize,
+							int *bitmatrix,
+							int *erasures)
+{
+  std::string signature = erasures_signature(erasures);
+  {
+    Mutex::Locker l(lock);
+    profile_schedules_t &p = profiles[profile];
+    lru_map_t::iterator i = p.schedules.find(signature);
+    if (i != p.schedules.end()) {
+      dout(20) << __func__ << " " << profile << " cached " << signature << dendl;
+      p.lru.splice(p.lru.begin(), p.lru, i->second.first);
+      return i->second.second;
+    }
+  }
+
+  // build the schedule without holding the lock, inverting the
+  // bitmatrix is the expensive part
+  int **generated = jerasure_generate_decoding_schedule(k, m, w, bitmatrix,
+							erasures, 1);
+  if (generated == NULL)
+    return schedule_ref();
+  jerasure_flat_schedule *flat = jerasure_schedule_to_flat(generated, packetsize);
+  jerasure_free_schedule(generated);
+  if (flat == NULL)
+    return schedule_ref();
+  schedule_ref schedule = std::make_shared<schedule_t>(flat);
+
+  Mutex::Locker l(lock);
+  profile_schedules_t &p = profiles[profile];
+  lru_map_t::iterator i = p.schedules.find(signature);
+  if (i != p.schedules.end()) {
+    // another decode raced us to it
+    p.lru.splice(p.lru.begin(), p.lru, i->second.first);
+    return i->second.second;
+  }
+  if ((int)p.lru.size() >= decoding_schedules_lru_length) {
+    dout(12) << __func__ << " " << profile << " evict " << p.lru.back() << dendl;
+    p.schedules.erase(p.lru.back());
+    p.lru.pop_back();
+  }
+  p.lru.push_front(signature);
+  p.schedules[signature] = std::make_pair(p.lru.begin(), schedule);
+  dout(12) << __func__ << " " << profile << " store " << signature
+	   << " operations " << schedule->get_operation_count()
+	   << " cache size " << p.lru.size() << dendl;
+  return schedule;
+}
+
+int ErasureCodeJerasureScheduleCache::get_decoding_schedule_cache_size(const std::string &profile)
+{
+  Mutex::Locker l(lock);
+  std::map<std::string, profile_schedules_t>::iterator p = profiles.find(profile);
+  if (p == profiles.end())
+    return 0;
+  return p->second.lru.size();
+}
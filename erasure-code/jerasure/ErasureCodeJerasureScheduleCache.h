@@ -0,0 +1,86 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#ifndef CEPH_ERASURE_CODE_JERASURE_SCHEDULE_CACHE_H
+#define CEPH_ERASURE_CODE_JERASURE_SCHEDULE_CACHE_H
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "common/Mutex.h"
+extern "C" {
+#include "jerasure.h"
+}
+
+/*
+ * LRU cache of jerasure decoding schedules, shared by every bitmatrix
+ * codec created by the jerasure plugin.
+ *
+ * jerasure_schedule_decode_lazy inverts the bitmatrix and builds a
+ * smart schedule on each call, and jerasure_generate_schedule_cache
+ * only handles m = 2.  The bitmatrix is fully determined by the
+ * technique, k, m and w, so one cache per such profile key (plus the
+ * packetsize the flat offsets are computed for) holds the schedule for
+ * each erasure signature, for any m.
+ */
+class ErasureCodeJerasureScheduleCache {
+public:
+  static const int decoding_schedules_lru_length = 256;
+
+  // a flat jerasure schedule, its byte offsets are those of the
+  // packetsize it was requested for
+  struct schedule_t {
+    jerasure_flat_schedule *flat;
+
+    explicit schedule_t(jerasure_flat_schedule *_flat) : flat(_flat) {}
+    ~schedule_t() { jerasure_free_flat_schedule(flat); }
+    jerasure_flat_schedule *get() { return flat; }
+    int get_operation_count() const { return flat->nops; }
+  };
+  typedef std::shared_ptr<schedule_t> schedule_ref;
+
+  ErasureCodeJerasureScheduleCache() :
+    lock("ErasureCodeJerasureScheduleCache::lock")
+  {}
+
+  static std::string profile_key(const char *technique, int k, int m, int w,
+				 int packetsize);
+  static std::string erasures_signature(const int *erasures);
+
+  /*
+   * Return the decoding schedule for the -1 terminated erasures,
+   * generating and caching it on a miss. Returns a null reference
+   * if the erasures cannot be decoded.
+   */
+  schedule_ref get_decoding_schedule(const std::string &profile,
+				     int k, int m, int w, int packetsize,
+				     int *bitmatrix, int *erasures);
+
+  int get_decoding_schedule_cache_size(const std::string &profile);
+
+private:
+  typedef std::list<std::string> lru_list_t;
+  typedef std::pair<lru_list_t::iterator, schedule_ref> lru_entry_t;
+  typedef std::map<std::string, lru_entry_t> lru_map_t;
+
+  struct profile_schedules_t {
+    lru_list_t lru;
+    lru_map_t schedules;
+  };
+
+  Mutex lock; // protects profiles
+  std::map<std::string, profile_schedules_t> profiles;
+};
+
+#endif
@@ -17,8 +17,10 @@
 
 #include "ceph_ver.h"
 #include "common/debug.h"
+#include "include/msgr.h"
 #include "ErasureCodeJerasure.h"
 #include "ErasureCodePluginJerasure.h"
+#include "ErasureCodeJerasureKernel.h"
 #include "jerasure_init.h"
 
 #define dout_context g_ceph_context
@@ -61,6 +63,12 @@ int ErasureCodePluginJerasure::factory(const std::string& directory,
 	   << dendl;
       return -ENOENT;
     }
+    interface->schedule_cache = &scache;
+    interface->cauchy_search = &cauchy_search;
+    interface->packetsize_tuner = &packetsize_tuner;
+    // the monitors create and normalize the profiles, the OSDs read them
+    interface->creates_profile =
+      g_ceph_context->get_module_type() != CEPH_ENTITY_TYPE_OSD;
     dout(20) << __func__ << ": " << profile << dendl;
     int r = interface->init(profile, ss);
     if (r) {
@@ -83,6 +91,7 @@ int __erasure_code_init(char *plugin_name, char *directory)
   if (r) {
     return -r;
   }
+  jerasure_set_flat_schedule_specializer(ErasureCodeJerasureKernel::specialize);
   return instance.add(plugin_name, new ErasureCodePluginJerasure());
 }
 
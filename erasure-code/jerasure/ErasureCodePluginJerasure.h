@@ -19,9 +19,16 @@
 #define CEPH_ERASURE_CODE_PLUGIN_JERASURE_H
 
 #include "erasure-code/ErasureCodePlugin.h"
+#include "ErasureCodeJerasureScheduleCache.h"
+#include "ErasureCodeJerasureCauchySearch.h"
+#include "ErasureCodeJerasurePacketsizeTuner.h"
 
 class ErasureCodePluginJerasure : public ErasureCodePlugin {
 public:
+  ErasureCodeJerasureScheduleCache scache;
+  ErasureCodeJerasureCauchySearch cauchy_search;
+  ErasureCodeJerasurePacketsizeTuner packetsize_tuner;
+
   int factory(const std::string& directory,
 		      ErasureCodeProfile &profile,
 		      ErasureCodeInterfaceRef *erasure_code,
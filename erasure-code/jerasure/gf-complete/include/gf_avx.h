@@ -0,0 +1,25 @@
+/*
+ * GF-Complete: A Comprehensive Open Source Library for Galois Field Arithmetic
+ * James S. Plank, Ethan L. Miller, Kevin M. Greenan,
+ * Benjamin A. Arnold, John A. Burnum, Adam W. Disney, Allen C. McBride.
+ *
+ * gf_avx.h
+ *
+ * AVX2, AVX-512 and GFNI region routines for w=8, 16 and 32, selected
+ * at runtime from what gf_cpu_identify() found.
+ */
+
+#pragma once
+
+#include "gf_int.h"
+
+/* If the CPU has a wider kernel than the one gf_wX_init() picked for
+   standard-layout regions, save the current multiply_region in
+   h->simd_fallback and install the wide one.  Always returns 1. */
+
+extern int gf_avx_region_init(gf_t *gf);
+
+/* XOR as many leading bytes of src into dest as the widest available
+   vector allows, and return how many bytes were done. */
+
+extern int gf_avx_region_xor(void *src, void *dest, int bytes);
@@ -16,5 +16,8 @@ extern int gf_cpu_supports_intel_ssse3;
 extern int gf_cpu_supports_intel_sse3;
 extern int gf_cpu_supports_intel_sse2;
 extern int gf_cpu_supports_arm_neon;
+extern int gf_cpu_supports_intel_avx2;
+extern int gf_cpu_supports_intel_avx512;
+extern int gf_cpu_supports_intel_gfni;
 
 void gf_cpu_identify(void);
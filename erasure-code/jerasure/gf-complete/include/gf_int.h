@@ -30,6 +30,7 @@ typedef struct {
   int arg2;
   gf_t *base_gf;
   void *private;
+  gf_region simd_fallback;  /* multiply_region replaced by gf_avx_region_init() */
 #ifdef DEBUG_FUNCTIONS
   const char *multiply;
   const char *divide;
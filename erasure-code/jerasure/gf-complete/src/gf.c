@@ -13,6 +13,7 @@
 #include <stdlib.h>
 #include <assert.h>
 #include "gf_cpu.h"
+#include "gf_avx.h"
 
 int _gf_errno = GF_E_DEFAULT;
 
@@ -513,9 +514,9 @@ int gf_init_hard(gf_t *gf, int w, int mult_type,
 
   switch(w) {
     case 4: return gf_w4_init(gf);
-    case 8: return gf_w8_init(gf);
-    case 16: return gf_w16_init(gf);
-    case 32: return gf_w32_init(gf);
+    case 8: return gf_w8_init(gf) && gf_avx_region_init(gf);
+    case 16: return gf_w16_init(gf) && gf_avx_region_init(gf);
+    case 32: return gf_w32_init(gf) && gf_avx_region_init(gf);
     case 64: return gf_w64_init(gf);
     case 128: return gf_w128_init(gf);
     default: return gf_wgen_init(gf);
@@ -859,6 +860,8 @@ void gf_set_region_data(gf_region_data *rd,
 
   uls %= a;
   if (uls != 0) uls = (a-uls);
+  /* a region that ends before the boundary is all initial alignment */
+  if (uls > (unsigned long) bytes) uls = bytes;
   rd->s_start = (uint8_t *)rd->src + uls;
   rd->d_start = (uint8_t *)rd->dest + uls;
   bytes -= uls;
@@ -890,6 +893,9 @@ void gf_multby_zero(void *dest, int bytes, int xor)
    should be optimized by the system.  Otherwise, try to do the xor
    in the following order:
 
+   If you have AVX2 or AVX-512 instructions, use unaligned loads and
+   stores of the widest vectors for as much of the region as they cover.
+
    If src and dest are aligned with respect to each other on 16-byte
    boundaries and you have SSE instructions, then use aligned SSE
    instructions.
@@ -916,12 +922,21 @@ void gf_multby_one(void *src, void *dest, int bytes, int xor)
   uint8_t *s8, *d8;
   uint64_t *s64, *d64, *dtop64;
   gf_region_data rd;
+  int done;
 
   if (!xor) {
     if (dest != src)
       memcpy(dest, src, bytes);
     return;
   }
+
+  /* AVX2 / AVX-512 take the bulk, the code below finishes the tail */
+  done = gf_avx_region_xor(src, dest, bytes);
+  if (done == bytes) return;
+  src = (uint8_t *) src + done;
+  dest = (uint8_t *) dest + done;
+  bytes -= done;
+
   uls = (unsigned long) src;
   uld = (unsigned long) dest;
 
@@ -0,0 +1,299 @@
+/*
+ * GF-Complete: A Comprehensive Open Source Library for Galois Field Arithmetic
+ * James S. Plank, Ethan L. Miller, Kevin M. Greenan,
+ * Benjamin A. Arnold, John A. Burnum, Adam W. Disney, Allen C. McBride.
+ *
+ * gf_avx.c
+ *
+ * AVX2, AVX-512 and GFNI region routines for w=8, 16 and 32.
+ *
+ * These are compiled with per-function target attributes, so a binary
+ * built for a baseline x86_64 still carries them; which one runs is
+ * decided from gf_cpu_identify() the first time a field is created.
+ * The wide kernels handle whole vectors of words and hand the tail of
+ * the region to the multiply_region the field would have used anyway.
+ */
+
+#include "gf_int.h"
+#include "gf_cpu.h"
+#include "gf_avx.h"
+#include <stdint.h>
+
+#if defined(INTEL_AVX2) || defined(INTEL_AVX512)
+
+#include <immintrin.h>
+
+#define GF_AVX_KERNEL_NONE     0
+#define GF_AVX_KERNEL_AVX2     1
+#define GF_AVX_KERNEL_AVX512   2
+#define GF_AVX_KERNEL_GFNI256  3
+#define GF_AVX_KERNEL_GFNI512  4
+
+static int gf_avx_kernel = -1;
+
+#if defined(INTEL_AVX2)
+
+#define GF_AVX_TARGET      "avx2"
+#if defined(INTEL_GFNI)
+#define GF_AVX_GFNI_TARGET "avx2,gfni"
+#define GF_V_AFFINE(x, a)  _mm256_gf2p8affine_epi64_epi8(x, a, 0)
+#endif
+#define GF_AVX_FN(name)    gf_avx2_##name
+#define GF_VEC             __m256i
+#define GF_VBYTES          32
+#define GF_V_LOADU(p)      _mm256_loadu_si256((const __m256i *) (p))
+#define GF_V_STOREU(p, v)  _mm256_storeu_si256((__m256i *) (p), v)
+#define GF_V_XOR(a, b)     _mm256_xor_si256(a, b)
+#define GF_V_AND(a, b)     _mm256_and_si256(a, b)
+#define GF_V_ZERO()        _mm256_setzero_si256()
+#define GF_V_SET1_8(x)     _mm256_set1_epi8(x)
+#define GF_V_SET1_16(x)    _mm256_set1_epi16(x)
+#define GF_V_SET1_32(x)    _mm256_set1_epi32(x)
+#define GF_V_SET1_64(x)    _mm256_set1_epi64x(x)
+#define GF_V_BCAST128(p)   _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) (p)))
+#define GF_V_SHUFFLE8(t, x) _mm256_shuffle_epi8(t, x)
+#define GF_V_SRLI16(a, n)  _mm256_srli_epi16(a, n)
+#define GF_V_SRLI32(a, n)  _mm256_srli_epi32(a, n)
+#define GF_V_PACKUS16(a, b) _mm256_packus_epi16(a, b)
+#define GF_V_PACKUS32(a, b) _mm256_packus_epi32(a, b)
+#define GF_V_UNPACKLO8(a, b) _mm256_unpacklo_epi8(a, b)
+#define GF_V_UNPACKHI8(a, b) _mm256_unpackhi_epi8(a, b)
+#define GF_V_UNPACKLO16(a, b) _mm256_unpacklo_epi16(a, b)
+#define GF_V_UNPACKHI16(a, b) _mm256_unpackhi_epi16(a, b)
+
+#include "gf_avx_region.h"
+
+#undef GF_AVX_TARGET
+#undef GF_AVX_GFNI_TARGET
+#undef GF_V_AFFINE
+#undef GF_AVX_FN
+#undef GF_VEC
+#undef GF_VBYTES
+#undef GF_V_LOADU
+#undef GF_V_STOREU
+#undef GF_V_XOR
+#undef GF_V_AND
+#undef GF_V_ZERO
+#undef GF_V_SET1_8
+#undef GF_V_SET1_16
+#undef GF_V_SET1_32
+#undef GF_V_SET1_64
+#undef GF_V_BCAST128
+#undef GF_V_SHUFFLE8
+#undef GF_V_SRLI16
+#undef GF_V_SRLI32
+#undef GF_V_PACKUS16
+#undef GF_V_PACKUS32
+#undef GF_V_UNPACKLO8
+#undef GF_V_UNPACKHI8
+#undef GF_V_UNPACKLO16
+#undef GF_V_UNPACKHI16
+
+#endif /* INTEL_AVX2 */
+
+#if defined(INTEL_AVX512)
+
+#define GF_AVX_TARGET      "avx512f,avx512bw"
+#if defined(INTEL_GFNI)
+#define GF_AVX_GFNI_TARGET "avx512f,avx512bw,gfni"
+#define GF_V_AFFINE(x, a)  _mm512_gf2p8affine_epi64_epi8(x, a, 0)
+#endif
+#define GF_AVX_FN(name)    gf_avx512_##name
+#define GF_VEC             __m512i
+#define GF_VBYTES          64
+#define GF_V_LOADU(p)      _mm512_loadu_si512((const void *) (p))
+#define GF_V_STOREU(p, v)  _mm512_storeu_si512((void *) (p), v)
+#define GF_V_XOR(a, b)     _mm512_xor_si512(a, b)
+#define GF_V_AND(a, b)     _mm512_and_si512(a, b)
+#define GF_V_ZERO()        _mm512_setzero_si512()
+#define GF_V_SET1_8(x)     _mm512_set1_epi8(x)
+#define GF_V_SET1_16(x)    _mm512_set1_epi16(x)
+#define GF_V_SET1_32(x)    _mm512_set1_epi32(x)
+#define GF_V_SET1_64(x)    _mm512_set1_epi64(x)
+#define GF_V_BCAST128(p)   _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *) (p)))
+#define GF_V_SHUFFLE8(t, x) _mm512_shuffle_epi8(t, x)
+#define GF_V_SRLI16(a, n)  _mm512_srli_epi16(a, n)
+#define GF_V_SRLI32(a, n)  _mm512_srli_epi32(a, n)
+#define GF_V_PACKUS16(a, b) _mm512_packus_epi16(a, b)
+#define GF_V_PACKUS32(a, b) _mm512_packus_epi32(a, b)
+#define GF_V_UNPACKLO8(a, b) _mm512_unpacklo_epi8(a, b)
+#define GF_V_UNPACKHI8(a, b) _mm512_unpackhi_epi8(a, b)
+#define GF_V_UNPACKLO16(a, b) _mm512_unpacklo_epi16(a, b)
+#define GF_V_UNPACKHI16(a, b) _mm512_unpackhi_epi16(a, b)
+
+#include "gf_avx_region.h"
+
+#endif /* INTEL_AVX512 */
+
+static int gf_avx_select_kernel(void)
+{
+  int kernel = GF_AVX_KERNEL_NONE;
+
+#if defined(INTEL_AVX2)
+  if (gf_cpu_supports_intel_avx2) kernel = GF_AVX_KERNEL_AVX2;
+#if defined(INTEL_GFNI)
+  if (gf_cpu_supports_intel_avx2 && gf_cpu_supports_intel_gfni) kernel = GF_AVX_KERNEL_GFNI256;
+#endif
+#endif
+#if defined(INTEL_AVX512)
+  if (gf_cpu_supports_intel_avx512) kernel = GF_AVX_KERNEL_AVX512;
+#if defined(INTEL_GFNI)
+  if (gf_cpu_supports_intel_avx512 && gf_cpu_supports_intel_gfni) kernel = GF_AVX_KERNEL_GFNI512;
+#endif
+#endif
+  return kernel;
+}
+
+/* tables[((i*B + j)*2 + h)*16 + x] is byte i of (x << (8j + 4h)) * val */
+
+static void gf_avx_nibble_tables(gf_t *gf, gf_val_32_t val, int B, uint8_t *tables)
+{
+  gf_val_32_t p;
+  int i, j, h, x;
+
+  for (j = 0; j < B; j++) {
+    for (h = 0; h < 2; h++) {
+      for (x = 0; x < 16; x++) {
+        p = gf->multiply.w32(gf, ((gf_val_32_t) x) << (8*j + 4*h), val);
+        for (i = 0; i < B; i++) tables[((i*B + j)*2 + h)*16 + x] = (p >> (8*i)) & 0xff;
+      }
+    }
+  }
+}
+
+#if defined(INTEL_GFNI)
+
+/* matrices[i*B + j] is the gf2p8affine matrix taking byte j of a word
+   to its contribution to byte i of the word times val.  Row r of the
+   matrix, which computes bit r of the result, sits in byte 7-r. */
+
+static void gf_avx_affine_matrices(gf_t *gf, gf_val_32_t val, int B, uint64_t *matrices)
+{
+  gf_val_32_t p;
+  int i, j, b, r;
+
+  memset(matrices, 0, sizeof(uint64_t)*B*B);
+  for (j = 0; j < B; j++) {
+    for (b = 0; b < 8; b++) {
+      p = gf->multiply.w32(gf, ((gf_val_32_t) 1) << (8*j + b), val);
+      for (i = 0; i < B; i++) {
+        for (r = 0; r < 8; r++) {
+          if ((p >> (8*i + r)) & 1) matrices[i*B + j] |= ((uint64_t) 1) << (8*(7-r) + b);
+        }
+      }
+    }
+  }
+}
+
+#endif
+
+static void gf_avx_multiply_region(gf_t *gf, void *src, void *dest, gf_val_32_t val, int bytes, int xor)
+{
+  gf_internal_t *h;
+  uint8_t tables[4*4*2*16];
+#if defined(INTEL_GFNI)
+  uint64_t matrices[4*4];
+#endif
+  int B, done;
+
+  if (val == 0) { gf_multby_zero(dest, bytes, xor); return; }
+  if (val == 1) { gf_multby_one(src, dest, bytes, xor); return; }
+
+  h = (gf_internal_t *) gf->scratch;
+  B = h->w / 8;
+  done = 0;
+
+  switch (gf_avx_kernel) {
+#if defined(INTEL_AVX2) && defined(INTEL_GFNI)
+    case GF_AVX_KERNEL_GFNI256:
+      gf_avx_affine_matrices(gf, val, B, matrices);
+      done = gf_avx2_gfni_region(src, dest, bytes, matrices, xor, B);
+      break;
+#endif
+#if defined(INTEL_AVX512) && defined(INTEL_GFNI)
+    case GF_AVX_KERNEL_GFNI512:
+      gf_avx_affine_matrices(gf, val, B, matrices);
+      done = gf_avx512_gfni_region(src, dest, bytes, matrices, xor, B);
+      break;
+#endif
+#if defined(INTEL_AVX2)
+    case GF_AVX_KERNEL_AVX2:
+      gf_avx_nibble_tables(gf, val, B, tables);
+      done = gf_avx2_shuffle_region(src, dest, bytes, tables, xor, B);
+      break;
+#endif
+#if defined(INTEL_AVX512)
+    case GF_AVX_KERNEL_AVX512:
+      gf_avx_nibble_tables(gf, val, B, tables);
+      done = gf_avx512_shuffle_region(src, dest, bytes, tables, xor, B);
+      break;
+#endif
+    default:
+      break;
+  }
+
+  /* done is a whole number of vectors, so src and dest keep their
+     alignment relative to each other */
+  if (done < bytes) {
+    h->simd_fallback.w32(gf, (uint8_t *) src + done, (uint8_t *) dest + done, val, bytes - done, xor);
+  }
+}
+
+int gf_avx_region_init(gf_t *gf)
+{
+  gf_internal_t *h;
+
+  h = (gf_internal_t *) gf->scratch;
+  h->simd_fallback.w32 = NULL;
+
+  if (gf_avx_kernel < 0) gf_avx_kernel = gf_avx_select_kernel();
+  if (gf_avx_kernel == GF_AVX_KERNEL_NONE) return 1;
+
+  /* only the standard memory layout is handled */
+  if (h->w != 8 && h->w != 16 && h->w != 32) return 1;
+  /* at w=32 the byte transposition costs more than 256-bit vectors
+     gain over the SSE split tables, only the AVX-512 kernels pay off */
+  if (h->w == 32 && gf_avx_kernel != GF_AVX_KERNEL_AVX512 &&
+      gf_avx_kernel != GF_AVX_KERNEL_GFNI512) return 1;
+  if (h->region_type & (GF_REGION_NOSIMD | GF_REGION_ALTMAP | GF_REGION_CAUCHY)) return 1;
+  if (gf->multiply_region.w32 == NULL || gf->multiply.w32 == NULL) return 1;
+
+  h->simd_fallback.w32 = gf->multiply_region.w32;
+  gf->multiply_region.w32 = gf_avx_multiply_region;
+  return 1;
+}
+
+int gf_avx_region_xor(void *src, void *dest, int bytes)
+{
+  if (gf_avx_kernel < 0) gf_avx_kernel = gf_avx_select_kernel();
+
+  switch (gf_avx_kernel) {
+#if defined(INTEL_AVX512)
+    case GF_AVX_KERNEL_AVX512:
+    case GF_AVX_KERNEL_GFNI512:
+      return gf_avx512_region_xor(src, dest, bytes);
+#endif
+#if defined(INTEL_AVX2)
+    case GF_AVX_KERNEL_AVX2:
+    case GF_AVX_KERNEL_GFNI256:
+      return gf_avx2_region_xor(src, dest, bytes);
+#endif
+    default:
+      return 0;
+  }
+}
+
+#else /* !INTEL_AVX2 && !INTEL_AVX512 */
+
+int gf_avx_region_init(gf_t *gf)
+{
+  ((gf_internal_t *) gf->scratch)->simd_fallback.w32 = NULL;
+  return 1;
+}
+
+int gf_avx_region_xor(void *src, void *dest, int bytes)
+{
+  return 0;
+}
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ * GF-Complete: A Comprehensive Open Source Library for Galois Field Arithmetic
+ * James S. Plank, Ethan L. Miller, Kevin M. Greenan,
+ * Benjamin A. Arnold, John A. Burnum, Adam W. Disney, Allen C. McBride.
+ *
+ * gf_avx_region.h
+ *
+ * Region kernels written once for any vector width.  gf_avx.c includes
+ * this file once per instruction set after defining:
+ *
+ *   GF_AVX_TARGET        target attribute for the plain kernels
+ *   GF_AVX_GFNI_TARGET   target attribute for the GFNI kernel (optional)
+ *   GF_AVX_FN(name)      suffixes name for this instruction set
+ *   GF_VEC, GF_VBYTES    vector type and its size in bytes
+ *   GF_V_xxx             the intrinsics used below
+ *
+ * A region of w-bit words is handled B = w/8 vectors at a time.  The
+ * bytes of those words are first gathered into B byte planes (plane j
+ * holds byte j of every word) with pack instructions, the product is
+ * computed plane by plane, and the unpack instructions put the words
+ * back together.  Both pack and unpack only work within 128-bit lanes,
+ * so the round trip restores the original order at any vector width.
+ *
+ * With nibble tables, output plane i is the XOR over input planes j of
+ * shuffle(T[i][j][0], low nibble) ^ shuffle(T[i][j][1], high nibble).
+ * With GFNI, it is the XOR over j of affine(plane j, M[i][j]), where
+ * M[i][j] is the 8x8 bit matrix that maps byte j of a word to its
+ * contribution to byte i of the product.
+ */
+
+static inline __attribute__((always_inline, target(GF_AVX_TARGET)))
+void GF_AVX_FN(load_planes)(const uint8_t *p, GF_VEC *planes, const int B)
+{
+  GF_VEC v[4], m;
+  int i;
+
+  for (i = 0; i < B; i++) v[i] = GF_V_LOADU(p + i*GF_VBYTES);
+  if (B == 1) {
+    planes[0] = v[0];
+  } else if (B == 2) {
+    m = GF_V_SET1_16(0x00ff);
+    planes[0] = GF_V_PACKUS16(GF_V_AND(v[0], m), GF_V_AND(v[1], m));
+    planes[1] = GF_V_PACKUS16(GF_V_SRLI16(v[0], 8), GF_V_SRLI16(v[1], 8));
+  } else {
+    m = GF_V_SET1_32(0xff);
+#define GF_AVX_PLANE(j, shift) \
+    planes[j] = GF_V_PACKUS16( \
+      GF_V_PACKUS32(GF_V_AND(GF_V_SRLI32(v[0], shift), m), GF_V_AND(GF_V_SRLI32(v[1], shift), m)), \
+      GF_V_PACKUS32(GF_V_AND(GF_V_SRLI32(v[2], shift), m), GF_V_AND(GF_V_SRLI32(v[3], shift), m)))
+    GF_AVX_PLANE(0, 0);
+    GF_AVX_PLANE(1, 8);
+    GF_AVX_PLANE(2, 16);
+    GF_AVX_PLANE(3, 24);
+#undef GF_AVX_PLANE
+  }
+}
+
+static inline __attribute__((always_inline, target(GF_AVX_TARGET)))
+void GF_AVX_FN(store_planes)(uint8_t *p, GF_VEC *planes, const int B, int xor)
+{
+  GF_VEC v[4], l01, h01, l23, h23;
+  int i;
+
+  if (B == 1) {
+    v[0] = planes[0];
+  } else if (B == 2) {
+    v[0] = GF_V_UNPACKLO8(planes[0], planes[1]);
+    v[1] = GF_V_UNPACKHI8(planes[0], planes[1]);
+  } else {
+    l01 = GF_V_UNPACKLO8(planes[0], planes[1]);
+    h01 = GF_V_UNPACKHI8(planes[0], planes[1]);
+    l23 = GF_V_UNPACKLO8(planes[2], planes[3]);
+    h23 = GF_V_UNPACKHI8(planes[2], planes[3]);
+    v[0] = GF_V_UNPACKLO16(l01, l23);
+    v[1] = GF_V_UNPACKHI16(l01, l23);
+    v[2] = GF_V_UNPACKLO16(h01, h23);
+    v[3] = GF_V_UNPACKHI16(h01, h23);
+  }
+  for (i = 0; i < B; i++) {
+    if (xor) v[i] = GF_V_XOR(v[i], GF_V_LOADU(p + i*GF_VBYTES));
+    GF_V_STOREU(p + i*GF_VBYTES, v[i]);
+  }
+}
+
+static inline __attribute__((always_inline, target(GF_AVX_TARGET)))
+int GF_AVX_FN(shuffle_region_b)(uint8_t *s, uint8_t *d, int bytes,
+                                const uint8_t *tables, int xor, const int B)
+{
+  GF_VEC t[4][4][2], in[4], out[4], lo, hi, mask;
+  int i, j, done, step;
+
+  for (i = 0; i < B; i++) {
+    for (j = 0; j < B; j++) {
+      t[i][j][0] = GF_V_BCAST128(tables + ((i*B + j)*2)*16);
+      t[i][j][1] = GF_V_BCAST128(tables + ((i*B + j)*2 + 1)*16);
+    }
+  }
+  mask = GF_V_SET1_8(0x0f);
+  step = B*GF_VBYTES;
+
+  for (done = 0; done + step <= bytes; done += step) {
+    GF_AVX_FN(load_planes)(s + done, in, B);
+    for (i = 0; i < B; i++) out[i] = GF_V_ZERO();
+    for (j = 0; j < B; j++) {
+      lo = GF_V_AND(in[j], mask);
+      hi = GF_V_AND(GF_V_SRLI16(in[j], 4), mask);
+      for (i = 0; i < B; i++) {
+        out[i] = GF_V_XOR(out[i], GF_V_SHUFFLE8(t[i][j][0], lo));
+        out[i] = GF_V_XOR(out[i], GF_V_SHUFFLE8(t[i][j][1], hi));
+      }
+    }
+    GF_AVX_FN(store_planes)(d + done, out, B, xor);
+  }
+  return done;
+}
+
+static __attribute__((target(GF_AVX_TARGET)))
+int GF_AVX_FN(shuffle_region)(uint8_t *s, uint8_t *d, int bytes,
+                              const uint8_t *tables, int xor, int B)
+{
+  switch (B) {
+    case 1: return GF_AVX_FN(shuffle_region_b)(s, d, bytes, tables, xor, 1);
+    case 2: return GF_AVX_FN(shuffle_region_b)(s, d, bytes, tables, xor, 2);
+    default: return GF_AVX_FN(shuffle_region_b)(s, d, bytes, tables, xor, 4);
+  }
+}
+
+#ifdef GF_AVX_GFNI_TARGET
+
+static inline __attribute__((always_inline, target(GF_AVX_GFNI_TARGET)))
+int GF_AVX_FN(gfni_region_b)(uint8_t *s, uint8_t *d, int bytes,
+                             const uint64_t *matrices, int xor, const int B)
+{
+  GF_VEC mat[4][4], in[4], out[4];
+  int i, j, done, step;
+
+  for (i = 0; i < B; i++) {
+    for (j = 0; j < B; j++) mat[i][j] = GF_V_SET1_64(matrices[i*B + j]);
+  }
+  step = B*GF_VBYTES;
+
+  for (done = 0; done + step <= bytes; done += step) {
+    GF_AVX_FN(load_planes)(s + done, in, B);
+    for (i = 0; i < B; i++) {
+      out[i] = GF_V_AFFINE(in[0], mat[i][0]);
+      for (j = 1; j < B; j++) out[i] = GF_V_XOR(out[i], GF_V_AFFINE(in[j], mat[i][j]));
+    }
+    GF_AVX_FN(store_planes)(d + done, out, B, xor);
+  }
+  return done;
+}
+
+static __attribute__((target(GF_AVX_GFNI_TARGET)))
+int GF_AVX_FN(gfni_region)(uint8_t *s, uint8_t *d, int bytes,
+                           const uint64_t *matrices, int xor, int B)
+{
+  switch (B) {
+    case 1: return GF_AVX_FN(gfni_region_b)(s, d, bytes, matrices, xor, 1);
+    case 2: return GF_AVX_FN(gfni_region_b)(s, d, bytes, matrices, xor, 2);
+    default: return GF_AVX_FN(gfni_region_b)(s, d, bytes, matrices, xor, 4);
+  }
+}
+
+#endif
+
+static __attribute__((target(GF_AVX_TARGET)))
+int GF_AVX_FN(region_xor)(uint8_t *s, uint8_t *d, int bytes)
+{
+  int done;
+
+  for (done = 0; done + 2*GF_VBYTES <= bytes; done += 2*GF_VBYTES) {
+    GF_V_STOREU(d + done, GF_V_XOR(GF_V_LOADU(d + done), GF_V_LOADU(s + done)));
+    GF_V_STOREU(d + done + GF_VBYTES,
+                GF_V_XOR(GF_V_LOADU(d + done + GF_VBYTES), GF_V_LOADU(s + done + GF_VBYTES)));
+  }
+  for (; done + GF_VBYTES <= bytes; done += GF_VBYTES) {
+    GF_V_STOREU(d + done, GF_V_XOR(GF_V_LOADU(d + done), GF_V_LOADU(s + done)));
+  }
+  return done;
+}
@@ -19,6 +19,9 @@ int gf_cpu_supports_intel_ssse3 = 0;
 int gf_cpu_supports_intel_sse3 = 0;
 int gf_cpu_supports_intel_sse2 = 0;
 int gf_cpu_supports_arm_neon = 0;
+int gf_cpu_supports_intel_avx2 = 0;
+int gf_cpu_supports_intel_avx512 = 0;
+int gf_cpu_supports_intel_gfni = 0;
 
 #if defined(__x86_64__)
 
@@ -30,13 +33,27 @@ int gf_cpu_supports_arm_neon = 0;
 #define GF_CPU_SSSE3    (1 << 9)
 #define GF_CPU_SSE41    (1 << 19)
 #define GF_CPU_SSE42    (1 << 20)
+#define GF_CPU_OSXSAVE  (1 << 27)
 
 /* EDX */
 #define GF_CPU_SSE2     (1 << 26)
 
+/* Leaf 7 EBX */
+#define GF_CPU_AVX2     (1 << 5)
+#define GF_CPU_AVX512F  (1 << 16)
+#define GF_CPU_AVX512BW (1 << 30)
+
+/* Leaf 7 ECX */
+#define GF_CPU_GFNI     (1 << 8)
+
+/* XCR0: the OS saves the SSE/AVX state, and the AVX-512 opmask/ZMM state */
+#define GF_XCR0_AVX     (0x06)
+#define GF_XCR0_AVX512  (0xe6)
+
 #if defined(_MSC_VER)
 
 #define cpuid(info, x)    __cpuidex(info, x, 0)
+#define xgetbv0()         ((unsigned int) _xgetbv(0))
 
 #elif defined(__GNUC__)
 
@@ -45,6 +62,16 @@ void cpuid(int info[4], int InfoType){
     __cpuid_count(InfoType, 0, info[0], info[1], info[2], info[3]);
 }
 
+#if defined(INTEL_AVX2) || defined(INTEL_AVX512) || defined(INTEL_GFNI)
+static unsigned int xgetbv0(void)
+{
+  unsigned int eax, edx;
+  __asm__ volatile("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+  (void) edx;
+  return eax;
+}
+#endif
+
 #else
 
 #error please add a way to detect CPU SIMD support at runtime 
@@ -106,6 +133,47 @@ void gf_cpu_identify(void)
   }
 #endif
 
+#if defined(INTEL_AVX2) || defined(INTEL_AVX512) || defined(INTEL_GFNI)
+  if ((reg[2] & GF_CPU_OSXSAVE) != 0) {
+    unsigned int xcr0 = xgetbv0();
+    int reg7[4];
+
+    cpuid(reg7, 7);
+
+#if defined(INTEL_AVX2)
+    if ((xcr0 & GF_XCR0_AVX) == GF_XCR0_AVX && (reg7[1] & GF_CPU_AVX2) != 0 &&
+        !getenv("GF_COMPLETE_DISABLE_AVX2")) {
+        gf_cpu_supports_intel_avx2 = 1;
+#ifdef DEBUG_CPU_DETECTION
+        printf("#gf_cpu_supports_intel_avx2\n");
+#endif
+    }
+#endif
+
+#if defined(INTEL_AVX512)
+    if ((xcr0 & GF_XCR0_AVX512) == GF_XCR0_AVX512 &&
+        (reg7[1] & GF_CPU_AVX512F) != 0 && (reg7[1] & GF_CPU_AVX512BW) != 0 &&
+        !getenv("GF_COMPLETE_DISABLE_AVX512")) {
+        gf_cpu_supports_intel_avx512 = 1;
+#ifdef DEBUG_CPU_DETECTION
+        printf("#gf_cpu_supports_intel_avx512\n");
+#endif
+    }
+#endif
+
+#if defined(INTEL_GFNI)
+    /* only used together with AVX2 or AVX-512 */
+    if ((xcr0 & GF_XCR0_AVX) == GF_XCR0_AVX && (reg7[2] & GF_CPU_GFNI) != 0 &&
+        !getenv("GF_COMPLETE_DISABLE_GFNI")) {
+        gf_cpu_supports_intel_gfni = 1;
+#ifdef DEBUG_CPU_DETECTION
+        printf("#gf_cpu_supports_intel_gfni\n");
+#endif
+    }
+#endif
+  }
+#endif
+
   gf_cpu_identified = 1;
 }
 
@@ -0,0 +1,110 @@
+/*
+ * GF-Complete: A Comprehensive Open Source Library for Galois Field Arithmetic
+ * James S. Plank, Ethan L. Miller, Kevin M. Greenan,
+ * Benjamin A. Arnold, John A. Burnum, Adam W. Disney, Allen C. McBride.
+ *
+ * gf_region_unit.c
+ *
+ * Checks multiply_region at w=8, 16 and 32 against multiply, word by
+ * word, for every offset and length around the vector sizes, and that
+ * nothing is written outside the region.  The SIMD kernel is picked
+ * once per process: gf_region_unit.sh runs this with the
+ * GF_COMPLETE_DISABLE_* variables so that each one is covered.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "gf_complete.h"
+#include "gf_rand.h"
+
+#define MAX_OFFSET 64
+#define MAX_BYTES 600
+#define GUARD 64
+#define BUFFER_SIZE (GUARD + MAX_OFFSET + MAX_BYTES + GUARD)
+
+static uint32_t get_word(const uint8_t *p, int B)
+{
+  if (B == 1) return *p;
+  if (B == 2) return *(const uint16_t *) p;
+  return *(const uint32_t *) p;
+}
+
+static int check(gf_t *gf, int w, uint8_t *src, uint8_t *dest, uint8_t *before,
+                 int offset, int bytes, uint32_t val, int xor)
+{
+  int B = w / 8;
+  int i;
+  uint32_t expected, mask = (w == 32) ? 0xffffffff : ((1u << w) - 1);
+
+  gf->multiply_region.w32(gf, src + GUARD + offset, dest + GUARD + offset, val, bytes, xor);
+
+  for (i = 0; i < BUFFER_SIZE; i += B) {
+    uint32_t got = get_word(dest + i, B);
+    uint32_t old = get_word(before + i, B);
+    if (i < GUARD + offset || i >= GUARD + offset + bytes) {
+      expected = old;
+    } else {
+      expected = gf->multiply.w32(gf, val, get_word(src + i, B)) & mask;
+      if (xor) expected ^= old;
+    }
+    if (got != expected) {
+      fprintf(stderr, "Unit test failed.\n");
+      fprintf(stderr, "w=%d offset=%d bytes=%d val=0x%x xor=%d: byte %d of the region is 0x%x, expected 0x%x%s\n",
+              w, offset, bytes, val, xor, i - GUARD - offset, got, expected,
+              (i < GUARD + offset || i >= GUARD + offset + bytes) ? " (outside)" : "");
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  int widths[] = { 8, 16, 32 };
+  uint8_t *src, *dest, *before;
+  int wi, offset, bytes, xor, v, B, w;
+  uint32_t vals[3];
+  gf_t gf;
+
+  MOA_Seed(17);
+  if (posix_memalign((void **) &src, 64, BUFFER_SIZE) ||
+      posix_memalign((void **) &dest, 64, BUFFER_SIZE) ||
+      posix_memalign((void **) &before, 64, BUFFER_SIZE)) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+  MOA_Fill_Random_Region(src, BUFFER_SIZE);
+
+  for (wi = 0; wi < 3; wi++) {
+    w = widths[wi];
+    B = w / 8;
+    if (!gf_init_easy(&gf, w)) {
+      fprintf(stderr, "gf_init_easy(%d) failed\n", w);
+      exit(1);
+    }
+    vals[0] = 1;
+    vals[1] = 2;
+    vals[2] = MOA_Random_W(w, 1);
+    if (vals[2] < 3) vals[2] = 3;
+    for (offset = 0; offset < MAX_OFFSET; offset += B) {
+      for (bytes = 0; bytes <= MAX_BYTES; bytes += B) {
+        for (xor = 0; xor < 2; xor++) {
+          for (v = 0; v < 3; v++) {
+            MOA_Fill_Random_Region(dest, BUFFER_SIZE);
+            memcpy(before, dest, BUFFER_SIZE);
+            if (check(&gf, w, src, dest, before, offset, bytes, vals[v], xor)) exit(1);
+          }
+        }
+      }
+    }
+    gf_free(&gf, 0);
+  }
+  free(src);
+  free(dest);
+  free(before);
+  printf("gf_region_unit: ok\n");
+  return 0;
+}
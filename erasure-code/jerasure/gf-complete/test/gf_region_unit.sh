@@ -0,0 +1,9 @@
+#!/bin/sh -e
+# gf_region_unit with each SIMD kernel gf-complete can pick on this CPU
+./gf_region_unit
+GF_COMPLETE_DISABLE_GFNI=1 ./gf_region_unit
+GF_COMPLETE_DISABLE_AVX512=1 ./gf_region_unit
+GF_COMPLETE_DISABLE_AVX512=1 GF_COMPLETE_DISABLE_GFNI=1 ./gf_region_unit
+GF_COMPLETE_DISABLE_AVX512=1 GF_COMPLETE_DISABLE_GFNI=1 GF_COMPLETE_DISABLE_AVX2=1 ./gf_region_unit
+GF_COMPLETE_DISABLE_AVX512=1 GF_COMPLETE_DISABLE_GFNI=1 GF_COMPLETE_DISABLE_AVX2=1 \
+  GF_COMPLETE_DISABLE_SSE4=1 GF_COMPLETE_DISABLE_SSSE3=1 ./gf_region_unit
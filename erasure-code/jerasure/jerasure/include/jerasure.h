@@ -89,8 +89,49 @@
           2 = source packet (0 - w-1)
           3 = destination device (0 - k+m-1)
           4 = destination packet (0 - w-1)
+
+   flat schedule = the same operations held in one contiguous allocation,
+              one array per field, with the packet numbers already
+              multiplied by the packetsize the schedule was flattened for:
+
+          src[i] / dst[i]         = source / destination device
+          src_off[i] / dst_off[i] = byte offset of the packet in the device
+          xor_op[i]               = 0 for copy, 1 for xor
+
+   A flat schedule may also carry a specialized kernel that runs the
+   whole schedule in place of the interpreter: see
+   jerasure_set_flat_schedule_specializer.
+
+   The flags given to the runners are passed to the kernel:
+
+          JERASURE_STREAM_OUTPUT = the caller does not read the decoded
+              packets again, a kernel may write the last value of each
+              destination packet with non-temporal stores.  The
+              interpreter ignores it.
+
+          JERASURE_KERNEL_FLAGS = bits that jerasure never looks at and
+              that are left to the kernel, e.g. to choose between
+              several implementations.  The interpreter ignores them.
  */
 
+#define JERASURE_STREAM_OUTPUT 1
+#define JERASURE_KERNEL_FLAGS 0xff00
+
+typedef struct jerasure_flat_schedule jerasure_flat_schedule;
+
+struct jerasure_flat_schedule {
+  int nops;
+  int packetsize;
+  int *src;
+  int *src_off;
+  int *dst;
+  int *dst_off;
+  char *xor_op;
+  void (*kernel)(char **ptrs, jerasure_flat_schedule *schedule, int flags);
+  void (*kernel_release)(jerasure_flat_schedule *schedule);
+  void *kernel_data;
+};
+
 /* ---------------------------------------------------------------  */
 /* Bitmatrices / schedules ---------------------------------------- */
 /*
@@ -112,11 +153,34 @@
  - jerasure_generate_schedule_cache precalcalculate all the schedule for the
                               given distribution bitmatrix.  M must equal 2.
  
+ - jerasure_generate_decoding_schedule returns the schedule that
+                              jerasure_schedule_decode_lazy would use for
+                              these erasures, for callers that cache schedules
+                              themselves.  Free it with jerasure_free_schedule.
+ 
  - jerasure_free_schedule frees a schedule that was allocated with 
                               jerasure_XXX_bitmatrix_to_schedule.
  
  - jerasure_free_schedule_cache frees a schedule cache that was created with 
                               jerasure_generate_schedule_cache.
+
+ - jerasure_schedule_to_flat converts a schedule into a flat schedule for
+                              the given packetsize.  The schedule is left
+                              untouched, free it as usual.
+
+ - jerasure_flat_to_schedule converts a flat schedule back into a schedule
+                              that must be freed with jerasure_free_schedule.
+
+ - jerasure_free_flat_schedule frees a flat schedule.  It is a single
+                              allocation, plus whatever the specializer
+                              attached to it.
+
+ - jerasure_set_flat_schedule_specializer installs a process wide hook
+                              that jerasure_schedule_to_flat calls on every
+                              new flat schedule.  It may set kernel,
+                              kernel_release and kernel_data; when it leaves
+                              kernel NULL the schedule is interpreted.
+                              Pass NULL to remove it.
  */
 
 int *jerasure_matrix_to_bitmatrix(int k, int m, int w, int *matrix);
@@ -124,10 +188,16 @@ int **jerasure_dumb_bitmatrix_to_schedule(int k, int m, int w, int *bitmatrix);
 int **jerasure_dumb_bitmatrix_to_schedule_hybrid_solution(int k, int m, int w, int *bitmatrix, Control* control);//add by LYF
 int **jerasure_smart_bitmatrix_to_schedule(int k, int m, int w, int *bitmatrix);
 int ***jerasure_generate_schedule_cache(int k, int m, int w, int *bitmatrix, int smart);
+int **jerasure_generate_decoding_schedule(int k, int m, int w, int *bitmatrix, int *erasures, int smart);
 
 void jerasure_free_schedule(int **schedule);
 void jerasure_free_schedule_cache(int k, int m, int ***cache);
 
+jerasure_flat_schedule *jerasure_schedule_to_flat(int **schedule, int packetsize);
+int **jerasure_flat_to_schedule(jerasure_flat_schedule *flat);
+void jerasure_free_flat_schedule(jerasure_flat_schedule *flat);
+void jerasure_set_flat_schedule_specializer(void (*specialize)(jerasure_flat_schedule *flat));
+
 
 /* ------------------------------------------------------------ */
 /* Encoding - these are all straightforward.  jerasure_matrix_encode only 
@@ -144,6 +214,9 @@ void jerasure_bitmatrix_encode(int k, int m, int w, int *bitmatrix,
 void jerasure_schedule_encode(int k, int m, int w, int **schedule,
                                   char **data_ptrs, char **coding_ptrs, int size, int packetsize);
 
+void jerasure_flat_schedule_encode(int k, int m, int w, jerasure_flat_schedule *schedule,
+                                  char **data_ptrs, char **coding_ptrs, int size, int flags);
+
 /* ------------------------------------------------------------ */
 /* Decoding. -------------------------------------------------- */
 
@@ -159,6 +232,9 @@ void jerasure_schedule_encode(int k, int m, int w, int **schedule,
 
    jerasure_schedule_decode_lazy generates the schedule on the fly.
 
+   jerasure_flat_schedule_decode runs a flat schedule previously obtained
+   from jerasure_generate_decoding_schedule for the same erasures.
+
    jerasure_matrix_decode only works when w = 8|16|32.
 
    jerasure_make_decoding_matrix/bitmatrix make the k*k decoding matrix
@@ -194,11 +270,14 @@ int jerasure_schedule_decode_lazy(int k, int m, int w, int *bitmatrix, int *eras
 
 int jerasure_schedule_decode_lazy_hybrid_solution(int k, int m, int w, int *bitmatrix, int *erasures, 
                             char **data_ptrs, char *coding_ptrs, int size, int packetsize, 
-                            int* crs_parity_group_selection, Control* control);//add by LYF
+                            int* crs_parity_group_selection, Control* control, int flags);//add by LYF
 
 int jerasure_schedule_decode_cache(int k, int m, int w, int ***scache, int *erasures,
                             char **data_ptrs, char **coding_ptrs, int size, int packetsize);
 
+int jerasure_flat_schedule_decode(int k, int m, int w, jerasure_flat_schedule *schedule, int *erasures,
+                            char **data_ptrs, char **coding_ptrs, int size, int flags);
+
 int jerasure_make_decoding_matrix(int k, int m, int w, int *matrix, int *erased, 
                                   int *decoding_matrix, int *dm_ids);
 
@@ -220,6 +299,10 @@ int *jerasure_erasures_to_erased(int k, int m, int *erasures);
    bytes from each device.  ptrs is an array of pointers which should have as many
    elements as the highest referenced device in the schedule.
 
+   jerasure_do_flat_scheduled_operations does the same with a flat schedule,
+   using the packetsize it was flattened for.  flags is 0,
+   JERASURE_STREAM_OUTPUT and/or JERASURE_KERNEL_FLAGS bits.
+
  */
  
 void jerasure_matrix_dotprod(int k, int w, int *matrix_row,
@@ -231,6 +314,7 @@ void jerasure_bitmatrix_dotprod(int k, int w, int *bitmatrix_row,
                              char **data_ptrs, char **coding_ptrs, int size, int packetsize);
 
 void jerasure_do_scheduled_operations(char **ptrs, int **schedule, int packetsize);
+void jerasure_do_flat_scheduled_operations(char **ptrs, jerasure_flat_schedule *schedule, int flags);
 
 /* ------------------------------------------------------------ */
 /* Matrix Inversion ------------------------------------------- */
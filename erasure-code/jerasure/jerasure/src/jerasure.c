@@ -57,6 +57,7 @@
 static double jerasure_total_xor_bytes = 0;
 static double jerasure_total_gf_bytes = 0;
 static double jerasure_total_memcpy_bytes = 0;
+static void (*jerasure_flat_schedule_specializer)(jerasure_flat_schedule *flat) = NULL;
 
 void jerasure_print_matrix(int *m, int rows, int cols, int w)
 {
@@ -572,6 +573,70 @@ void jerasure_free_schedule_cache(int k, int m, int ***cache)
   free(cache);
 }
 
+jerasure_flat_schedule *jerasure_schedule_to_flat(int **schedule, int packetsize)
+{
+  jerasure_flat_schedule *flat;
+  int nops, op;
+
+  for (nops = 0; schedule[nops][0] >= 0; nops++) ;
+
+  /* One allocation: the header, four int arrays and the xor flags */
+  flat = (jerasure_flat_schedule *) malloc(sizeof(jerasure_flat_schedule) +
+                                           sizeof(int)*4*nops + nops);
+  if (flat == NULL) return NULL;
+  flat->nops = nops;
+  flat->packetsize = packetsize;
+  flat->src = (int *) (flat + 1);
+  flat->src_off = flat->src + nops;
+  flat->dst = flat->src_off + nops;
+  flat->dst_off = flat->dst + nops;
+  flat->xor_op = (char *) (flat->dst_off + nops);
+
+  for (op = 0; op < nops; op++) {
+    flat->src[op] = schedule[op][0];
+    flat->src_off[op] = schedule[op][1]*packetsize;
+    flat->dst[op] = schedule[op][2];
+    flat->dst_off[op] = schedule[op][3]*packetsize;
+    flat->xor_op[op] = schedule[op][4] ? 1 : 0;
+  }
+  flat->kernel = NULL;
+  flat->kernel_release = NULL;
+  flat->kernel_data = NULL;
+  if (jerasure_flat_schedule_specializer != NULL) jerasure_flat_schedule_specializer(flat);
+  return flat;
+}
+
+int **jerasure_flat_to_schedule(jerasure_flat_schedule *flat)
+{
+  int **schedule;
+  int op;
+
+  schedule = talloc(int *, flat->nops+1);
+  if (schedule == NULL) return NULL;
+  for (op = 0; op < flat->nops; op++) {
+    schedule[op] = talloc(int, 5);
+    schedule[op][0] = flat->src[op];
+    schedule[op][1] = flat->src_off[op]/flat->packetsize;
+    schedule[op][2] = flat->dst[op];
+    schedule[op][3] = flat->dst_off[op]/flat->packetsize;
+    schedule[op][4] = flat->xor_op[op];
+  }
+  schedule[op] = talloc(int, 5);
+  schedule[op][0] = -1;
+  return schedule;
+}
+
+void jerasure_free_flat_schedule(jerasure_flat_schedule *flat)
+{
+  if (flat->kernel_release != NULL) flat->kernel_release(flat);
+  free(flat);
+}
+
+void jerasure_set_flat_schedule_specializer(void (*specialize)(jerasure_flat_schedule *flat))
+{
+  jerasure_flat_schedule_specializer = specialize;
+}
+
 void jerasure_matrix_dotprod(int k, int w, int *matrix_row,
                           int *src_ids, int dest_id,
                           char **data_ptrs, char **coding_ptrs, int size)
@@ -892,7 +957,7 @@ static int set_up_ids_for_scheduled_decoding_hybrid_solution(int k, int m, int *
   return 0;
 }
 
-static int **jerasure_generate_decoding_schedule(int k, int m, int w, int *bitmatrix, int *erasures, int smart)
+int **jerasure_generate_decoding_schedule(int k, int m, int w, int *bitmatrix, int *erasures, int smart)
 {
   int i, j, x, drive, y, index, z;
   int *decoding_matrix, *inverse, *real_decoding_matrix;
@@ -1160,6 +1225,7 @@ int jerasure_schedule_decode_lazy(int k, int m, int w, int *bitmatrix, int *eras
   int i, tdone;
   char **ptrs;
   int **schedule;
+  jerasure_flat_schedule *flat;
  
   ptrs = set_up_ptrs_for_scheduled_decoding(k, m, erasures, data_ptrs, coding_ptrs);
   if (ptrs == NULL) return -1;
@@ -1169,13 +1235,19 @@ int jerasure_schedule_decode_lazy(int k, int m, int w, int *bitmatrix, int *eras
     free(ptrs);
     return -1;
   }
+  flat = jerasure_schedule_to_flat(schedule, packetsize);
+  jerasure_free_schedule(schedule);
+  if (flat == NULL) {
+    free(ptrs);
+    return -1;
+  }
 
   for (tdone = 0; tdone < size; tdone += packetsize*w) {
-  jerasure_do_scheduled_operations(ptrs, schedule, packetsize);
+    jerasure_do_flat_scheduled_operations(ptrs, flat, 0);
     for (i = 0; i < k+m; i++) ptrs[i] += (packetsize*w);
   }
 
-  jerasure_free_schedule(schedule);
+  jerasure_free_flat_schedule(flat);
   free(ptrs);
 
   return 0;
@@ -1186,11 +1258,12 @@ int get_Node_symbol_numbers(int i,Control* control) {
 }
 
 int jerasure_schedule_decode_lazy_hybrid_solution(int k, int m, int w, int *bitmatrix, int *erasures,
-                            char **data_ptrs, char *coding_ptrs, int size, int packetsize, int* parity_group_selection, Control* control)//add by LYF
+                            char **data_ptrs, char *coding_ptrs, int size, int packetsize, int* parity_group_selection, Control* control, int flags)//add by LYF
 {
   int i, tdone;
   char **ptrs;
   int **schedule;
+  jerasure_flat_schedule *flat;
  
   ptrs = set_up_ptrs_for_scheduled_decoding_hybrid_solution(k, m, erasures, data_ptrs, coding_ptrs);
   if (ptrs == NULL) return -1;
@@ -1200,13 +1273,19 @@ int jerasure_schedule_decode_lazy_hybrid_solution(int k, int m, int w, int *bitm
     free(ptrs);
     return -1;
   }
+  flat = jerasure_schedule_to_flat(schedule, packetsize);
+  jerasure_free_schedule(schedule);
+  if (flat == NULL) {
+    free(ptrs);
+    return -1;
+  }
 
   for (tdone = 0; tdone < size; tdone += packetsize*w) {
-  jerasure_do_scheduled_operations(ptrs, schedule, packetsize);
+    jerasure_do_flat_scheduled_operations(ptrs, flat, flags);
     for (i = 0; i <= k; i++) ptrs[i] += (packetsize*(get_Node_symbol_numbers(i,control)));
   }
 
-  jerasure_free_schedule(schedule);
+  jerasure_free_flat_schedule(flat);
   free(ptrs);
 
   return 0;
@@ -1244,6 +1323,26 @@ int jerasure_schedule_decode_cache(int k, int m, int w, int ***scache, int *eras
   return 0;
 }
 
+int jerasure_flat_schedule_decode(int k, int m, int w, jerasure_flat_schedule *schedule, int *erasures,
+                            char **data_ptrs, char **coding_ptrs, int size, int flags)
+{
+  int i, tdone;
+  char **ptrs;
+  int stride = schedule->packetsize*w;
+
+  ptrs = set_up_ptrs_for_scheduled_decoding(k, m, erasures, data_ptrs, coding_ptrs);
+  if (ptrs == NULL) return -1;
+
+  for (tdone = 0; tdone < size; tdone += stride) {
+    jerasure_do_flat_scheduled_operations(ptrs, schedule, flags);
+    for (i = 0; i < k+m; i++) ptrs[i] += stride;
+  }
+
+  free(ptrs);
+
+  return 0;
+}
+
 /* This only works when m = 2 */
 
 int ***jerasure_generate_schedule_cache(int k, int m, int w, int *bitmatrix, int smart)
@@ -1440,6 +1539,49 @@ void jerasure_schedule_encode(int k, int m, int w, int **schedule,
   free(ptr_copy);
 }
 
+void jerasure_do_flat_scheduled_operations(char **ptrs, jerasure_flat_schedule *schedule, int flags)
+{
+  int op;
+  int packetsize = schedule->packetsize;
+  int *src = schedule->src;
+  int *src_off = schedule->src_off;
+  int *dst = schedule->dst;
+  int *dst_off = schedule->dst_off;
+  char *xor_op = schedule->xor_op;
+  int nxor = 0;
+
+  if (schedule->kernel != NULL) {
+    schedule->kernel(ptrs, schedule, flags);
+    return;
+  }
+
+  for (op = 0; op < schedule->nops; op++) {
+    if (xor_op[op]) {
+      galois_region_xor(ptrs[src[op]] + src_off[op], ptrs[dst[op]] + dst_off[op], packetsize);
+      nxor++;
+    } else {
+      memcpy(ptrs[dst[op]] + dst_off[op], ptrs[src[op]] + src_off[op], packetsize);
+    }
+  }
+  jerasure_total_xor_bytes += (double) nxor*packetsize;
+  jerasure_total_memcpy_bytes += (double) (schedule->nops-nxor)*packetsize;
+}
+
+void jerasure_flat_schedule_encode(int k, int m, int w, jerasure_flat_schedule *schedule,
+                                   char **data_ptrs, char **coding_ptrs, int size, int flags)
+{
+  char *ptr_copy[k+m];
+  int i, tdone;
+  int stride = schedule->packetsize*w;
+
+  for (i = 0; i < k; i++) ptr_copy[i] = data_ptrs[i];
+  for (i = 0; i < m; i++) ptr_copy[i+k] = coding_ptrs[i];
+  for (tdone = 0; tdone < size; tdone += stride) {
+    jerasure_do_flat_scheduled_operations(ptr_copy, schedule, flags);
+    for (i = 0; i < k+m; i++) ptr_copy[i] += stride;
+  }
+}
+
 int find_key(Node_info* node_info, int num) {
   int result = -1;
   for (int i = 0; i < node_info->symbol_numbers; ++i) {
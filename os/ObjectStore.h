@@ -1701,6 +1701,44 @@ public:
      return read(c->get_cid(), oid, offset, len, bl, op_flags, allow_eio);
    }
 
+  /**
+   * get_xor_read_extents -- map a symbol subset onto object extents
+   *
+   * Each chunk_size bytes of a shard hold chunk_size / (packet_size * w)
+   * packet rows of w symbols, each symbol packet_size bytes long.  For
+   * every row in [offset, offset + len) this emits the extents of the
+   * symbols listed in symbol_ids, in the order read_for_xor returns them.
+   * Symbols that are adjacent on disk are merged into a single extent.
+   *
+   * @param extents output (offset, length) pairs
+   */
+  static void get_xor_read_extents(
+    uint64_t offset,
+    size_t len,
+    int chunk_size,
+    int packet_size,
+    int w,
+    const vector<int>& symbol_ids,
+    vector<pair<uint64_t, uint64_t> > *extents) {
+    extents->clear();
+    if (chunk_size <= 0 || packet_size <= 0 || w <= 0)
+      return;
+    for (uint64_t off_chunk = 0; off_chunk < len; off_chunk += chunk_size) {
+      for (int off_packet = 0; off_packet < chunk_size;
+	   off_packet += packet_size * w) {
+	for (auto sid : symbol_ids) {
+	  uint64_t off = offset + off_chunk + off_packet +
+	    (uint64_t)sid * packet_size;
+	  if (!extents->empty() &&
+	      extents->back().first + extents->back().second == off)
+	    extents->back().second += packet_size;
+	  else
+	    extents->push_back(make_pair(off, (uint64_t)packet_size));
+	}
+      }
+    }
+  }
+
    virtual int read_for_xor(
     const coll_t& cid,
     const ghobject_t& oid,
@@ -1730,6 +1768,43 @@ public:
      bool allow_eio = false) {
      return read_for_xor(c->get_cid(), oid, offset, len, bl, stripe_size, chunk_size, packet_size, w, symbol_ids, op_flags, allow_eio);
    }//add by LYF
+
+  /// one object's symbol read in a read_for_xor_batch
+  struct xor_read_t {
+    ghobject_t oid;
+    uint64_t offset = 0;
+    size_t len = 0;
+    vector<int> symbol_ids;
+    uint32_t op_flags = 0;
+    bufferlist bl;  ///< [out] symbols, as read_for_xor returns them
+    int r = 0;      ///< [out] read_for_xor's return value
+  };
+
+  /**
+   * read_for_xor_batch -- symbol reads of many objects in one call
+   *
+   * Recovery of many small objects asks each helper for a few symbols
+   * of every object.  Backends that can fetch the data of several
+   * objects in one go (a single multi-key get, one aio batch) override
+   * this; by default every read goes through read_for_xor.
+   *
+   * @param reads objects and symbols to read, results are filled in
+   */
+  virtual void read_for_xor_batch(
+    CollectionHandle &c,
+    int stripe_size,
+    int chunk_size,
+    int packet_size,
+    int w,
+    vector<xor_read_t> &reads,
+    bool allow_eio = false) {
+    for (auto &i : reads) {
+      i.bl.clear();
+      i.r = read_for_xor(c, i.oid, i.offset, i.len, i.bl, stripe_size,
+			 chunk_size, packet_size, w, i.symbol_ids, i.op_flags,
+			 allow_eio);
+    }
+  }
   /**
    * fiemap -- get extent map of data of an object
    *
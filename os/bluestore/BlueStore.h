@@ -2105,10 +2105,16 @@ public:
     int w,
     vector<int> symbol_ids,
     uint32_t op_flags = 0,
-    bool allow_eio = false) override{return -1;}//add by LYF
-  
+    bool allow_eio = false) override {
+    CollectionHandle c = _get_collection(cid);
+    if (!c)
+      return -ENOENT;
+    return read_for_xor(c, oid, offset, len, bl, stripe_size, chunk_size,
+			packet_size, w, symbol_ids, op_flags, allow_eio);
+  }
+
   int read_for_xor(
-    CollectionHandle &c,
+    CollectionHandle &c_,
     const ghobject_t& oid,
     uint64_t offset,
     size_t len,
@@ -2117,9 +2123,37 @@ public:
     int chunk_size,
     int packet_size,
     int w,
-    vector<int> symbol_ds,
+    vector<int> symbol_ids,
     uint32_t op_flags = 0,
-    bool allow_eio = false) override{return -1;}//add by LYF
+    bool allow_eio = false) override {
+    Collection *c = static_cast<Collection *>(c_.get());
+    if (!c->exists)
+      return -ENOENT;
+    bl.clear();
+    RWLock::RLocker l(c->lock);
+    OnodeRef o = c->get_onode(oid, false);
+    if (!o || !o->exists)
+      return -ENOENT;
+    if (offset == 0 && len == 0)
+      len = o->onode.size;
+
+    // read only the requested symbols; each extent goes through _do_read so
+    // buffer cache hits are served from memory and checksums are verified
+    // for the blocks actually touched rather than for the whole chunk.
+    vector<pair<uint64_t, uint64_t> > extents;
+    get_xor_read_extents(offset, len, chunk_size, packet_size, w, symbol_ids,
+			 &extents);
+    int got = 0;
+    for (auto& e : extents) {
+      bufferlist t;
+      int r = _do_read(c, o, e.first, e.second, t, op_flags);
+      if (r < 0)
+	return r;
+      got += r;
+      bl.claim_append(t);
+    }
+    return got;
+  }
 
   int _do_read(
     Collection *c,
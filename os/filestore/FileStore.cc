@@ -30,6 +30,7 @@
 #include <linux/fs.h>
 #endif
 
+#include <algorithm>
 #include <iostream>
 #include <map>
 
@@ -557,6 +558,7 @@ FileStore::FileStore(CephContext* cct, const std::string &base,
   m_filestore_min_sync_interval(cct->_conf->filestore_min_sync_interval),
   m_filestore_fail_eio(cct->_conf->filestore_fail_eio),
   m_filestore_fadvise(cct->_conf->filestore_fadvise),
+  m_filestore_xor_read_direct(cct->_conf->filestore_xor_read_direct),
   do_update(do_update),
   m_journal_dio(cct->_conf->journal_dio),
   m_journal_aio(cct->_conf->journal_aio),
@@ -3220,15 +3222,16 @@ int FileStore::read_for_xor(
   uint32_t op_flags,
   bool allow_eio)
 {
-  int got = -1;
+  int got = 0;
   tracepoint(objectstore, read_enter, _cid.c_str(), offset, len);
   const coll_t& cid = !_need_temp_object_collection(_cid, oid) ? _cid : _cid.get_temp();
-  dout(15) << "read " << cid << "/" << oid << " " << offset << "~" << len << dendl;
+  dout(15) << "read_for_xor " << cid << "/" << oid << " " << offset << "~" << len
+	   << " symbols " << symbol_ids << dendl;
   FDRef fd;
   int r = lfn_open(cid, oid, false, &fd);
   if (r < 0) {
-    dout(10) << "FileStore::read(" << cid << "/" << oid << ") open error: "
-       << cpp_strerror(r) << dendl;
+    dout(10) << "FileStore::read_for_xor(" << cid << "/" << oid << ") open error: "
+	     << cpp_strerror(r) << dendl;
     return r;
   }
 
@@ -3240,36 +3243,171 @@ int FileStore::read_for_xor(
     len = st.st_size;
   }
 
+  vector<pair<uint64_t, uint64_t> > extents;
+  get_xor_read_extents(offset, len, chunk_size, packet_size, w, symbol_ids,
+		       &extents);
+  bl.clear();
+
+  // recovery gathers are read once and never again; with O_DIRECT they
+  // bypass the page cache entirely instead of evicting hot client data.
+  if (m_filestore_xor_read_direct) {
+    got = _read_extents_direct(cid, oid, extents, bl);
+    if (got != -EINVAL)
+      goto done;
+    // the backing fs does not support O_DIRECT; use buffered reads
+    dout(10) << "FileStore::read_for_xor(" << cid << "/" << oid
+	     << ") O_DIRECT not supported, falling back to buffered reads" << dendl;
+    bl.clear();
+    got = 0;
+  }
+
 #ifdef HAVE_POSIX_FADVISE
   if (op_flags & CEPH_OSD_OP_FLAG_FADVISE_RANDOM)
     posix_fadvise(**fd, offset, len, POSIX_FADV_RANDOM);
   if (op_flags & CEPH_OSD_OP_FLAG_FADVISE_SEQUENTIAL)
     posix_fadvise(**fd, offset, len, POSIX_FADV_SEQUENTIAL);
 #endif
-  bl.clear();
-  bufferlist bl_append;
-  for(size_t off_chunk = 0; off_chunk < len; off_chunk += chunk_size){
-     for(int off_packet = 0; off_packet < chunk_size; off_packet += packet_size * w){
-         for(vector<int>::iterator symbol_ids_iterator = symbol_ids.begin(); symbol_ids_iterator != symbol_ids.end(); ++symbol_ids_iterator){
-             bufferptr bptr(packet_size);
-             got = safe_pread(**fd, bptr.c_str(), packet_size, offset + off_chunk + off_packet + (*symbol_ids_iterator)*packet_size);
-             if (got < 0) {
-                dout(10) << "FileStore::read(" << cid << "/" << oid << ") pread error: " << cpp_strerror(got) << dendl;
-                lfn_close(fd);
-                if (!(allow_eio || !m_filestore_fail_eio || got != -EIO)) {
-                    derr << "FileStore::read(" << cid << "/" << oid << ") pread error: " << cpp_strerror(got) << dendl;
-                    assert(0 == "eio on pread");
-                }
-                return got;
-             }
-             bptr.set_length(got);
-             bl_append.clear(); 
-             bl_append.push_back(std::move(bptr));   // put it in the target bufferlist
-             bl.claim_append(bl_append);
-          }
-     }
+
+  for (auto& e : extents) {
+    bufferptr bptr(e.second);
+    r = safe_pread(**fd, bptr.c_str(), e.second, e.first);
+    if (r < 0) {
+      got = r;
+      break;
+    }
+    bptr.set_length(r);
+    bl.push_back(std::move(bptr));
+    got += r;
+    if ((uint64_t)r < e.second)
+      break;  // short read, past the end of the object
+  }
+
+#ifdef HAVE_POSIX_FADVISE
+  if (op_flags & CEPH_OSD_OP_FLAG_FADVISE_DONTNEED)
+    posix_fadvise(**fd, offset, len, POSIX_FADV_DONTNEED);
+  if (op_flags & (CEPH_OSD_OP_FLAG_FADVISE_RANDOM | CEPH_OSD_OP_FLAG_FADVISE_SEQUENTIAL))
+    posix_fadvise(**fd, offset, len, POSIX_FADV_NORMAL);
+#endif
+
+ done:
+  if (got < 0) {
+    dout(10) << "FileStore::read_for_xor(" << cid << "/" << oid << ") pread error: "
+	     << cpp_strerror(got) << dendl;
+    lfn_close(fd);
+    if (!(allow_eio || !m_filestore_fail_eio || got != -EIO)) {
+      derr << "FileStore::read_for_xor(" << cid << "/" << oid << ") pread error: "
+	   << cpp_strerror(got) << dendl;
+      assert(0 == "eio on pread");
+    }
+    return got;
+  }
+
+  if (m_filestore_sloppy_crc && (!replaying || backend->can_checkpoint())) {
+    uint64_t pos = 0;
+    for (auto& e : extents) {
+      if (pos >= bl.length())
+	break;
+      uint64_t l = MIN(e.second, bl.length() - pos);
+      bufferlist t;
+      t.substr_of(bl, pos, l);
+      ostringstream ss;
+      int errors = backend->_crc_verify_read(**fd, e.first, l, t, &ss);
+      if (errors != 0) {
+	dout(0) << "FileStore::read_for_xor " << cid << "/" << oid << " "
+		<< e.first << "~" << l << " ... BAD CRC:\n" << ss.str() << dendl;
+	assert(0 == "bad crc on read");
+      }
+      pos += l;
+    }
+  }
+
+  lfn_close(fd);
+
+  dout(10) << "FileStore::read_for_xor " << cid << "/" << oid << " " << offset << "~"
+	   << got << "/" << len << " in " << extents.size() << " extents" << dendl;
+  if (cct->_conf->filestore_debug_inject_read_err &&
+      debug_data_eio(oid)) {
+    return -EIO;
+  } else {
+    tracepoint(objectstore, read_exit, got);
+    return got;
   }
-  return got;
+}
+
+/*
+ * Read extents through a private O_DIRECT descriptor.  Each extent is
+ * widened to page boundaries and overlapping windows are merged, so
+ * neighbouring symbols that share a page are only read once.  Returns
+ * -EINVAL if the file system refuses O_DIRECT.
+ */
+int FileStore::_read_extents_direct(
+  const coll_t& cid,
+  const ghobject_t& oid,
+  const vector<pair<uint64_t, uint64_t> >& extents,
+  bufferlist& bl)
+{
+  Index index;
+  int r = get_index(cid, &index);
+  if (r < 0)
+    return r;
+  int fd;
+  {
+    IndexedPath path;
+    assert(NULL != index.index);
+    RWLock::RLocker l((index.index)->access_lock);
+    r = lfn_find(oid, index, &path);
+    if (r < 0)
+      return r;
+    fd = ::open(path->path(), O_RDONLY | O_DIRECT);
+    if (fd < 0)
+      return -errno;
+  }
+
+  const uint64_t align = CEPH_PAGE_SIZE;
+  map<uint64_t, bufferptr> windows;   // aligned start -> data
+  {
+    // the symbols are not necessarily listed in offset order, sort the
+    // windows so that each is merged with all those it overlaps
+    vector<pair<uint64_t, uint64_t> > widened;
+    for (auto& e : extents)
+      widened.push_back(make_pair(e.first & ~(align - 1),
+				  ROUND_UP_TO(e.first + e.second, align)));
+    std::sort(widened.begin(), widened.end());
+    vector<pair<uint64_t, uint64_t> > aligned;
+    for (auto& w : widened) {
+      if (!aligned.empty() && w.first <= aligned.back().second)
+	aligned.back().second = MAX(aligned.back().second, w.second);
+      else
+	aligned.push_back(w);
+    }
+    for (auto& a : aligned) {
+      bufferptr bp = buffer::create_page_aligned(a.second - a.first);
+      r = safe_pread(fd, bp.c_str(), bp.length(), a.first);
+      if (r < 0)
+	goto out;
+      bp.set_length(r);
+      windows[a.first] = bp;
+    }
+  }
+
+  r = 0;
+  for (auto& e : extents) {
+    auto p = windows.upper_bound(e.first);
+    assert(p != windows.begin());
+    --p;
+    uint64_t in_off = e.first - p->first;
+    if (in_off >= p->second.length())
+      break;  // past the end of the object
+    uint64_t l = MIN(e.second, p->second.length() - in_off);
+    bl.append(p->second, in_off, l);
+    r += l;
+    if (l < e.second)
+      break;
+  }
+
+ out:
+  VOID_TEMP_FAILURE_RETRY(::close(fd));
+  return r;
 }
 
 int FileStore::_do_fiemap(int fd, uint64_t offset, size_t len,
@@ -5721,6 +5859,7 @@ const char** FileStore::get_tracked_conf_keys() const
     "filestore_kill_at",
     "filestore_fail_eio",
     "filestore_fadvise",
+    "filestore_xor_read_direct",
     "filestore_sloppy_crc",
     "filestore_sloppy_crc_block_size",
     "filestore_max_alloc_hint_size",
@@ -5769,13 +5908,15 @@ void FileStore::handle_conf_change(const struct md_config_t *conf,
       changed.count("filestore_sloppy_crc") ||
       changed.count("filestore_sloppy_crc_block_size") ||
       changed.count("filestore_max_alloc_hint_size") ||
-      changed.count("filestore_fadvise")) {
+      changed.count("filestore_fadvise") ||
+      changed.count("filestore_xor_read_direct")) {
     Mutex::Locker l(lock);
     m_filestore_min_sync_interval = conf->filestore_min_sync_interval;
     m_filestore_max_sync_interval = conf->filestore_max_sync_interval;
     m_filestore_kill_at.set(conf->filestore_kill_at);
     m_filestore_fail_eio = conf->filestore_fail_eio;
     m_filestore_fadvise = conf->filestore_fadvise;
+    m_filestore_xor_read_direct = conf->filestore_xor_read_direct;
     m_filestore_sloppy_crc = conf->filestore_sloppy_crc;
     m_filestore_sloppy_crc_block_size = conf->filestore_sloppy_crc_block_size;
     m_filestore_max_alloc_hint_size = conf->filestore_max_alloc_hint_size;
@@ -590,6 +590,11 @@ public:
     vector<int> symbol_ids,
     uint32_t op_flags = 0,
     bool allow_eio = false) override;//add by LYF
+  int _read_extents_direct(
+    const coll_t& cid,
+    const ghobject_t& oid,
+    const vector<pair<uint64_t, uint64_t> >& extents,
+    bufferlist& bl);
 
   int _do_fiemap(int fd, uint64_t offset, size_t len,
                  map<uint64_t, uint64_t> *m);
@@ -767,6 +772,7 @@ private:
   double m_filestore_min_sync_interval;
   bool m_filestore_fail_eio;
   bool m_filestore_fadvise;
+  bool m_filestore_xor_read_direct;
   int do_update;
   bool m_journal_dio, m_journal_aio, m_journal_force_aio;
   std::string m_osd_rollback_to_cluster_snap;
@@ -33,6 +33,7 @@
 #include "common/perf_counters.h"
 #include "os/fs/FS.h"
 #include "kv/KeyValueDB.h"
+#include "os/kv.h"
 
 #include "kstore_types.h"
 
@@ -393,6 +394,16 @@ private:
   }
 
   void _do_read_stripe(OnodeRef o, uint64_t offset, bufferlist *pbl);
+  int _do_read_extents(OnodeRef o,
+		       const vector<pair<uint64_t, uint64_t> >& extents,
+		       bufferlist& bl);
+  void _get_extent_stripe_keys(OnodeRef o,
+			       const vector<pair<uint64_t, uint64_t> >& extents,
+			       map<string, uint64_t> *keys);
+  int _assemble_extents(OnodeRef o,
+			const vector<pair<uint64_t, uint64_t> >& extents,
+			map<uint64_t, bufferlist>& stripes,
+			bufferlist& bl);
   void _do_write_stripe(TransContext *txc, OnodeRef o,
 			uint64_t offset, bufferlist& bl);
   void _do_remove_stripe(TransContext *txc, OnodeRef o, uint64_t offset);
@@ -475,7 +486,30 @@ public:
     int w,
     vector<int> symbol_ids,
     uint32_t op_flags = 0,
-    bool allow_eio = false) override{return -1;}//add by LYF
+    bool allow_eio = false) override {
+    CollectionRef c = _get_collection(cid);
+    if (!c)
+      return -ENOENT;
+    RWLock::RLocker l(c->lock);
+    OnodeRef o = c->get_onode(oid, false);
+    if (!o || !o->exists)
+      return -ENOENT;
+    if (offset == 0 && len == 0)
+      len = o->onode.size;
+    bl.clear();
+    vector<pair<uint64_t, uint64_t> > extents;
+    get_xor_read_extents(offset, len, chunk_size, packet_size, w, symbol_ids,
+			 &extents);
+    return _do_read_extents(o, extents, bl);
+  }
+  void read_for_xor_batch(
+    CollectionHandle &c_,
+    int stripe_size,
+    int chunk_size,
+    int packet_size,
+    int w,
+    vector<xor_read_t> &reads,
+    bool allow_eio = false) override;
 
   int _do_read(
     OnodeRef o,
@@ -700,4 +734,176 @@ static inline void intrusive_ptr_release(KStore::OpSequencer *o) {
   o->put();
 }
 
+/// stripe keys the extents touch that are not pending in memory,
+/// key -> stripe offset
+inline void KStore::_get_extent_stripe_keys(
+  OnodeRef o,
+  const vector<pair<uint64_t, uint64_t> >& extents,
+  map<string, uint64_t> *keys)
+{
+  uint64_t stripe_size = o->onode.stripe_size;
+  uint64_t size = o->onode.size;
+  if (stripe_size == 0)
+    return;
+  for (auto& e : extents) {
+    if (e.first >= size)
+      continue;
+    uint64_t end = MIN(e.first + e.second, size);
+    for (uint64_t stripe_off = e.first - e.first % stripe_size;
+	 stripe_off < end;
+	 stripe_off += stripe_size) {
+      if (o->pending_stripes.count(stripe_off))
+	continue;
+      // must match get_data_key() in KStore.cc
+      string key;
+      _key_encode_u64(o->onode.nid, &key);
+      _key_encode_u64(stripe_off, &key);
+      (*keys)[key] = stripe_off;
+    }
+  }
+}
+
+/// slice the extents out of the fetched and pending stripes.  holes and
+/// the unwritten tail of a stripe read back as zeros, as in _do_read().
+inline int KStore::_assemble_extents(
+  OnodeRef o,
+  const vector<pair<uint64_t, uint64_t> >& extents,
+  map<uint64_t, bufferlist>& stripes,
+  bufferlist& bl)
+{
+  uint64_t stripe_size = o->onode.stripe_size;
+  uint64_t size = o->onode.size;
+  if (stripe_size == 0)
+    return 0;
+  int got = 0;
+  for (auto& e : extents) {
+    if (e.first >= size)
+      continue;
+    uint64_t pos = e.first;
+    uint64_t end = MIN(e.first + e.second, size);
+    while (pos < end) {
+      uint64_t stripe_off = pos - pos % stripe_size;
+      uint64_t in_off = pos - stripe_off;
+      uint64_t want = MIN(end, stripe_off + stripe_size) - pos;
+      const bufferlist *stripe = nullptr;
+      auto pp = o->pending_stripes.find(stripe_off);
+      if (pp != o->pending_stripes.end()) {
+	stripe = &pp->second;
+      } else {
+	auto sp = stripes.find(stripe_off);
+	if (sp != stripes.end())
+	  stripe = &sp->second;
+      }
+      uint64_t have = 0;
+      if (stripe && stripe->length() > in_off) {
+	have = MIN(want, stripe->length() - in_off);
+	bufferlist t;
+	t.substr_of(*stripe, in_off, have);
+	bl.claim_append(t);
+      }
+      if (have < want)
+	bl.append_zero(want - have);
+      pos += want;
+      got += want;
+    }
+  }
+  return got;
+}
+
+/// read a list of extents, fetching every stripe they touch with a single
+/// multi-key get instead of one kv lookup per stripe.
+inline int KStore::_do_read_extents(
+  OnodeRef o,
+  const vector<pair<uint64_t, uint64_t> >& extents,
+  bufferlist& bl)
+{
+  map<string, uint64_t> key_to_stripe;
+  _get_extent_stripe_keys(o, extents, &key_to_stripe);
+  map<uint64_t, bufferlist> stripes;
+  if (!key_to_stripe.empty()) {
+    set<string> keys;
+    for (auto& p : key_to_stripe)
+      keys.insert(p.first);
+    map<string, bufferlist> values;
+    int r = db->get("D", keys, &values);  // PREFIX_DATA
+    if (r < 0)
+      return r;
+    for (auto& p : values)
+      stripes[key_to_stripe[p.first]].claim(p.second);
+  }
+  return _assemble_extents(o, extents, stripes, bl);
+}
+
+/// symbol reads of many objects served by one multi-key get: the
+/// stripe keys embed the onode nid, so they never collide between
+/// objects.
+inline void KStore::read_for_xor_batch(
+  CollectionHandle &c_,
+  int stripe_size,
+  int chunk_size,
+  int packet_size,
+  int w,
+  vector<xor_read_t> &reads,
+  bool allow_eio)
+{
+  Collection *c = static_cast<Collection*>(c_.get());
+  RWLock::RLocker l(c->lock);
+
+  vector<OnodeRef> onodes(reads.size());
+  vector<vector<pair<uint64_t, uint64_t> > > extents(reads.size());
+  map<string, uint64_t> key_to_stripe;
+  map<string, size_t> key_to_read;
+  for (size_t i = 0; i < reads.size(); ++i) {
+    xor_read_t &rd = reads[i];
+    rd.bl.clear();
+    rd.r = 0;
+    if (!c->exists) {
+      rd.r = -ENOENT;
+      continue;
+    }
+    OnodeRef o = c->get_onode(rd.oid, false);
+    if (!o || !o->exists) {
+      rd.r = -ENOENT;
+      continue;
+    }
+    onodes[i] = o;
+    uint64_t len = rd.len;
+    if (rd.offset == 0 && len == 0)
+      len = o->onode.size;
+    get_xor_read_extents(rd.offset, len, chunk_size, packet_size, w,
+			 rd.symbol_ids, &extents[i]);
+    map<string, uint64_t> keys;
+    _get_extent_stripe_keys(o, extents[i], &keys);
+    for (auto& p : keys) {
+      key_to_stripe[p.first] = p.second;
+      key_to_read[p.first] = i;
+    }
+  }
+
+  vector<map<uint64_t, bufferlist> > stripes(reads.size());
+  if (!key_to_stripe.empty()) {
+    set<string> keys;
+    for (auto& p : key_to_stripe)
+      keys.insert(p.first);
+    map<string, bufferlist> values;
+    int r = db->get("D", keys, &values);  // PREFIX_DATA
+    if (r < 0) {
+      for (auto& rd : reads) {
+	if (rd.r == 0)
+	  rd.r = r;
+      }
+      return;
+    }
+    for (auto& p : values)
+      stripes[key_to_read[p.first]][key_to_stripe[p.first]].claim(p.second);
+  }
+
+  for (size_t i = 0; i < reads.size(); ++i) {
+    if (reads[i].r < 0)
+      continue;
+    reads[i].r = _assemble_extents(onodes[i], extents[i], stripes[i],
+				   reads[i].bl);
+  }
+}
+
 #endif
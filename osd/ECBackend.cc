@@ -23,6 +23,9 @@
 #include "messages/MOSDECSubOpRead.h"
 #include "messages/MOSDECSubOpReadReply.h"
 #include "ECMsgTypes.h"
+#include "common/Finisher.h"
+#include "common/admin_socket.h"
+#include "common/perf_counters.h"
 
 #include "PrimaryLogPG.h"
 
@@ -172,6 +175,8 @@ ostream &operator<<(ostream &lhs, const ECBackend::RecoveryOp &rhs)
 	     << " state=" << ECBackend::RecoveryOp::tostr(rhs.state)
 	     << " waiting_on_pushes=" << rhs.waiting_on_pushes
 	     << " extent_requested=" << rhs.extent_requested
+	     << " extents=" << rhs.extents.size()
+	     << " read_to=" << rhs.read_to
 	     << ")";
 }
 
@@ -186,6 +191,185 @@ void ECBackend::RecoveryOp::dump(Formatter *f) const
   f->dump_stream("state") << tostr(state);
   f->dump_stream("waiting_on_pushes") << waiting_on_pushes;
   f->dump_stream("extent_requested") << extent_requested;
+  f->dump_unsigned("extents", extents.size());
+  f->dump_unsigned("extents_bytes", extents_bytes());
+  f->dump_unsigned("read_to", read_to);
+  f->dump_unsigned("extent_size", extent_size);
+  f->dump_bool("symbol_recovery", symbol_plan != nullptr);
+  f->open_array_section("rx_bytes");
+  for (auto &&i : rx_bytes) {
+    f->open_object_section("helper");
+    f->dump_stream("shard") << i.first;
+    f->dump_unsigned("bytes", i.second);
+    f->close_section();
+  }
+  f->close_section();
+}
+
+/// one planner thread per process: the annealer is CPU bound and
+/// plans are rare, there is no point in a thread per PG
+struct SymbolPlanner {
+  Finisher finisher;
+  Mutex lock;  ///< plans
+  /// a plan only depends on the code, and the erasure code plugin
+  /// registry hands the same codec to every PG of a pool
+  struct codec_plans_t {
+    std::weak_ptr<ErasureCodeInterface> codec;
+    map<int, ECBackend::SymbolRecoveryPlan> plans;  ///< by failed shard
+  };
+  map<const ErasureCodeInterface*, codec_plans_t> plans;
+
+  explicit SymbolPlanner(CephContext *cct)
+    : finisher(cct, "ec_symbol_planner", "ec_planner"),
+      lock("SymbolPlanner::lock") {
+    finisher.start();
+  }
+  ~SymbolPlanner() {
+    finisher.wait_for_empty();
+    finisher.stop();
+  }
+
+  bool get_plan(const ErasureCodeInterfaceRef &codec, int failed,
+		ECBackend::SymbolRecoveryPlan *plan) {
+    Mutex::Locker l(lock);
+    auto p = plans.find(codec.get());
+    // the address may have been reused by another codec
+    if (p == plans.end() || p->second.codec.lock() != codec)
+      return false;
+    auto q = p->second.plans.find(failed);
+    if (q == p->second.plans.end())
+      return false;
+    *plan = q->second;
+    return true;
+  }
+  void add_plan(const ErasureCodeInterfaceRef &codec,
+		const ECBackend::SymbolRecoveryPlan &plan) {
+    Mutex::Locker l(lock);
+    for (auto p = plans.begin(); p != plans.end();) {
+      if (p->second.codec.expired())
+	plans.erase(p++);
+      else
+	++p;
+    }
+    codec_plans_t &c = plans[codec.get()];
+    c.codec = codec;
+    c.plans.insert(make_pair(plan.failed, plan));
+  }
+};
+
+enum {
+  l_ec_symbol_first = 95000,
+  l_ec_symbol_plan_lat,
+  l_ec_symbol_plan_hit,
+  l_ec_symbol_plan_miss,
+  l_ec_symbol_extents,
+  l_ec_symbol_packets,
+  l_ec_symbol_packets_full,
+  l_ec_symbol_rx_bytes,
+  l_ec_symbol_decode_lat,
+  l_ec_symbol_decode_bytes,
+  l_ec_symbol_gather,
+  l_ec_symbol_gather_extents,
+  l_ec_symbol_gather_bytes,
+  l_ec_symbol_last,
+};
+
+/// process wide symbol recovery counters, and the backends walked by
+/// the dump_ec_symbol_plans admin socket command
+struct SymbolRecoveryMetrics : public AdminSocketHook {
+  CephContext *cct;
+  PerfCounters *logger = nullptr;
+  Mutex lock;  ///< backends
+  set<ECBackend*> backends;
+
+  explicit SymbolRecoveryMetrics(CephContext *cct)
+    : cct(cct), lock("SymbolRecoveryMetrics::lock") {
+    PerfCountersBuilder b(cct, "ec_symbol_recovery",
+			  l_ec_symbol_first, l_ec_symbol_last);
+    b.add_time_avg(l_ec_symbol_plan_lat, "plan_search_lat",
+		   "Time spent annealing a symbol recovery plan");
+    b.add_u64_counter(l_ec_symbol_plan_hit, "plan_hit",
+		      "Recovery ops started with a cached plan");
+    b.add_u64_counter(l_ec_symbol_plan_miss, "plan_miss",
+		      "Recovery ops started without a plan");
+    b.add_u64_counter(l_ec_symbol_extents, "extents",
+		      "Extents recovered from symbols");
+    b.add_u64_counter(l_ec_symbol_packets, "packets",
+		      "Packets requested from helpers");
+    b.add_u64_counter(l_ec_symbol_packets_full, "packets_full",
+		      "Packets whole chunk reads of the same extents need");
+    b.add_u64_counter(l_ec_symbol_rx_bytes, "rx_bytes",
+		      "Symbol bytes received from recovery helpers");
+    b.add_time_avg(l_ec_symbol_decode_lat, "decode_lat",
+		   "Time spent decoding an extent recovered from symbols");
+    b.add_u64_counter(l_ec_symbol_decode_bytes, "decode_bytes",
+		      "Bytes decoded or XORed from symbols");
+    b.add_u64_counter(l_ec_symbol_gather, "gather",
+		      "Symbol gathers issued to the store by a helper");
+    b.add_u64_counter(l_ec_symbol_gather_extents, "gather_extents",
+		      "Extents read by symbol gathers");
+    b.add_u64_counter(l_ec_symbol_gather_bytes, "gather_bytes",
+		      "Bytes read by symbol gathers");
+    logger = b.create_perf_counters();
+    cct->get_perfcounters_collection()->add(logger);
+
+    int r = cct->get_admin_socket()->register_command(
+      "dump_ec_symbol_plans", "dump_ec_symbol_plans", this,
+      "dump the symbol recovery plans of every EC PG");
+    assert(r == 0);
+  }
+  ~SymbolRecoveryMetrics() override {
+    cct->get_admin_socket()->unregister_command("dump_ec_symbol_plans");
+    cct->get_perfcounters_collection()->remove(logger);
+    delete logger;
+  }
+
+  void add(ECBackend *ec) {
+    Mutex::Locker l(lock);
+    backends.insert(ec);
+  }
+  void remove(ECBackend *ec) {
+    Mutex::Locker l(lock);
+    backends.erase(ec);
+  }
+
+  bool call(std::string command, cmdmap_t& cmdmap, std::string format,
+	    bufferlist& out) override {
+    Formatter *f = Formatter::create(format, "json-pretty", "json-pretty");
+    f->open_array_section("pgs");
+    {
+      Mutex::Locker l(lock);
+      for (auto ec : backends) {
+	f->open_object_section("pg");
+	f->dump_stream("pgid") << ec->get_parent()->whoami_spg_t();
+	ec->dump_symbol_recovery(f);
+	f->close_section();
+      }
+    }
+    f->close_section();
+    stringstream ss;
+    f->flush(ss);
+    delete f;
+    out.append(ss);
+    return true;
+  }
+};
+
+/// packets a symbol read moves for every row of w packets in a chunk,
+/// partial parities when helpers aggregate
+static uint64_t symbol_packets_per_row(
+  const ECUtil::xor_aggregation_plan_t &xor_plan,
+  const map<pg_shard_t, vector<int> > &sources)
+{
+  uint64_t per_row = 0;
+  if (!xor_plan.empty()) {
+    for (auto &&i : xor_plan.shards)
+      per_row += i.second.packets_per_row();
+  } else {
+    for (auto &&i : sources)
+      per_row += i.second.size();
+  }
+  return per_row;
 }
 
 ECBackend::ECBackend(
@@ -197,10 +381,30 @@ ECBackend::ECBackend(
   ErasureCodeInterfaceRef ec_impl,
   uint64_t stripe_width)
   : PGBackend(cct, pg, store, coll, ch),
+    symbol_plan_lock("ECBackend::symbol_plan_lock"),
     ec_impl(ec_impl),
     sinfo(ec_impl->get_data_chunk_count(), stripe_width) {
   assert((ec_impl->get_data_chunk_count() *
 	  ec_impl->get_chunk_size(stripe_width)) == stripe_width);
+  cct->lookup_or_create_singleton_object<SymbolPlanner>(
+    symbol_planner, "ECBackend::symbol_planner");
+  ec_caps = ec_impl->get_capabilities();
+  SymbolRecoveryMetrics *metrics = nullptr;
+  cct->lookup_or_create_singleton_object<SymbolRecoveryMetrics>(
+    metrics, "ECBackend::symbol_recovery_metrics");
+  symbol_metrics = metrics;
+  symbol_logger = metrics->logger;
+  metrics->add(this);
+  symbol_plan_target = std::make_shared<SymbolPlanTarget>(this);
+}
+
+ECBackend::~ECBackend()
+{
+  symbol_metrics->remove(this);
+  // plans still queued or annealing no longer call back into us; this
+  // only waits for a plan being handed over right now
+  Mutex::Locker l(symbol_plan_target->lock);
+  symbol_plan_target->ec = nullptr;
 }
 
 PGBackend::RecoveryHandle *ECBackend::open_recovery_op()
@@ -214,10 +418,14 @@ void ECBackend::_failed_push(const hobject_t &hoid,
   ECBackend::read_result_t &res = in.second;
   dout(10) << __func__ << ": Read error " << hoid << " r="
 	   << res.r << " errors=" << res.errors << dendl;
+  if (!recovery_ops.count(hoid)) {
+    // another extent read ahead already failed the op
+    dout(10) << __func__ << ": " << hoid << " already canceled" << dendl;
+    return;
+  }
   dout(10) << __func__ << ": canceling recovery op for obj " << hoid
 	   << dendl;
-  assert(recovery_ops.count(hoid));
-  recovery_ops.erase(hoid);
+  erase_recovery_op(hoid);
 
   list<pg_shard_t> fl;
   for (auto&& i : res.errors) {
@@ -251,17 +459,32 @@ struct OnRecoveryReadComplete :
 struct RecoveryMessages {
   map<hobject_t,
       ECBackend::read_request_t> reads;
+  /// further extents of objects already in reads, one read op each so
+  /// that every extent completes on its own
+  list<map<hobject_t, ECBackend::read_request_t> > reads_ahead;
+  map<hobject_t, ECBackend::read_request_t> &reads_for(const hobject_t &hoid) {
+    if (!reads.count(hoid))
+      return reads;
+    for (auto &&i : reads_ahead) {
+      if (!i.count(hoid))
+	return i;
+    }
+    reads_ahead.push_back(map<hobject_t, ECBackend::read_request_t>());
+    return reads_ahead.back();
+  }
   void read(ECBackend *ec, const hobject_t &hoid, uint64_t off, uint64_t len, const set<pg_shard_t> &need, bool attrs) {
     list<boost::tuple<uint64_t, uint64_t, uint32_t> > to_read;
     to_read.push_back(boost::make_tuple(off, len, 0));
-    assert(!reads.count(hoid));
-    reads.insert(make_pair(hoid, ECBackend::read_request_t(to_read, need, attrs, new OnRecoveryReadComplete(ec, hoid))));
+    reads_for(hoid).insert(make_pair(hoid, ECBackend::read_request_t(to_read, need, attrs, new OnRecoveryReadComplete(ec, hoid))));
   }
-  void read_for_xor(ECBackend *ec, const hobject_t &hoid, uint64_t off, uint64_t len, const set<pg_shard_t> &need, bool attrs, map<pg_shard_t, vector<int> > solution) {
+  void read_for_xor(ECBackend *ec, const hobject_t &hoid, uint64_t off, uint64_t len, const set<pg_shard_t> &need, bool attrs, map<pg_shard_t, vector<int> > solution,
+		    const map<pg_shard_t, vector<uint64_t> > &combinations = map<pg_shard_t, vector<uint64_t> >()) {
     list<boost::tuple<uint64_t, uint64_t, uint32_t> > to_read;
-    to_read.push_back(boost::make_tuple(off, len, 0));
-    assert(!reads.count(hoid));
-    reads.insert(make_pair(hoid,ECBackend::read_request_t(to_read,need,attrs,solution,new OnRecoveryReadComplete(ec,hoid))));
+    // the gathered symbols are consumed once by the decode; keep them
+    // from displacing client data in the helpers' page cache
+    to_read.push_back(boost::make_tuple(off, len, CEPH_OSD_OP_FLAG_FADVISE_DONTNEED));
+    auto r = reads_for(hoid).insert(make_pair(hoid,ECBackend::read_request_t(to_read,need,attrs,solution,new OnRecoveryReadComplete(ec,hoid))));
+    r.first->second.combinations = combinations;
   }
   map<pg_shard_t, vector<PushOp> > pushes;
   map<pg_shard_t, vector<PushReplyOp> > push_replies;
@@ -382,29 +605,72 @@ void ECBackend::handle_recovery_read_complete(
 	   << ", " << to_read.get<2>()
 	   << ")"
 	   << dendl;
-  assert(recovery_ops.count(hoid));
-  RecoveryOp &op = recovery_ops[hoid];
-  assert(op.returned_data.empty());
+  map<hobject_t, RecoveryOp>::iterator opiter = recovery_ops.find(hoid);
+  if (opiter == recovery_ops.end()) {
+    dout(10) << __func__ << ": " << hoid << " canceled, dropping read" << dendl;
+    return;
+  }
+  RecoveryOp &op = opiter->second;
+  map<uint64_t, RecoveryOp::extent_t>::iterator ext =
+    op.extents.find(to_read.get<0>());
+  if (ext == op.extents.end() || ext->second.decoded) {
+    dout(10) << __func__ << ": " << hoid << " stale read of "
+	     << to_read.get<0>() << ", dropping" << dendl;
+    return;
+  }
   map<int, bufferlist*> target;
   for (set<shard_id_t>::iterator i = op.missing_on_shards.begin(); i != op.missing_on_shards.end(); ++i) {
-    target[*i] = &(op.returned_data[*i]);
+    target[*i] = &(ext->second.returned_data[*i]);
   }
+  RecoveryOp::extent_t &e = ext->second;
+  const bool symbols = !e.xor_plan.empty() || e.symbol_plan;
   map<int, bufferlist> from;
-  for(map<pg_shard_t, bufferlist>::iterator i = to_read.get<2>().begin(); i != to_read.get<2>().end(); ++i) {
+  if (symbols) {
+    uint64_t rx_bytes = 0;
+    Mutex::Locker l(symbol_plan_lock);
+    for (map<pg_shard_t, bufferlist>::iterator i = to_read.get<2>().begin(); i != to_read.get<2>().end(); ++i) {
+      op.rx_bytes[i->first] += i->second.length();
+      recovery_rx_bytes[i->first] += i->second.length();
+      rx_bytes += i->second.length();
+    }
+    symbol_logger->inc(l_ec_symbol_rx_bytes, rx_bytes);
+  }
+  for (map<pg_shard_t, bufferlist>::iterator i = to_read.get<2>().begin(); i != to_read.get<2>().end(); ++i) {
     from[i->first.shard].claim(i->second);
   }
   dout(10) << __func__ << ": " << from << dendl;
   int r = -1;
-  string profile = get_parent()->get_pool().erasure_code_profile;
-  string technique = get_osdmap()->get_erasure_code_profile(profile).find("technique")->second;
-  if((technique == "cauchy_good" || technique == "liber8tion" || technique == "blaum_roth") && !solution_int.empty()){ 
-     int w = ec_impl->get_symbol_count();
-     int packet_size = ec_impl->get_packetsize();
-     r = ECUtil::decode_for_xor(sinfo, ec_impl, from, target, solution_int, w, packet_size,parity_group_selection);
+  utime_t decode_start = ceph_clock_now();
+  if (!e.xor_plan.empty()) {
+    assert(target.size() == 1);
+    r = ECUtil::decode_xor_aggregation(e.xor_plan, ec_caps.w,
+				       ec_caps.packetsize, from,
+				       target.begin()->second);
+  } else if (e.symbol_plan) {
+     for (map<int, pair<uint64_t, bufferlist> >::iterator i = e.reused_symbols.begin();
+	  i != e.reused_symbols.end();
+	  ++i) {
+       uint64_t want = ECSubRead::symbols_to_mask(e.symbol_plan->solution[i->first]);
+       bufferlist merged;
+       ECUtil::merge_symbols(i->second.second, i->second.first,
+			     from[i->first], want & ~i->second.first,
+			     want, ec_caps.packetsize, &merged);
+       from[i->first].swap(merged);
+     }
+     e.reused_symbols.clear();
+     r = ECUtil::decode_for_xor(sinfo, ec_impl, from, target, e.symbol_plan->solution, ec_caps.w, ec_caps.packetsize, e.symbol_plan->parity_group_selection.data());
   }else{
   	r = ECUtil::decode(sinfo, ec_impl, from, target);
   }
   assert(r == 0);
+  if (symbols) {
+    uint64_t decoded = 0;
+    for (auto &&i : target)
+      decoded += i.second->length();
+    symbol_logger->tinc(l_ec_symbol_decode_lat, ceph_clock_now() - decode_start);
+    symbol_logger->inc(l_ec_symbol_decode_bytes, decoded);
+  }
+  e.decoded = true;
   if (attrs) {
     op.xattrs.swap(*attrs);
 
@@ -510,13 +776,113 @@ void ECBackend::dispatch_recovery_messages(RecoveryMessages &m, int priority)
     get_parent()->queue_transaction(std::move(m.t));
   } 
 
-  if (m.reads.empty())
-    return;
-  start_read_op(
-    priority,
-    m.reads,
-    OpRequestRef(),
-    false, true);
+  if (!m.reads.empty()) {
+    start_read_op(
+      priority,
+      m.reads,
+      OpRequestRef(),
+      false, true);
+  }
+  for (auto &&i : m.reads_ahead) {
+    start_read_op(
+      priority,
+      i,
+      OpRequestRef(),
+      false, true);
+  }
+}
+
+uint64_t ECBackend::get_recovery_chunk_size(const RecoveryOp &op) const
+{
+  uint64_t chunk = get_recovery_chunk_size();
+  if (!op.symbol_plan)
+    return chunk;
+  uint64_t k = ec_impl->get_data_chunk_count();
+  uint64_t w = ec_caps.w;
+  uint64_t packet_size = ec_caps.packetsize;
+  // whole stripes, and a whole number of packet rows in every chunk
+  uint64_t unit = sinfo.get_stripe_width();
+  while (unit % (k * w * packet_size))
+    unit += sinfo.get_stripe_width();
+
+  // packets on the wire per row, against k * w for whole chunks
+  uint64_t per_row = symbol_packets_per_row(op.xor_plan, op.symbol_sources);
+  if (!per_row)
+    return chunk;
+  uint64_t amount = cct->_conf->osd_recovery_max_chunk * k * w / per_row;
+  amount -= amount % unit;
+  return MAX(amount, unit);
+}
+
+bool ECBackend::issue_recovery_reads(
+  RecoveryOp &op,
+  RecoveryMessages *m)
+{
+  uint64_t amount = get_recovery_chunk_size(op);
+  op.extent_size = amount;
+  // the object size is only known once the first read brought the attrs
+  unsigned depth = 1;
+  uint64_t end = 0;
+  if (op.obc) {
+    depth = MAX(1, cct->_conf->osd_recovery_pipeline_depth);
+    end = sinfo.logical_to_next_stripe_offset(op.obc->obs.oi.size);
+  }
+  uint64_t max_bytes = cct->_conf->osd_recovery_pipeline_max_bytes;
+  uint64_t bytes = op.extents_bytes();
+  set<int> want(op.missing_on_shards.begin(), op.missing_on_shards.end());
+
+  while (op.extents.size() < depth) {
+    // always keep the extent to push next in flight
+    if (!op.extents.empty() &&
+	(!op.obc || op.read_to >= end ||
+	 (max_bytes && bytes + amount > max_bytes)))
+      break;
+
+    set<pg_shard_t> to_read;
+    int r = -1;
+    if (op.symbol_plan) {
+      r = get_min_avail_to_read_shards_hybrid_solution(op.hoid, want, true, false, &to_read, op.symbol_sources);
+    } else {
+      r = get_min_avail_to_read_shards(op.hoid, want, true, false, &to_read);
+    }
+    if (r != 0) {
+      // we must have lost a recovery source
+      assert(!op.recovery_progress.first);
+      dout(10) << __func__ << ": canceling recovery op for obj " << op.hoid << dendl;
+      get_parent()->cancel_pull(op.hoid);
+      erase_recovery_op(op.hoid);
+      return false;
+    }
+
+    RecoveryOp::extent_t &e = op.extents[op.read_to];
+    e.length = amount;
+    e.symbol_plan = op.symbol_plan;
+    e.symbol_sources = op.symbol_sources;
+    e.xor_plan = op.xor_plan;
+    bool attrs = op.recovery_progress.first && !op.obc;
+    if (op.symbol_plan) {
+      map<pg_shard_t, vector<uint64_t> > combinations;
+      for (set<pg_shard_t>::iterator i = to_read.begin(); i != to_read.end(); ++i) {
+	auto s = op.xor_plan.shards.find(i->shard);
+	if (s != op.xor_plan.shards.end() && s->second.aggregated)
+	  combinations[*i] = s->second.combinations;
+      }
+      m->read_for_xor(this, op.hoid, op.read_to, amount, to_read, attrs, op.symbol_sources, combinations);
+      uint64_t rows = amount / (ec_impl->get_data_chunk_count() *
+				ec_caps.w * ec_caps.packetsize);
+      symbol_logger->inc(l_ec_symbol_extents);
+      symbol_logger->inc(l_ec_symbol_packets,
+			 rows * symbol_packets_per_row(op.xor_plan, op.symbol_sources));
+      symbol_logger->inc(l_ec_symbol_packets_full,
+			 rows * ec_impl->get_data_chunk_count() * ec_caps.w);
+    } else {
+      m->read(this, op.hoid, op.read_to, amount, to_read, attrs);
+    }
+    op.extent_requested = make_pair(op.read_to, amount);
+    op.read_to += amount;
+    bytes += amount;
+  }
+  return true;
 }
 
 void ECBackend::continue_recovery_op(
@@ -530,9 +896,8 @@ void ECBackend::continue_recovery_op(
       // start read
       op.state = RecoveryOp::READING;
       assert(!op.recovery_progress.data_complete);
-      set<int> want(op.missing_on_shards.begin(), op.missing_on_shards.end());
-      uint64_t from = op.recovery_progress.data_recovered_to;
-      uint64_t amount = get_recovery_chunk_size();
+      assert(op.extents.empty());
+      op.read_to = op.recovery_progress.data_recovered_to;
 
       if (op.recovery_progress.first && op.obc) {
 	/* We've got the attrs and the hinfo, might as well use them */
@@ -541,40 +906,25 @@ void ECBackend::continue_recovery_op(
 	op.xattrs = op.obc->attr_cache;
 	::encode(*(op.hinfo), op.xattrs[ECUtil::get_hinfo_key()]);
       }
-
-      set<pg_shard_t> to_read;
-      int r = -1;
-      if(xor_tech.find(op.hoid) != xor_tech.end()){
-      	r = get_min_avail_to_read_shards_hybrid_solution(op.hoid, want, true, false, &to_read, ECBackend::solution_pg_shard_t);
-      }else{
-      	r = get_min_avail_to_read_shards(op.hoid, want, true, false, &to_read);
-      } 
-      if (r != 0) {
-	// we must have lost a recovery source
-	assert(!op.recovery_progress.first);
-	dout(10) << __func__ << ": canceling recovery op for obj " << op.hoid << dendl;
-	get_parent()->cancel_pull(op.hoid);
-	recovery_ops.erase(op.hoid);
-	return;
-      }
-      if(xor_tech.find(op.hoid) != xor_tech.end()){
-      	m->read_for_xor(this,op.hoid,op.recovery_progress.data_recovered_to,amount,to_read,op.recovery_progress.first && !op.obc,solution_pg_shard_t);
-      }else{
-      	m->read(this, op.hoid, op.recovery_progress.data_recovered_to, amount, to_read, op.recovery_progress.first && !op.obc);
-      }
-      op.extent_requested = make_pair(
-	from,
-	amount);
-      dout(10) << __func__ << ": IDLE return " << op << dendl;
-      return;
+      continue;
     }
     case RecoveryOp::READING: {
+      if (!issue_recovery_reads(op, m))
+	return;  // lost a recovery source, op is gone
+      map<uint64_t, RecoveryOp::extent_t>::iterator ext =
+	op.extents.find(op.recovery_progress.data_recovered_to);
+      assert(ext != op.extents.end());
+      if (!ext->second.decoded) {
+	dout(10) << __func__ << ": READING waiting " << op << dendl;
+	return;
+      }
       // read completed, start write
       assert(op.xattrs.size());
-      assert(op.returned_data.size());
+      map<int, bufferlist> &returned_data = ext->second.returned_data;
+      assert(returned_data.size());
       op.state = RecoveryOp::WRITING;
       ObjectRecoveryProgress after_progress = op.recovery_progress;
-      after_progress.data_recovered_to += op.extent_requested.second;
+      after_progress.data_recovered_to += ext->second.length;
       after_progress.first = false;
       if (after_progress.data_recovered_to >= op.obc->obs.oi.size) {
 	after_progress.data_recovered_to =
@@ -585,12 +935,12 @@ void ECBackend::continue_recovery_op(
       for (set<pg_shard_t>::iterator mi = op.missing_on.begin();
 	   mi != op.missing_on.end();
 	   ++mi) {
-	assert(op.returned_data.count(mi->shard));
+	assert(returned_data.count(mi->shard));
 	m->pushes[*mi].push_back(PushOp());
 	PushOp &pop = m->pushes[*mi].back();
 	pop.soid = op.hoid;
 	pop.version = op.v;
-	pop.data = op.returned_data[mi->shard];
+	pop.data = returned_data[mi->shard];
 	dout(10) << __func__ << ": before_progress=" << op.recovery_progress
 		 << ", after_progress=" << after_progress
 		 << ", pop.data.length()=" << pop.data.length()
@@ -618,9 +968,12 @@ void ECBackend::continue_recovery_op(
 	    *mi,
 	    op.hoid);
       }
-      op.returned_data.clear();
+      op.extents.erase(ext);
       op.waiting_on_pushes = op.missing_on;
       op.recovery_progress = after_progress;
+      // the freed slot goes to the next extent while this one is pushed
+      if (!op.recovery_progress.data_complete && !issue_recovery_reads(op, m))
+	return;
       dout(10) << __func__ << ": READING return " << op << dendl;
       return;
     }
@@ -646,18 +999,10 @@ void ECBackend::continue_recovery_op(
 	  stat.num_objects_recovered = 1;
 	  get_parent()->on_global_recover(op.hoid, stat);
 	  dout(10) << __func__ << ": WRITING return " << op << dendl;
-	  recovery_ops.erase(op.hoid);
-	  if(xor_tech.find(op.hoid) != xor_tech.end())
-	  {
-	  	delete[] parity_group_selection;
-	  	solution_int.erase(solution_int.begin(),solution_int.end());
-	  	solution_pg_shard_t.erase(solution_pg_shard_t.begin(), solution_pg_shard_t.end());
-	  	xor_tech.erase(op.hoid);
-		dout(0) << "ending recovery" << dendl;
-	  }
+	  erase_recovery_op(op.hoid);
 	  return;
 	} else {
-	  op.state = RecoveryOp::IDLE;
+	  op.state = RecoveryOp::READING;
 	  dout(10) << __func__ << ": WRITING continue " << op << dendl;
 	  continue;
 	}
@@ -673,789 +1018,52 @@ void ECBackend::continue_recovery_op(
   }
 }
 
-//add by LYF, climb_search
-int ECBackend::different_failed_blocks(int m, int k, int w, int failed_disk_id, int param_row1, int param_row2, int *generator_matrix)
+bool ECBackend::peer_supports_symbol_reads(pg_shard_t shard)
 {
-	for (int j=0;j<w;j++)
-	{
-		if (generator_matrix[param_row1*k*w+failed_disk_id*w+j]!=generator_matrix[param_row2*k*w+failed_disk_id*w+j])
-		{
-			return 1;
-		}
-   	}
-	return 0;
+  if (shard == get_parent()->whoami_shard())
+    return true;
+  return HAVE_FEATURE(get_osdmap()->get_xinfo(shard.osd).features,
+		      OSD_EC_SYMBOL_READ);
 }
-int ECBackend::count_rows_intersections_num(int m, int k, int w, int failed_disk_id, int param_row1, int param_row2, int *generator_matrix)
+
+bool ECBackend::peers_support_symbol_reads(
+  const map<pg_shard_t, vector<int> > &sources)
 {
-	int intersections_count=0;
-	for (int i=0;i<(k*w);i++)
-	{
-       	if ((i/w)!=failed_disk_id)
-       	{
-       		if ((generator_matrix[param_row1*k*w+i]==0)&&(generator_matrix[param_row2*k*w+i]==0))
-       		{
-       			intersections_count++;
-       		}
-        }
+  for (map<pg_shard_t, vector<int> >::const_iterator i = sources.begin();
+       i != sources.end();
+       ++i) {
+    if (!peer_supports_symbol_reads(i->first)) {
+      dout(10) << __func__ << ": " << i->first
+	       << " lacks OSD_EC_SYMBOL_READ, reading full chunks" << dendl;
+      return false;
     }
-    return intersections_count;
-}
-void ECBackend::construct_rows_intersection_infor_matrix(int m, int k, int w, int failed_disk_id, int *generator_matrix)
-{
-	rows_intersection_infor= (int*)malloc(sizeof(int)*(m*w)*(m*w));
-	for (int i=0;i<(m*w);i++)
-	{
-		for (int j=i;j<(m*w);j++) 
-		{
-			if (i==j) 
-			{
-				rows_intersection_infor[i*m*w+j]= -1;
-			}
-			else 
-			{
-             	if (different_failed_blocks(m,k,w,failed_disk_id,i,j,generator_matrix)) 
-             	{
-             		rows_intersection_infor[i*m*w+j]=count_rows_intersections_num(m,k,w,failed_disk_id, i,j,generator_matrix);
-             	}
-				else 
-				{
-					rows_intersection_infor[i*m*w+j]= -1;
-				}
-				rows_intersection_infor[j*m*w+i]=rows_intersection_infor[i*m*w+j];
-			}
-		}
-	}
-}
-int ECBackend::calculate_blocks_savings( int m, int k, int w, int failed_disk_id, int *generator_matrix, int *crs_parity_group_selection) 
-{
-	int blocks_savings=0;
-	for (int i=0;i<k*w;i++) 
-	{
-		if ((i/w)!=failed_disk_id) 
-		{
-			int tmp_saving=1;
-			for (int j=0;j<m*w;j++) 
-			{
-				if (crs_parity_group_selection[j]==1) 
-				{
-					//This parity symbol is selected to participate in recovery
-					if (generator_matrix[j*k*w+i]==1) 
-					{
-						tmp_saving=0;
-						break;
-					}
-				}
-			}
-			blocks_savings=blocks_savings+tmp_saving;
-		}
-	}
-	return blocks_savings;
-}
-void ECBackend::int2bin(int integer, int *binary, int array_len) 
-{
-	int k = 0, n = 0;
-	int remain;
-	int *temp = new int[array_len];
-	do {
-		remain = integer % 2;
-		integer = integer / 2;
-		temp[k++] = remain;
-	} while (integer > 0);
-	//Fill 0 into the convert arra
-	while (k<array_len) 
-	{
-		temp[k++]=0;
-	}
-	while (k >= 0) 
-	{
-		binary[n++] = temp[--k];
-	}
-	delete[] temp;
+  }
+  return true;
 }
-int ECBackend::not_in_failed_disk_selection(int m, int k, int w, int failed_disk_id, int *generator_matrix,int row) 
-{
-	int i, j, t;
-	j=0;
-	if (crs_hybrid_parity_group_selection[row]==1) 
-	{
-		return 0;
-	}//The line row is already in the selection and cannot be replaced again
-	int source_num, search_scale;
-	search_scale=0;
-	source_num=0; 
-	for (i=0;i<m*w;i++) 
-	{
-		if (crs_hybrid_parity_group_selection[i]==1) 
-		{
-			source_num++;
-		}
-	}//An option has been deleted, and it should be w-1
-	int* temp_array = new int[source_num];
-	for (i=0;i<m*w;i++) 
-	{
-		if (crs_hybrid_parity_group_selection[i]==1) 
-		{
-			temp_array[j]=i;
-			j++;
-		}
-	}//temp_array saves: the index of 1 in crs_hybrid_parity_group_selection, which represents which parity symbol participates in reconstruction
-	search_scale=1<<source_num; //Be equal to 2^source_num,When source_num is equal to 2, search_scale is equal to 4
-	int* binaryArray=new int[source_num];
-	int* temp_sum = new int[w];
-	for (i=0;i<search_scale;i++) 
-	{
-		memset(temp_sum,0,sizeof(int)*w);
-		int2bin(i,binaryArray,source_num);
-		for (j=0;j<source_num;j++) 
-		{
-			if (binaryArray[j]==1) 
-			{
-				for (t=0;t<w;t++) 
-				{
-					if (generator_matrix[temp_array[j]*k*w+failed_disk_id*w+t]==temp_sum[t]) 
-					{
-						temp_sum[t]=0;
-					} 
-					else 
-					{
-						temp_sum[t]=1;
-					}
-				}
-			}
-		}
-		for (t=0;t<w;t++) 
-		{
-			if (temp_sum[t]!=generator_matrix[row*k*w+failed_disk_id*w+t]) 
-			{
-				break;
-			}
-		}
-		if (t==w) 
-		{
-			return 0;
-		}
 
-	}
-	delete[] temp_array;
-	delete[] temp_sum;
-	delete[] binaryArray;
-	return 1;
-}
-int ECBackend::judge_the_better_candidate(int m, int w, int failed_disk_id, int candidate_one, int candidate_two)
-{
-	int candidate1_sum, candidate2_sum;
-	candidate1_sum=0;
-	candidate2_sum=0;
-	for(int i=0;i<(m*w);i++)
-	{
-		if ((i != candidate_one) && (i != candidate_two) && ((i / w) != failed_disk_id)) 
-		{
-			candidate1_sum = candidate1_sum + rows_intersection_infor[candidate_one*m*w + i];
-		}
-	}
-	for (int i=0;i<(m*w);i++)
-	{
-		if ((i != candidate_one) && (i != candidate_two) && ((i / w) != failed_disk_id))
-		{
-			candidate2_sum = candidate2_sum + rows_intersection_infor[candidate_two*m*w + i];
-		}
-	}
-	if (candidate1_sum>=candidate2_sum)
-	{
-		return 1;
-	} 
-	else 
-	{
-		return 0;
-	}
-}
-int ECBackend::crs_better_recovery_exist(int m, int k, int w, int failed_disk_id, int* candidate_replace_parity_groups, int *generator_matrix)
-{
-	int i, j;
-	int optimal_j= -1; 
-	int selected_candidate= -1;
-	for (i=0;i<(m*w);i++) 
-	{
-		if (candidate_replace_parity_groups[i]== 1) 
-		{
-			for (j=0;j<(m*w);j++) 
-			{
-				if (crs_hybrid_parity_group_selection[j]== 1) 
-				{
-					crs_hybrid_parity_group_selection[j]= 0;
-					if (not_in_failed_disk_selection(m,k,w,failed_disk_id,generator_matrix, i))
-					{
-						crs_hybrid_parity_group_selection[i]=1;
-						int savings=calculate_blocks_savings(m,k,w,failed_disk_id, generator_matrix,crs_hybrid_parity_group_selection);
-						if (savings>crs_hybrid_profit) 
-						{
-							crs_hybrid_profit=savings;
-							optimal_j=j;
-							selected_candidate=i;
-						} 
-						else if (savings==crs_hybrid_profit) 
-						{
-							if (optimal_j == -1) 
-							{
-								crs_hybrid_profit = savings;
-								optimal_j = j;
-								selected_candidate = i;
-							}
-							else if(judge_the_better_candidate(m, w, failed_disk_id,j,optimal_j)== 1) 
-							{
-								crs_hybrid_profit=savings;
-								optimal_j=j;
-								selected_candidate=i;
-							}
-                	    }
-						crs_hybrid_parity_group_selection[i]= 0;
-					}
-					crs_hybrid_parity_group_selection[j]= 1;
-				}
-			}
-		}
-    	}	
-    	if (optimal_j != -1) 
-    	{
-        	crs_hybrid_parity_group_selection[optimal_j]= 0;
-        	crs_hybrid_parity_group_selection[selected_candidate]= 1;
-    	}
-	return selected_candidate;
-}
-void ECBackend::crs_adjust_recovery_vector_in_adjustment(int m, int k, int w, int failed_disk_id, int fixed_parity_node, int star_parity_node, int pre_fixed_parity_node, int *generator_matrix)
-{
-	int i, j;
-	int tmp_replaced;
-	int tmp_crs_hybrid_profit;
-	int* tmp_crs_failed_disk_selection = new int[m*w];
-	tmp_crs_hybrid_profit = crs_hybrid_profit;
-    for (i = 0; i<(m*w); i++) 
-    {
-		tmp_crs_failed_disk_selection[i] = crs_hybrid_parity_group_selection[i];
-	}
-	int* candidate_replace_parity_groups = new int[m*w];
-	for (i = 0; i<m; i++)
-	{
-		if (((i<pre_fixed_parity_node) || (i == star_parity_node)) || (i<fixed_parity_node))
-		{
-			for (j = 0; j<(m*w); j++) 
-			{
-				if ((j / w) == i) 
-				{
-					candidate_replace_parity_groups[j] = 1;
-				}
-				else 
-				{
-					candidate_replace_parity_groups[j] = 0;
-				}
-			}
-			while ((tmp_replaced = crs_better_recovery_exist(m, k, w, failed_disk_id, candidate_replace_parity_groups, generator_matrix)) != -1) 
-			{
-				candidate_replace_parity_groups[tmp_replaced] = 0;
-			}
-		}
-	}
-	if (crs_hybrid_profit <= tmp_crs_hybrid_profit) 
-	{
-		crs_hybrid_profit = tmp_crs_hybrid_profit;
-		for (i = 0; i<(m*w); i++) 
-		{
-			crs_hybrid_parity_group_selection[i] = tmp_crs_failed_disk_selection[i];
-		}
-	}
-	delete[] tmp_crs_failed_disk_selection;
-}
-void ECBackend::crs_adjust_recovery_vector(int m, int k, int w, int failed_disk_id, int fixed_parity_disk, int star_parity_disk, int *generator_matrix)
-{
-	int i, j;
-	int tmp_replaced;
-	int tmp_crs_hybrid_profit;
-	int* tmp_crs_failed_disk_selection = new int[m*w];
-	tmp_crs_hybrid_profit = crs_hybrid_profit;
-	for (i = 0; i<(m*w); i++)
-	{
-		tmp_crs_failed_disk_selection[i] = crs_hybrid_parity_group_selection[i];
-	}
-	int* candidate_replace_parity_groups = new int[m*w];
-	for (i = 0; i<m; i++)
-	{
-		if ((i<fixed_parity_disk) || (i == star_parity_disk))
-		{
-			for (j = 0; j<(m*w); j++)
-			{
-				if ((j / w) == i) 
-				{
-					candidate_replace_parity_groups[j] = 1;
-				}
-				else 
-				{
-					candidate_replace_parity_groups[j] = 0;
-				}
-			}
-			while ((tmp_replaced = crs_better_recovery_exist(m, k, w, failed_disk_id, candidate_replace_parity_groups, generator_matrix)) != -1)
-			{
-				candidate_replace_parity_groups[tmp_replaced] = 0;
-			}
-			crs_adjust_recovery_vector_in_adjustment(m, k, w, failed_disk_id, i, star_parity_disk, fixed_parity_disk, generator_matrix);
-		}
-	}
-	for (i = 0; i<(m*w); i++) 
-	{
-		if ((i / w) == fixed_parity_disk) 
-		{
-			candidate_replace_parity_groups[i] = 1;
-		}
-		else 
-		{
-			candidate_replace_parity_groups[i] = 0;
-		}
-	}
-	while ((tmp_replaced = crs_better_recovery_exist(m, k, w, failed_disk_id, candidate_replace_parity_groups, generator_matrix)) != -1)
-	{
-		candidate_replace_parity_groups[tmp_replaced] = 0;
-	}
-	crs_adjust_recovery_vector_in_adjustment(m, k, w, failed_disk_id, fixed_parity_disk, star_parity_disk, fixed_parity_disk, generator_matrix);
-	if (crs_hybrid_profit <= tmp_crs_hybrid_profit)
-	{
-		crs_hybrid_profit = tmp_crs_hybrid_profit;
-		for (i = 0; i<(m*w); i++)
-		{
-			crs_hybrid_parity_group_selection[i] = tmp_crs_failed_disk_selection[i];
-		}
-	}
-	delete[] tmp_crs_failed_disk_selection;
-	delete[] candidate_replace_parity_groups;
-}
-void ECBackend::crs_store_selection_to_final(int m, int w){
-	for (int i = 0; i<(m*w); i++)
-	{
-		crs_final_recovery_parity_vector[i] = crs_hybrid_parity_group_selection[i];
-	}
-}
-int* ECBackend::crs_hybrid_recovery_solution(int k, int m, int w, int failed_disk_id,int *generator_matrix)
+bool ECBackend::peers_support_xor_plan(
+  const ECUtil::xor_aggregation_plan_t &xor_plan,
+  const map<pg_shard_t, vector<int> > &sources)
 {
-	crs_hybrid_profit = 0;
-	crs_final_hybrid_profit = 0;
-	int* candidate_replace_parity_groups = new int[m*w];
-	crs_hybrid_parity_group_selection = new int[m*w];
-	crs_final_recovery_parity_vector = new int[m*w];
-	construct_rows_intersection_infor_matrix(m,k,w,failed_disk_id,generator_matrix);
-	for (int i=0;i<(m*w);i++)
-	{
-		crs_hybrid_parity_group_selection[i]=0;
-		candidate_replace_parity_groups[i]=0;
-		crs_final_recovery_parity_vector[i]=0;
-	}
-	int *optimal_conventional_recovery=new int[m];
-	for (int i=0;i<m;i++)
-	{
-		optimal_conventional_recovery[i]=1;
-	}
-	for (int j=0;j<m;j++)
-	{
-		if (optimal_conventional_recovery[j]==1)
-		{
-			for (int i=0;i<(m*w);i++)
-			{
-				if ((i/w)==j)
-				{
-					crs_hybrid_parity_group_selection[i]=1;
-				} 
-				else 
-				{
-					crs_hybrid_parity_group_selection[i]=0;
-				}
-			}
-			crs_hybrid_profit=calculate_blocks_savings(m,k,w,failed_disk_id,generator_matrix,crs_hybrid_parity_group_selection);
-			for (int t=0;t<m;t++)
-			{
-				if (t!=j)
-				{
-					for (int i=0;i<(m*w);i++)
-					{
-						if ((i/w)==t)
-						{
-							candidate_replace_parity_groups[i]= 1;
-						} else 
-						{
-							candidate_replace_parity_groups[i]= 0;
-						}
-					}
-           			int tmp_replaced = crs_better_recovery_exist(m, k, w, failed_disk_id, candidate_replace_parity_groups, generator_matrix);
-					while (tmp_replaced != -1)
-					{
-						candidate_replace_parity_groups[tmp_replaced]= 0;
-						tmp_replaced = crs_better_recovery_exist(m, k, w, failed_disk_id, candidate_replace_parity_groups, generator_matrix);
-					}
-					crs_adjust_recovery_vector(m, k, w, failed_disk_id, t, j, generator_matrix);
-				}
-			}
-		}
-		if (crs_hybrid_profit>=crs_final_hybrid_profit)
-		{
-			crs_final_hybrid_profit = crs_hybrid_profit;
-			crs_store_selection_to_final(m, w);
-		}
-	}	
-	delete[] candidate_replace_parity_groups;
-	delete[] crs_hybrid_parity_group_selection;
-	delete[] optimal_conventional_recovery;
-	delete[] rows_intersection_infor;
-	return crs_final_recovery_parity_vector;
-}
-void ECBackend::get_recovery_solution(int k, int m, int w, int failed_disk_id, int* generator_matrix,int* parity_group_selection, map<int, vector<int> >& solution)
-{
-	int* tmp_recovery_solution;
-	tmp_recovery_solution = new int[k*w];
-	int i, j;
-	for (i = 0; i < k*w;i++) 
-	{
-		for (j = 0; j < m*w;j++) 
-		{
-			if (parity_group_selection[j] == 1) 
-			{
-				if (generator_matrix[j*k*w + i] == 1) 
-				{
-					tmp_recovery_solution[i] = 1;
-					break;
-				}
-			}
-		}
-		if (j == m*w) 
-		{
-			tmp_recovery_solution[i] = 0;
-		}
-	}
-	for (i = 0; i < k*w;i++)
-	{
-		if (i/w == failed_disk_id)
-		{
-		
-		}
-		else if (tmp_recovery_solution[i]== 1)
-		{
-			map<int, vector<int> >::iterator solution_iterator = solution.find(i / w);
-			if (solution_iterator == solution.end())
-			{
-				vector<int> solution_index;
-				solution_index.insert(solution_index.end(), i%w);
-				solution.insert(map<int, vector<int> >::value_type(i / w, solution_index));
-			}
-			else
-			{
-				solution_iterator->second.push_back(i%w);
-			}
-		}
-	}
-	for (i = 0; i < m*w;i++)
-	{
-		if (parity_group_selection[i]== 1)
-		{
-			map<int, vector<int> >::iterator solution_iterator = solution.find(i/w+k);
-			if (solution_iterator == solution.end())
-			{
-				vector<int> solution_index;
-				solution_index.insert(solution_index.end(), i%w);
-				solution.insert(map<int, vector<int> >::value_type(i/w+k, solution_index));
-			}
-			else 
-			{
-				solution_iterator->second.insert(solution_iterator->second.end(), i%w);
-			}
-		}
-	}
-	delete[] tmp_recovery_solution;
-}
-
-//add  by LYF, sa_search
-void ECBackend::init_crs_recovery_equation_group(int k,int m ,int w,int failed_disk_id,int *generator_matrix) {
-	sa_crs_recovery_equation_group = new int*[w];
-	sa_crs_recovery_equation_group_index = new int*[w];
-	sa_crs_recovery_equation_group_index_number = new int[w];
-	for (int i = 0; i < w;i++) {
-		sa_crs_recovery_equation_group[i] = new int[m*w];
-		sa_crs_recovery_equation_group_index_number[i] = 0;
-		for (int j = 0; j < m*w; j++) {
-			sa_crs_recovery_equation_group[i][j] = 0;
-		}
-	}
-	for (int i = 0; i < m*w;i++) {
-		for (int j = 0; j < k*w;j++) {
-			if (j/w==failed_disk_id) {
-				if (generator_matrix[i*k*w+j]==1) {
-					sa_crs_recovery_equation_group[j%w][i] = 1;
-					sa_crs_recovery_equation_group_index_number[j%w]++;
-				}
-			}
-		}
-	}
-	//Initialization: sa_crs_recovery_equation_group_index
-	for (int i = 0; i < w; ++i) {
-		sa_crs_recovery_equation_group_index[i] = new int[sa_crs_recovery_equation_group_index_number[i]];
-		int index = 0;
-		for (int j = 0; j < m*w; ++j) {
-			if (sa_crs_recovery_equation_group[i][j] == 1) {
-				sa_crs_recovery_equation_group_index[i][index++] = j;
-			}
-		}
-	}
-}
-int ECBackend::calculate_row_profit(int k, int w, int row, int faild_disk_id,int *generator_matrix) {
-	int row_profit = 0;
-	for (int i = 0; i < k*w;i++) {
-		if (i/w!= faild_disk_id && generator_matrix[row*k*w+i]==1) {
-			row_profit++;
-		}
-	}
-	return row_profit;
-}
-int ECBackend::calculate_all_profit(int k,int m,int w,int faild_disk_id,int *generator_matrix,int *sa_crs_hybrid_parity_group_selection) {
-	int all_profit = 0;
-	for (int i = 0; i < k*w;i++) {
-		if (i/w!=faild_disk_id) {
-			for (int j = 0; j < m*w; j++) {
-				if (sa_crs_hybrid_parity_group_selection[j]==1) {//The row is selected as a recovery equation to participate in reconstruction
-					if (generator_matrix[j*k*w+i]==1) {
-						all_profit++;
-						break;
-					}
-				}
-			}
-		}
-	}
-	return all_profit;
-}
-bool ECBackend::judge_row_selected(int m,int w, int row) {
-	bool selected = false;
-	for (int i = 0; i < m*w; i++) {
-		if (sa_crs_hybrid_parity_group_selection[row] == 1) {
-			selected = true;
-		}
-	}
-	return selected;
-}
-void ECBackend::init_crs_hybrid_parity_group_selection(int k, int m, int w, int faild_disk_id, int *generator_matrix) {
-	//Randomly select the appropriate recovery solution
-	sa_crs_hybrid_parity_group_selection = new int[m*w];
-	sa_crs_hybrid_parity_group_selection_index = new int[w];
-	for (int i = 0; i < m*w; i++) {
-		sa_crs_hybrid_parity_group_selection[i] = 0;
-	}
-	for (int i = 0; i < w; ++i) {
-		srand((unsigned)time(NULL));
-		int symbol_id = rand() % sa_crs_recovery_equation_group_index_number[i];
-		while (sa_crs_hybrid_parity_group_selection[sa_crs_recovery_equation_group_index[i][symbol_id]] == 1) {
-			symbol_id = rand() % sa_crs_recovery_equation_group_index_number[i];
-		}
-		sa_crs_hybrid_parity_group_selection[sa_crs_recovery_equation_group_index[i][symbol_id]] = 1;
-		sa_crs_hybrid_parity_group_selection_index[i] = sa_crs_recovery_equation_group_index[i][symbol_id];
-	}
-}
-void ECBackend::init_crs_hybrid_parity_group_selection_best(int k,int m,int w, int* generator_matrix) {
-	sa_crs_hybrid_parity_group_selection_best = new int[m*w];
-	sa_crs_hybrid_parity_group_selection_best_index = new int[w];
-	for (int i = 0; i < m*w; ++i) {
-		sa_crs_hybrid_parity_group_selection_best[i] = sa_crs_hybrid_parity_group_selection[i];
-	}
-	for (int i = 0; i < w; ++i) {
-		sa_crs_hybrid_parity_group_selection_best_index[i] = sa_crs_hybrid_parity_group_selection_index[i];
-	}
-}
-void ECBackend::init_crs_hybrid_parity_group_selection_temporary(int k, int m, int w,  int *generator_matrix) {
-	sa_crs_hybrid_parity_group_selection_temporary = new int[m*w];
-	sa_crs_hybrid_parity_group_selection_temporary_index = new int[w];
-	for (int i = 0; i < m*w; i++) {
-		sa_crs_hybrid_parity_group_selection_temporary[i] = sa_crs_hybrid_parity_group_selection[i];
-	}
-	for (int i = 0; i < w; i++) {
-		sa_crs_hybrid_parity_group_selection_temporary_index[i] = sa_crs_hybrid_parity_group_selection_index[i];
-	}
-}
-void ECBackend::receive_replacement(int m,int w) {
-	for (int i = 0; i < m*w; i++) {
-		sa_crs_hybrid_parity_group_selection[i] = sa_crs_hybrid_parity_group_selection_temporary[i];
-	}
-	for (int i = 0; i < w; i++) {
-		sa_crs_hybrid_parity_group_selection_index[i] = sa_crs_hybrid_parity_group_selection_temporary_index[i];
-	}
-}
-void ECBackend::remember_best(int m, int w) {
-	for (int i = 0; i < m*w; ++i) {
-		sa_crs_hybrid_parity_group_selection_best[i] = sa_crs_hybrid_parity_group_selection_temporary[i];
-	}
-	for (int i = 0; i < w; ++i) {
-		sa_crs_hybrid_parity_group_selection_best_index[i] = sa_crs_hybrid_parity_group_selection_temporary_index[i];
-	}
-}
-bool ECBackend::judge_row_selected_temporary(int m, int w, int row) {
-	bool selected = false;
-	if (sa_crs_hybrid_parity_group_selection_temporary[row] == 1) {
-		selected = true;
-	}
-	return selected;
-}
-void ECBackend::sa_int2bin(int integer, int *binary, int array_len) {
-	int k = 0, n = 0;
-	int remain;
-	int *temp = new int[array_len];
-	do {
-		remain = integer % 2;
-		integer = integer / 2;
-		temp[k++] = remain;
-	} while (integer > 0);
-	while (k<array_len) {
-		temp[k++] = 0;
-	}
-	while (k >= 0) {
-		binary[n++] = temp[--k];
-	}
-	delete[] temp;
-}
-bool ECBackend::sa_judge_in_failed_disk_selection(int k,int m,int w,int failed_disk_id,int* generator_matrix,int row, int* temporary_group_id) {
-	if (sa_crs_hybrid_parity_group_selection_temporary[row] == 1) {
-		return true;
-	}
-	int temporary_group_id_index = 0;
-	for (int s = 0; s < k*w; s++) {
-		if (s / w == failed_disk_id) {
-			if (generator_matrix[row*k*w + s] == 1) {
-				temporary_group_id[temporary_group_id_index] = s%w;
-				temporary_group_id_index++;
-			}
-		}
-	}
-	int group_id = temporary_group_id[rand() % temporary_group_id_index];
-	sa_crs_hybrid_parity_group_selection_temporary[sa_crs_hybrid_parity_group_selection_temporary_index[group_id]] = 0;
-	int search_scale = 0;
-	int source_num = 0;
-	for (int i = 0; i < m*w;i++) {
-		if (sa_crs_hybrid_parity_group_selection_temporary[i]==1) {
-			source_num++;
-		}
-	}
-	int* temp_array = new int[source_num];
-	int index = 0;
-	for (int i = 0; i < m*w;i++) {
-		if (sa_crs_hybrid_parity_group_selection_temporary[i]==1) {
-			temp_array[index++] = i;
-		}
-	}
-	search_scale = 1 << source_num;
-	int* binaryArray = new int[source_num];
-	int* temp_sum = new int[w];
-	for (int i = 0; i < search_scale; i++) {
-		memset(temp_sum, 0, sizeof(int)*w);
-		sa_int2bin(i, binaryArray, source_num);
-		for (int j = 0; j<source_num; j++) {
-			if (binaryArray[j] == 1) {
-				for (int t = 0; t<w; t++) {
-					if (generator_matrix[temp_array[j] * k*w + failed_disk_id*w + t] == temp_sum[t]) {
-						temp_sum[t] = 0;
-					}
-					else {
-						temp_sum[t] = 1;
-					}
-				}
-			}
-		}
-		int t = 0;
-		for (t = 0; t<w; t++) {
-			if (temp_sum[t] != generator_matrix[row*k*w + failed_disk_id*w + t]) {
-				break;
-			}
-		}
-		if (t == w) {
-			sa_crs_hybrid_parity_group_selection_temporary[sa_crs_hybrid_parity_group_selection_temporary_index[group_id]] = 1;
-			return true;
-		}
-	}
-	delete[] temp_array;
-	delete[] temp_sum;
-	delete[] binaryArray;
-	sa_crs_hybrid_parity_group_selection_temporary[sa_crs_hybrid_parity_group_selection_temporary_index[group_id]] = 1;
-	return false;
-}
-void ECBackend::sa_search_recovery_solution(int k,int m,int w,int failed_disk_id,int *generator_matrix) {
-	double K = 0.97, T= k*m*m*w*w, M = k*m*m*w*w, L = k*m*m*w*w;
-	double ini = M;
-	double remain_times = ini;
-	double random_probability = 0;
-	int all_profit = 0;
-	int all_profit_new = 0;
-	int all_profit_best = 0;
-	int* temporary_group_id = new int[w];
-	int all_profit_difference = 0;
-	while(remain_times > 0 && T > 0.001) {
-		srand((unsigned)time(NULL));
-		for (int l = 0; l < L; l++) {
-			int symbol_id = rand() % (m*w);
-			while (sa_judge_in_failed_disk_selection(k, m, w, failed_disk_id, generator_matrix, symbol_id, temporary_group_id)) {
-				symbol_id = rand() % (m*w);
-			}
-			int temporary_group_id_index = 0;
-			for (int s = 0; s < k*w; s++) {
-				if (s / w == failed_disk_id) {
-					if (generator_matrix[symbol_id*k*w + s] == 1) {
-						temporary_group_id[temporary_group_id_index] = s%w;
-						temporary_group_id_index++;
-					}
-				}
-			}
-			int group_id = temporary_group_id[rand() % temporary_group_id_index];
-			all_profit = calculate_all_profit(k, m, w, failed_disk_id, generator_matrix,sa_crs_hybrid_parity_group_selection_temporary);
-			all_profit_best = calculate_all_profit(k, m, w, failed_disk_id, generator_matrix, sa_crs_hybrid_parity_group_selection_best);
-			
-			sa_crs_hybrid_parity_group_selection_temporary[sa_crs_hybrid_parity_group_selection_temporary_index[group_id]] = 0;
-			sa_crs_hybrid_parity_group_selection_temporary[symbol_id] = 1;
-			sa_crs_hybrid_parity_group_selection_temporary_index[group_id] = symbol_id;
-
-			all_profit_new = calculate_all_profit(k, m, w, failed_disk_id, generator_matrix, sa_crs_hybrid_parity_group_selection_temporary);
-			all_profit_difference = all_profit - all_profit_new;//The difference between the amount of data before replacement and the amount of data after replacement
-			if (all_profit_difference > 0) {
-				receive_replacement(m, w);
-				if (all_profit_best > all_profit_new) {
-					remember_best(m,w);
-				}
-			}
-			else {
-				random_probability = (double)(rand() / (double)RAND_MAX);
-				if (exp(all_profit_difference / T)>random_probability) {
-					receive_replacement(m, w);
-					T = K*T;
-				}
-				else {
-					remain_times--;
-					sa_crs_hybrid_parity_group_selection_temporary[symbol_id] = 0;
-					sa_crs_hybrid_parity_group_selection_temporary[sa_crs_hybrid_parity_group_selection_index[group_id]] = 1;
-					sa_crs_hybrid_parity_group_selection_temporary_index[group_id] = sa_crs_hybrid_parity_group_selection_index[group_id];
-				}
-			}
-		}
-	}
-	delete[] temporary_group_id;
-	delete[] sa_crs_hybrid_parity_group_selection_temporary;
-	delete[] sa_crs_hybrid_parity_group_selection_temporary_index;
-	delete[] sa_crs_hybrid_parity_group_selection;
-	delete[] sa_crs_hybrid_parity_group_selection_index;
-	delete[] sa_crs_hybrid_parity_group_selection_best_index;
-}
-int* ECBackend::sa_crs_hybrid_recovery_solution(int k, int m, int w, int failed_disk_id, int *generator_matrix) {
-	init_crs_recovery_equation_group(k,m,w,failed_disk_id,generator_matrix);
-	init_crs_hybrid_parity_group_selection(k, m, w, failed_disk_id,generator_matrix);
-	init_crs_hybrid_parity_group_selection_best(k,m,w,generator_matrix);
-	init_crs_hybrid_parity_group_selection_temporary(k, m, w,  generator_matrix);
-	sa_search_recovery_solution(k,m,w,failed_disk_id,generator_matrix);
-	return sa_crs_hybrid_parity_group_selection_best;
+  // a helper without the feature ignores the combinations and ships raw
+  // symbols, which would then be summed as partial parities
+  for (map<pg_shard_t, vector<int> >::const_iterator i = sources.begin();
+       i != sources.end();
+       ++i) {
+    map<int, ECUtil::xor_aggregation_plan_t::shard_t>::const_iterator s =
+      xor_plan.shards.find(i->first.shard);
+    if (s != xor_plan.shards.end() && s->second.aggregated &&
+	!peer_supports_symbol_reads(i->first)) {
+      dout(10) << __func__ << ": " << i->first
+	       << " lacks OSD_EC_SYMBOL_READ, not aggregating" << dendl;
+      return false;
+    }
+  }
+  return true;
 }
 
-map<pg_shard_t, vector<int> > ECBackend::hybrid_recovery_solution(const hobject_t &hoid, int k, int m, int failed_disk_id)
+map<pg_shard_t, vector<int> > ECBackend::hybrid_recovery_solution(const hobject_t &hoid, const SymbolRecoveryPlan &plan, int *unavailable)
 {
-  int* generator_matrix = ec_impl->get_bitmatrix();
-  int w = ec_impl->get_symbol_count();
-  parity_group_selection = sa_crs_hybrid_recovery_solution(k, m, w, failed_disk_id, generator_matrix);
-  map<int, vector<int> > solution_index;
-  get_recovery_solution(k,m,w, failed_disk_id, generator_matrix,parity_group_selection,solution_index);
-  solution_int = solution_index;
   map<shard_id_t, pg_shard_t> shards;
   for (set<pg_shard_t>::const_iterator i = get_parent()->get_acting_shards().begin();i != get_parent()->get_acting_shards().end();++i) 
   {
@@ -1467,14 +1075,200 @@ map<pg_shard_t, vector<int> > ECBackend::hybrid_recovery_solution(const hobject_
 	}
   }
   map<pg_shard_t,vector<int> > solution_final;
-  for(map<int,vector<int> >::iterator solution_index_iter = solution_index.begin(); solution_index_iter != solution_index.end(); ++solution_index_iter)
+  for(map<int,vector<int> >::const_iterator solution_index_iter = plan.solution.begin(); solution_index_iter != plan.solution.end(); ++solution_index_iter)
   {
-        assert(shards.count(shard_id_t(solution_index_iter->first)));
-        solution_final.insert(make_pair(shards[shard_id_t(solution_index_iter->first)],solution_index_iter->second));
+        map<shard_id_t, pg_shard_t>::iterator helper = shards.find(shard_id_t(solution_index_iter->first));
+        if (helper == shards.end()) {
+	  // missing the object or out of the acting set: the caller replans
+	  // or reads full chunks
+	  if (unavailable)
+	    *unavailable = solution_index_iter->first;
+	  continue;
+        }
+        solution_final.insert(make_pair(helper->second,solution_index_iter->second));
   }
   return solution_final;
 }
 
+struct C_ComputeSymbolRecoveryPlan : public Context {
+  std::shared_ptr<ECBackend::SymbolPlanTarget> target;
+  ErasureCodeInterfaceRef ec_impl;
+  SymbolPlanner *planner;
+  PerfCounters *logger;
+  int failed;
+  C_ComputeSymbolRecoveryPlan(std::shared_ptr<ECBackend::SymbolPlanTarget> target,
+			      ErasureCodeInterfaceRef ec_impl,
+			      SymbolPlanner *planner, PerfCounters *logger,
+			      int failed)
+    : target(target), ec_impl(ec_impl), planner(planner), logger(logger),
+      failed(failed) {}
+  void finish(int) override {
+    {
+      Mutex::Locker l(target->lock);
+      if (!target->ec)
+	return;  // the PG went away while this was queued
+    }
+    ECBackend::SymbolRecoveryPlan plan;
+    // queued before another PG of the pool finished the same plan
+    if (!planner->get_plan(ec_impl, failed, &plan)) {
+      utime_t start = ceph_clock_now();
+      ECBackend::compute_symbol_recovery_plan(ec_impl, failed, &plan);
+      logger->tinc(l_ec_symbol_plan_lat, ceph_clock_now() - start);
+      planner->add_plan(ec_impl, plan);
+    }
+    Mutex::Locker l(target->lock);
+    if (target->ec)
+      target->ec->finish_symbol_recovery_plan(failed, std::move(plan));
+  }
+};
+
+ECBackend::SymbolRecoveryPlan *ECBackend::get_symbol_recovery_plan(int failed)
+{
+  Mutex::Locker l(symbol_plan_lock);
+  map<int, SymbolRecoveryPlan>::iterator p = symbol_recovery_plans.find(failed);
+  if (p == symbol_recovery_plans.end()) {
+    // never anneal on the op thread, this object goes without symbols
+    // unless another PG of the pool already has the plan
+    _queue_symbol_recovery_plan(failed);
+    p = symbol_recovery_plans.find(failed);
+  }
+  if (p == symbol_recovery_plans.end()) {
+    symbol_logger->inc(l_ec_symbol_plan_miss);
+    return nullptr;
+  }
+  symbol_logger->inc(l_ec_symbol_plan_hit);
+  return &p->second;
+}
+
+void ECBackend::_queue_symbol_recovery_plan(int failed)
+{
+  assert(symbol_plan_lock.is_locked());
+  if (failed < 0 || failed >= (int)ec_impl->get_data_chunk_count() ||
+      !supports_symbol_recovery())
+    return;
+  if (symbol_recovery_plans.count(failed) ||
+      symbol_plans_in_flight.count(failed))
+    return;
+  SymbolRecoveryPlan shared;
+  if (symbol_planner->get_plan(ec_impl, failed, &shared)) {
+    dout(10) << __func__ << ": shard " << failed
+	     << " already planned for this codec" << dendl;
+    symbol_recovery_plans.insert(make_pair(failed, std::move(shared)));
+    return;
+  }
+  dout(10) << __func__ << ": planning symbol recovery of shard " << failed << dendl;
+  symbol_plans_in_flight.insert(failed);
+  symbol_planner->finisher.queue(
+    new C_ComputeSymbolRecoveryPlan(symbol_plan_target, ec_impl,
+				    symbol_planner, symbol_logger, failed));
+}
+
+void ECBackend::queue_symbol_recovery_plans()
+{
+  if (!get_parent()->pgb_is_primary() || !supports_symbol_recovery())
+    return;
+  // data shards that are gone or behind will need a plan soon.  peer
+  // missing sets are not known yet early in peering, so only look at
+  // the ones we have
+  OSDMapRef osdmap = get_osdmap();
+  const map<pg_shard_t, pg_missing_t> &peer_missing =
+    get_parent()->get_shard_missing();
+  set<int> present;
+  set<int> lost;
+  for (set<pg_shard_t>::const_iterator i = get_parent()->get_acting_shards().begin();
+       i != get_parent()->get_acting_shards().end();
+       ++i) {
+    const pg_missing_t *missing = nullptr;
+    if (*i == get_parent()->primary_shard()) {
+      missing = &get_parent()->get_local_missing();
+    } else {
+      map<pg_shard_t, pg_missing_t>::const_iterator m = peer_missing.find(*i);
+      if (m != peer_missing.end())
+	missing = &m->second;
+    }
+    if (osdmap->is_down(i->osd) || (missing && missing->num_missing()))
+      lost.insert(i->shard);
+    else
+      present.insert(i->shard);
+  }
+  for (int i = 0; i < (int)ec_impl->get_data_chunk_count(); ++i) {
+    if (!present.count(i))
+      lost.insert(i);
+  }
+  Mutex::Locker l(symbol_plan_lock);
+  for (set<int>::iterator i = lost.begin(); i != lost.end(); ++i)
+    _queue_symbol_recovery_plan(*i);
+}
+
+void ECBackend::compute_symbol_recovery_plan(
+  const ErasureCodeInterfaceRef &ec_impl,
+  int failed,
+  SymbolRecoveryPlan *plan)
+{
+  int k = ec_impl->get_data_chunk_count();
+  int m = ec_impl->get_coding_chunk_count();
+  int w = ec_impl->get_symbol_count();
+  int *generator_matrix = ec_impl->get_bitmatrix();
+
+  plan->failed = failed;
+  ECRecoveryPlanner planner;
+  int *selection = planner.sa_crs_hybrid_recovery_solution(k, m, w, failed, generator_matrix);
+  plan->parity_group_selection.assign(selection, selection + m * w);
+  delete[] selection;
+  ECRecoveryPlanner::get_recovery_solution(k, m, w, failed, generator_matrix,
+			plan->parity_group_selection.data(), plan->solution);
+  // a selection that is not invertible still decodes, only without
+  // helper aggregation
+  ECUtil::build_xor_aggregation_plan(
+    k, m, w, generator_matrix, failed,
+    plan->parity_group_selection.data(), &plan->xor_plan);
+}
+
+void ECBackend::finish_symbol_recovery_plan(int failed,
+					    SymbolRecoveryPlan &&plan)
+{
+  Mutex::Locker l(symbol_plan_lock);
+  symbol_recovery_plans.insert(make_pair(failed, std::move(plan)));
+  symbol_plans_in_flight.erase(failed);
+}
+
+ECBackend::SymbolRecoveryPlan *ECBackend::get_symbol_recovery_replan(
+  int failed, int excluded)
+{
+  pair<int, int> key(failed, excluded);
+  map<pair<int, int>, SymbolRecoveryPlan>::iterator p =
+    symbol_recovery_replans.find(key);
+  if (p != symbol_recovery_replans.end())
+    return p->second.failed < 0 ? nullptr : &p->second;
+
+  SymbolRecoveryPlan *base = get_symbol_recovery_plan(failed);
+  if (!base)
+    return nullptr;
+  int k = ec_impl->get_data_chunk_count();
+  int m = ec_impl->get_coding_chunk_count();
+  int w = ec_caps.w;
+  int *generator_matrix = ec_caps.bitmatrix;
+
+  // failures are cached too, the answer does not change
+  SymbolRecoveryPlan &plan = symbol_recovery_replans[key];
+  vector<int> selection;
+  if (!ECUtil::replan_parity_group_selection(
+	k, m, w, generator_matrix, failed, set<int>{excluded},
+	base->parity_group_selection.data(), &selection)) {
+    dout(10) << __func__ << ": no symbol recovery of shard " << failed
+	     << " without shard " << excluded << dendl;
+    return nullptr;
+  }
+  plan.failed = failed;
+  plan.excluded = excluded;
+  plan.parity_group_selection.swap(selection);
+  ECRecoveryPlanner::get_recovery_solution(k, m, w, failed, generator_matrix,
+			plan.parity_group_selection.data(), plan.solution);
+  dout(10) << __func__ << ": shard " << failed << " without shard " << excluded
+	   << " reads " << plan.solution << dendl;
+  return &plan;
+}
+
 void ECBackend::run_recovery_op(
   RecoveryHandle *_h,
   int priority)
@@ -1487,19 +1281,41 @@ void ECBackend::run_recovery_op(
     dout(10) << __func__ << ": starting " << *i << dendl;
     assert(!recovery_ops.count(i->hoid));
     RecoveryOp &op = recovery_ops.insert(make_pair(i->hoid, *i)).first->second;
-    //add by LYF
-    //climb algorithm
-    dout(0) << "starting recovery" << dendl;
-    string profile = get_parent()->get_pool().erasure_code_profile;
-    string technique = get_osdmap()->get_erasure_code_profile(profile).find("technique")->second;
-    set<int> want(op.missing_on_shards.begin(), op.missing_on_shards.end());
-    set<int>::iterator want_iter = want.begin();
-    int failed_disk_id = *want_iter;
-    int data_chunk_count = ec_impl->get_data_chunk_count();
-    int coding_chunk_count = ec_impl->get_coding_chunk_count();
-    if(want.size() == 1 && failed_disk_id < data_chunk_count && (technique == "cauchy_good" || technique == "liber8tion" || technique == "blaum_roth")){
-		solution_pg_shard_t = hybrid_recovery_solution(op.hoid, data_chunk_count, coding_chunk_count, failed_disk_id);
-		xor_tech.insert(make_pair(op.hoid, true));
+    if (op.missing_on_shards.size() == 1 && supports_symbol_recovery()) {
+      int failed = *op.missing_on_shards.begin();
+      op.symbol_plan = get_symbol_recovery_plan(failed);
+      if (op.symbol_plan) {
+	int unavailable = -1;
+	op.symbol_sources = hybrid_recovery_solution(op.hoid, *op.symbol_plan,
+						     &unavailable);
+	if (op.symbol_sources.size() != op.symbol_plan->solution.size()) {
+	  // a helper of the plan cannot serve this object: plan around it
+	  // if it is the only one and a coding shard, else read full chunks
+	  dout(10) << __func__ << ": " << op.hoid << " shard " << unavailable
+		   << " of the plan is unavailable" << dendl;
+	  op.symbol_plan = nullptr;
+	  op.symbol_sources.clear();
+	  SymbolRecoveryPlan *replan = nullptr;
+	  if (unavailable >= (int)ec_impl->get_data_chunk_count())
+	    replan = get_symbol_recovery_replan(failed, unavailable);
+	  if (replan) {
+	    op.symbol_sources = hybrid_recovery_solution(op.hoid, *replan);
+	    if (op.symbol_sources.size() == replan->solution.size())
+	      op.symbol_plan = replan;
+	    else
+	      op.symbol_sources.clear();
+	  }
+	}
+	if (op.symbol_plan && !peers_support_symbol_reads(op.symbol_sources)) {
+	  op.symbol_plan = nullptr;
+	  op.symbol_sources.clear();
+	}
+      }
+      if (op.symbol_plan) {
+	if (cct->_conf->osd_ec_recovery_helper_xor &&
+	    peers_support_xor_plan(op.symbol_plan->xor_plan, op.symbol_sources))
+	  op.xor_plan = op.symbol_plan->xor_plan;
+      }
     }
     continue_recovery_op(op, &m);
   }
@@ -1771,6 +1587,52 @@ void ECBackend::handle_sub_read(
   ECSubReadReply *reply)
 {
   shard_id_t shard = get_parent()->whoami_shard().shard;
+  bool symbol_recovery = supports_symbol_recovery();
+
+  // gather the symbols of every object in the message with one store
+  // call, a recovery round of many small objects is otherwise one
+  // store read per object
+  vector<ObjectStore::xor_read_t> symbol_reads;
+  map<pair<hobject_t, uint64_t>, size_t> symbol_read_index;
+  for (auto i = op.to_read.begin(); i != op.to_read.end(); ++i) {
+    uint64_t mask = 0;
+    auto combinations = op.symbol_combinations.find(i->first);
+    if (combinations != op.symbol_combinations.end()) {
+      for (auto c : combinations->second)
+	mask |= c;
+    } else if (symbol_recovery) {
+      auto m = op.symbol_masks.find(i->first);
+      if (m != op.symbol_masks.end())
+	mask = m->second;
+    }
+    if (!mask)
+      continue;
+    for (auto j = i->second.begin(); j != i->second.end(); ++j) {
+      symbol_read_index[make_pair(i->first, j->get<0>())] = symbol_reads.size();
+      symbol_reads.push_back(ObjectStore::xor_read_t());
+      ObjectStore::xor_read_t &rd = symbol_reads.back();
+      rd.oid = ghobject_t(i->first, ghobject_t::NO_GEN, shard);
+      rd.offset = j->get<0>();
+      rd.len = j->get<1>();
+      ECSubRead::mask_to_symbols(mask, &rd.symbol_ids);
+      rd.op_flags = j->get<2>();
+    }
+  }
+  if (!symbol_reads.empty()) {
+    store->read_for_xor_batch(
+      ch, sinfo.get_stripe_width(), sinfo.get_chunk_size(),
+      ec_caps.packetsize, ec_caps.w,
+      symbol_reads, true);  // Allow EIO return
+    dout(20) << __func__ << ": gathered symbols of " << symbol_reads.size()
+	     << " extents" << dendl;
+    uint64_t gathered = 0;
+    for (auto &&rd : symbol_reads)
+      gathered += rd.bl.length();
+    symbol_logger->inc(l_ec_symbol_gather);
+    symbol_logger->inc(l_ec_symbol_gather_extents, symbol_reads.size());
+    symbol_logger->inc(l_ec_symbol_gather_bytes, gathered);
+  }
+
   for(auto i = op.to_read.begin();
       i != op.to_read.end();
       ++i) {
@@ -1787,15 +1649,19 @@ void ECBackend::handle_sub_read(
     }
     for (auto j = i->second.begin(); j != i->second.end(); ++j) {
       bufferlist bl;
-      string profile = get_parent()->get_pool().erasure_code_profile;
-      string technique = get_osdmap()->get_erasure_code_profile(profile).find("technique")->second;
-      if((technique == "cauchy_good" || technique == "liber8tion" || technique =="blaum_roth") && !op.symbol_ids.empty())
-      {
-        int stripe_size = sinfo.get_stripe_width();//add by LYF
-        int chunk_size = sinfo.get_chunk_size();//add by LYF 
-        int packet_size = ec_impl->get_packetsize();//add by LYF
-        int w = ec_impl->get_symbol_count();
-        r = store->read_for_xor(ch,ghobject_t(i->first, ghobject_t::NO_GEN, shard), j->get<0>(), j->get<1>(), bl, stripe_size, chunk_size, packet_size, w, op.symbol_ids, j->get<2>(),true); // Allow EIO return
+      auto combinations = op.symbol_combinations.find(i->first);
+      auto gathered = symbol_read_index.find(make_pair(i->first, j->get<0>()));
+      if (gathered != symbol_read_index.end()) {
+	ObjectStore::xor_read_t &rd = symbol_reads[gathered->second];
+	r = rd.r;
+	if (r >= 0 && combinations != op.symbol_combinations.end()) {
+	  // ship one partial parity per combination and packet row
+	  ECUtil::xor_combine(rd.bl, ECSubRead::symbols_to_mask(rd.symbol_ids),
+			      combinations->second, ec_caps.packetsize, &bl);
+	  r = bl.length();
+	} else {
+	  bl.claim(rd.bl);
+	}
       }else{
       	r = store->read(ch, ghobject_t(i->first, ghobject_t::NO_GEN, shard), j->get<0>(), j->get<1>(), bl, j->get<2>(), true); // Allow EIO return
       }
@@ -1986,13 +1852,25 @@ void ECBackend::handle_sub_read_reply(
       }
       set<int> want_to_read, dummy_minimum;
       get_want_to_read_shards(&want_to_read);
-      int err;
-      if ((err = ec_impl->minimum_to_decode(want_to_read, have, &dummy_minimum)) < 0) {
+      int err = 0;
+      if (iter->second.symbol_reads) {
+	// symbols only decode together with the rest of their plan
+	const set<pg_shard_t> &need = rop.to_read.find(iter->first)->second.need;
+	for (set<pg_shard_t>::const_iterator j = need.begin(); j != need.end(); ++j) {
+	  if (!have.count(j->shard)) {
+	    err = -EIO;
+	    break;
+	  }
+	}
+      } else {
+	err = ec_impl->minimum_to_decode(want_to_read, have, &dummy_minimum);
+      }
+      if (err < 0) {
 	dout(20) << __func__ << " minimum_to_decode failed" << dendl;
         if (rop.in_progress.empty()) {
 	  // If we don't have enough copies and we haven't sent reads for all shards
 	  // we can send the rest of the reads, if any.
-	  if (!rop.do_redundant_reads) {
+	  if (!rop.do_redundant_reads || iter->second.symbol_reads) {
 	    int r = send_all_remaining_reads(iter->first, rop);
 	    if (r == 0) {
 	      // We added to in_progress and not incrementing is_complete
@@ -2029,6 +1907,16 @@ void ECBackend::handle_sub_read_reply(
       }
     }
   }
+  if (rop.for_recovery && rop.in_progress.empty()) {
+    // a helper failed under a symbol read: replan around it rather than
+    // failing the push
+    for (map<hobject_t, read_result_t>::iterator i = rop.complete.begin();
+	 i != rop.complete.end();
+	 ++i) {
+      if (i->second.symbol_reads && !i->second.errors.empty())
+	replan_symbol_read(i->first, rop);
+    }
+  }
   if (rop.in_progress.empty() || is_complete == rop.complete.size()) {
     dout(20) << __func__ << " Complete: " << rop << dendl;
     complete_read_op(rop, m);
@@ -2061,7 +1949,10 @@ struct FinishReadOp : public GenContext<ThreadPool::TPHandle&>  {
   FinishReadOp(ECBackend *ec, ceph_tid_t tid) : ec(ec), tid(tid) {}
   void finish(ThreadPool::TPHandle &handle) override {
     auto ropiter = ec->tid_to_read_map.find(tid);
-    assert(ropiter != ec->tid_to_read_map.end());
+    if (ropiter == ec->tid_to_read_map.end()) {
+      // dropped since, @see cancel_read_ahead
+      return;
+    }
     int priority = ropiter->second.priority;
     RecoveryMessages rm;
     ec->complete_read_op(ropiter->second, &rm);
@@ -2084,7 +1975,7 @@ void ECBackend::filter_read_op(
     }
   }
 
-  if (to_cancel.empty())
+  if (to_cancel.empty() && !op.in_progress.empty())
     return;
 
   for (map<pg_shard_t, set<hobject_t> >::iterator i = op.source_to_obj.begin();
@@ -2109,7 +2000,14 @@ void ECBackend::filter_read_op(
   for (set<hobject_t>::iterator i = to_cancel.begin();
        i != to_cancel.end();
        ++i) {
-    get_parent()->cancel_pull(*i);
+    // with osd_recovery_pipeline_depth > 1 every extent of an object
+    // is a read op of its own on the same helpers: the first one
+    // filtered cancels the pull and drops the others
+    if (recovery_ops.count(*i)) {
+      get_parent()->cancel_pull(*i);
+      erase_recovery_op(*i);
+      cancel_read_ahead(*i, op.tid);
+    }
 
     assert(op.to_read.count(*i));
     read_request_t &req = op.to_read.find(*i)->second;
@@ -2121,7 +2019,6 @@ void ECBackend::filter_read_op(
 
     op.to_read.erase(*i);
     op.complete.erase(*i);
-    recovery_ops.erase(*i);
   }
 
   if (op.in_progress.empty()) {
@@ -2131,6 +2028,38 @@ void ECBackend::filter_read_op(
   }
 }
 
+void ECBackend::cancel_read_ahead(const hobject_t &hoid, ceph_tid_t except)
+{
+  for (map<ceph_tid_t, ReadOp>::iterator i = tid_to_read_map.begin();
+       i != tid_to_read_map.end();
+       ) {
+    ReadOp &rop = i->second;
+    map<hobject_t, read_request_t>::iterator req = rop.to_read.find(hoid);
+    if (i->first == except || !rop.for_recovery || req == rop.to_read.end()) {
+      ++i;
+      continue;
+    }
+    dout(10) << __func__ << ": canceling " << req->second
+	     << " for obj " << hoid << " tid " << i->first << dendl;
+    delete req->second.cb;
+    rop.to_read.erase(req);
+    rop.complete.erase(hoid);
+    // keep the emptied sources: filter_read_op still has to see a
+    // source go down to stop waiting for it
+    for (auto &&j : rop.source_to_obj)
+      j.second.erase(hoid);
+    if (!rop.to_read.empty()) {
+      ++i;
+      continue;
+    }
+    for (set<pg_shard_t>::iterator j = rop.in_progress.begin();
+	 j != rop.in_progress.end();
+	 ++j)
+      shard_to_read_map[*j].erase(i->first);
+    tid_to_read_map.erase(i++);
+  }
+}
+
 void ECBackend::check_recovery_sources(const OSDMapRef& osdmap)
 {
   set<ceph_tid_t> tids_to_filter;
@@ -2149,9 +2078,13 @@ void ECBackend::check_recovery_sources(const OSDMapRef& osdmap)
        i != tids_to_filter.end();
        ++i) {
     map<ceph_tid_t, ReadOp>::iterator j = tid_to_read_map.find(*i);
-    assert(j != tid_to_read_map.end());
+    if (j == tid_to_read_map.end()) {
+      // read ahead of an object an earlier op canceled
+      continue;
+    }
     filter_read_op(osdmap, j->second);
   }
+  queue_symbol_recovery_plans();
 }
 
 void ECBackend::on_change()
@@ -2185,11 +2118,30 @@ void ECBackend::on_change()
   in_progress_client_reads.clear();
   shard_to_read_map.clear();
   clear_recovery_state();
+  queue_symbol_recovery_plans();
 }
 
 void ECBackend::clear_recovery_state()
 {
   recovery_ops.clear();
+  Mutex::Locker l(symbol_plan_lock);
+  recovery_rx_bytes.clear();
+}
+
+void ECBackend::erase_recovery_op(const hobject_t &hoid)
+{
+  map<hobject_t, RecoveryOp>::iterator op = recovery_ops.find(hoid);
+  if (op == recovery_ops.end())
+    return;
+  Mutex::Locker l(symbol_plan_lock);
+  for (auto &&i : op->second.rx_bytes) {
+    map<pg_shard_t, uint64_t>::iterator helper = recovery_rx_bytes.find(i.first);
+    assert(helper != recovery_rx_bytes.end() && helper->second >= i.second);
+    helper->second -= i.second;
+    if (!helper->second)
+      recovery_rx_bytes.erase(helper);
+  }
+  recovery_ops.erase(op);
 }
 
 void ECBackend::on_flushed()
@@ -2198,6 +2150,10 @@ void ECBackend::on_flushed()
 
 void ECBackend::dump_recovery_info(Formatter *f) const
 {
+  f->dump_unsigned("recovery_chunk_size", get_recovery_chunk_size());
+  f->open_object_section("symbol_recovery");
+  dump_symbol_recovery(f);
+  f->close_section();
   f->open_array_section("recovery_ops");
   for (map<hobject_t, RecoveryOp>::const_iterator i = recovery_ops.begin();
        i != recovery_ops.end();
@@ -2218,6 +2174,47 @@ void ECBackend::dump_recovery_info(Formatter *f) const
   f->close_section();
 }
 
+void ECBackend::dump_symbol_recovery(Formatter *f) const
+{
+  Mutex::Locker l(symbol_plan_lock);
+  f->dump_bool("supported", supports_symbol_recovery());
+  f->dump_stream("planning") << symbol_plans_in_flight;
+  f->open_array_section("plans");
+  for (auto &&i : symbol_recovery_plans) {
+    const SymbolRecoveryPlan &plan = i.second;
+    f->open_object_section("plan");
+    f->dump_int("failed", plan.failed);
+    f->open_array_section("parity_group_selection");
+    for (unsigned r = 0; r < plan.parity_group_selection.size(); ++r) {
+      if (plan.parity_group_selection[r])
+	f->dump_unsigned("row", r);
+    }
+    f->close_section();
+    f->open_array_section("solution");
+    for (auto &&s : plan.solution) {
+      f->open_object_section("shard");
+      f->dump_int("shard", s.first);
+      f->dump_stream("symbols") << s.second;
+      f->close_section();
+    }
+    f->close_section();
+    f->open_object_section("xor_plan");
+    plan.xor_plan.dump(f);
+    f->close_section();
+    f->close_section();
+  }
+  f->close_section();
+  // of the recovery ops in flight, cleared with them
+  f->open_array_section("rx_bytes");
+  for (auto &&i : recovery_rx_bytes) {
+    f->open_object_section("helper");
+    f->dump_stream("shard") << i.first;
+    f->dump_unsigned("bytes", i.second);
+    f->close_section();
+  }
+  f->close_section();
+}
+
 void ECBackend::submit_transaction(
   const hobject_t &hoid,
   const object_stat_sum_t &delta_stats,
@@ -2484,7 +2481,7 @@ void ECBackend::start_read_op(
     op);
 }
 
-void ECBackend::do_read_op(ReadOp &op)
+void ECBackend::do_read_op(ReadOp &op, const set<hobject_t> &only)
 {
   int priority = op.priority;
   ceph_tid_t tid = op.tid;
@@ -2495,6 +2492,8 @@ void ECBackend::do_read_op(ReadOp &op)
   for (map<hobject_t, read_request_t>::iterator i = op.to_read.begin();
        i != op.to_read.end();
        ++i) {
+    if (!only.empty() && !only.count(i->first))
+      continue;  // reissuing some objects, the rest are in flight or done
     bool need_attrs = i->second.want_attrs;
     for (set<pg_shard_t>::const_iterator j = i->second.need.begin();
 	 j != i->second.need.end();
@@ -2523,9 +2522,15 @@ void ECBackend::do_read_op(ReadOp &op)
       }
       assert(!need_attrs);
     }
-    for(map<pg_shard_t,vector<int> >::iterator solution_iter = i->second.solution.begin(); solution_iter != i->second.solution.end(); ++solution_iter)
-    {
-		messages[solution_iter->first].symbol_ids = solution_iter->second;
+    for (map<pg_shard_t, vector<int> >::iterator k = i->second.solution.begin();
+	 k != i->second.solution.end();
+	 ++k) {
+      auto c = i->second.combinations.find(k->first);
+      if (c != i->second.combinations.end())
+	messages[k->first].symbol_combinations[i->first] = c->second;
+      else
+	messages[k->first].symbol_masks[i->first] =
+	  ECSubRead::symbols_to_mask(k->second);
     }
   }
 
@@ -3146,6 +3151,127 @@ void ECBackend::objects_read_and_reconstruct(
 }
 
 
+int ECBackend::replan_symbol_read(
+  const hobject_t &hoid,
+  ReadOp &rop)
+{
+  map<hobject_t, RecoveryOp>::iterator op = recovery_ops.find(hoid);
+  if (op == recovery_ops.end())
+    return -EINVAL;
+  RecoveryOp &recovery = op->second;
+  read_result_t &res = rop.complete[hoid];
+  map<uint64_t, RecoveryOp::extent_t>::iterator ext =
+    recovery.extents.find(res.returned.front().get<0>());
+  if (ext == recovery.extents.end() || !ext->second.symbol_plan)
+    return -EINVAL;
+  RecoveryOp::extent_t &e = ext->second;
+  const SymbolRecoveryPlan *plan = e.symbol_plan;
+  // extents read from now on follow this one, unless already replanned
+  bool current = recovery.symbol_plan == plan;
+
+  // one coding helper lost is replanned once, anything else is a full
+  // decode from the remaining shards
+  SymbolRecoveryPlan *replan = nullptr;
+  int excluded = res.errors.begin()->first.shard;
+  if (res.errors.size() == 1 &&
+      excluded >= (int)ec_impl->get_data_chunk_count() &&
+      plan->excluded < 0)
+    replan = get_symbol_recovery_replan(plan->failed, excluded);
+  map<pg_shard_t, vector<int> > sources;
+  if (replan)
+    sources = hybrid_recovery_solution(hoid, *replan);
+  if (!replan || sources.size() != replan->solution.size() ||
+      !peers_support_symbol_reads(sources)) {
+    dout(10) << __func__ << ": " << hoid << " errors " << res.errors
+	     << ", falling back to full chunk reads" << dendl;
+    // helpers that only served symbols are read again in full
+    for (map<pg_shard_t, vector<int> >::iterator i = e.symbol_sources.begin();
+	 i != e.symbol_sources.end();
+	 ++i) {
+      if (!res.errors.count(i->first))
+	rop.obj_to_source[hoid].erase(i->first);
+    }
+    e.symbol_plan = nullptr;
+    e.symbol_sources.clear();
+    e.reused_symbols.clear();
+    e.xor_plan = ECUtil::xor_aggregation_plan_t();
+    if (current) {
+      recovery.symbol_plan = nullptr;
+      recovery.symbol_sources.clear();
+      recovery.xor_plan = ECUtil::xor_aggregation_plan_t();
+    }
+    int r = send_all_remaining_reads(hoid, rop);
+    if (r == 0)
+      res.errors.clear();
+    return r;
+  }
+
+  // raw symbols from the surviving helpers still feed the new selection,
+  // partial parities were summed for the old one and do not
+  map<pg_shard_t, bufferlist> &returned = res.returned.front().get<2>();
+  e.reused_symbols.clear();
+  if (e.xor_plan.empty()) {
+    for (map<pg_shard_t, vector<int> >::iterator i = e.symbol_sources.begin();
+	 i != e.symbol_sources.end();
+	 ++i) {
+      map<pg_shard_t, bufferlist>::iterator b = returned.find(i->first);
+      if (b == returned.end() || !sources.count(i->first))
+	continue;
+      pair<uint64_t, bufferlist> &reused = e.reused_symbols[i->first.shard];
+      reused.first = ECSubRead::symbols_to_mask(i->second);
+      reused.second.claim(b->second);
+    }
+  }
+  returned.clear();
+
+  set<pg_shard_t> need;
+  map<pg_shard_t, vector<int> > extra;
+  for (map<pg_shard_t, vector<int> >::iterator i = sources.begin();
+       i != sources.end();
+       ++i) {
+    uint64_t want = ECSubRead::symbols_to_mask(i->second);
+    map<int, pair<uint64_t, bufferlist> >::iterator r =
+      e.reused_symbols.find(i->first.shard);
+    if (r != e.reused_symbols.end())
+      want &= ~r->second.first;
+    if (!want)
+      continue;
+    ECSubRead::mask_to_symbols(want, &extra[i->first]);
+    need.insert(i->first);
+  }
+  dout(10) << __func__ << ": " << hoid << " lost helper " << excluded
+	   << ", reading " << extra << " more" << dendl;
+
+  if (current) {
+    recovery.symbol_plan = replan;
+    recovery.symbol_sources = sources;
+    recovery.xor_plan = ECUtil::xor_aggregation_plan_t();
+  }
+  e.symbol_plan = replan;
+  e.symbol_sources.swap(sources);
+  e.xor_plan = ECUtil::xor_aggregation_plan_t();
+
+  const read_request_t &req = rop.to_read.find(hoid)->second;
+  list<boost::tuple<uint64_t, uint64_t, uint32_t> > offsets = req.to_read;
+  GenContext<pair<RecoveryMessages *, read_result_t& > &> *c = req.cb;
+  bool want_attrs = req.want_attrs && !res.attrs;
+  if (want_attrs && need.empty())
+    need.insert(e.symbol_sources.begin()->first);
+  rop.to_read.erase(hoid);
+  rop.to_read.insert(
+    make_pair(
+      hoid,
+      read_request_t(
+	offsets,
+	need,
+	want_attrs,
+	extra,
+	c)));
+  res.errors.clear();
+  do_read_op(rop, set<hobject_t>{hoid});
+  return 0;
+}
+
 int ECBackend::send_all_remaining_reads(
   const hobject_t &hoid,
   ReadOp &rop)
@@ -3154,6 +3280,22 @@ int ECBackend::send_all_remaining_reads(
   const set<pg_shard_t>& ots = rop.obj_to_source[hoid];
   for (set<pg_shard_t>::iterator i = ots.begin(); i != ots.end(); ++i)
     already_read.insert(i->shard);
+  read_result_t &res = rop.complete[hoid];
+  if (res.symbol_reads) {
+    // symbols are useless to a regular decode: drop them and read the
+    // shards that served them in full, unless they failed
+    const read_request_t &req = rop.to_read.find(hoid)->second;
+    for (map<pg_shard_t, vector<int> >::const_iterator i = req.solution.begin();
+	 i != req.solution.end();
+	 ++i) {
+      for (auto &&extent : res.returned)
+	extent.get<2>().erase(i->first);
+      if (!res.errors.count(i->first))
+	already_read.erase(i->first.shard);
+    }
+    res.symbol_reads = false;
+    dout(10) << __func__ << " abandoning symbol reads of " << hoid << dendl;
+  }
   dout(10) << __func__ << " have/error shards=" << already_read << dendl;
   set<pg_shard_t> shards;
   int r = get_remaining_shards(hoid, already_read, &shards);
@@ -3169,19 +3311,19 @@ int ECBackend::send_all_remaining_reads(
     rop.to_read.find(hoid)->second.to_read;
   GenContext<pair<RecoveryMessages *, read_result_t& > &> *c =
     rop.to_read.find(hoid)->second.cb;
+  bool want_attrs = rop.to_read.find(hoid)->second.want_attrs && !res.attrs;
 
-  map<hobject_t, read_request_t> for_read_op;
-  for_read_op.insert(
+  // only this object is reissued, others in the op keep their requests
+  rop.to_read.erase(hoid);
+  rop.to_read.insert(
     make_pair(
       hoid,
       read_request_t(
 	offsets,
 	shards,
-	false,
+	want_attrs,
 	c)));
-
-  rop.to_read.swap(for_read_op);
-  do_read_op(rop);
+  do_read_op(rop, set<hobject_t>{hoid});
   return 0;
 }
 
@@ -22,6 +22,7 @@
 #include "PGBackend.h"
 #include "erasure-code/ErasureCodeInterface.h"
 #include "ECUtil.h"
+#include "ECRecoveryPlanner.h"
 #include "ECTransaction.h"
 #include "ExtentCache.h"
 
@@ -32,6 +33,8 @@ struct ECSubRead;
 struct ECSubReadReply;
 
 struct RecoveryMessages;
+struct SymbolPlanner;
+struct SymbolRecoveryMetrics;
 class ECBackend : public PGBackend {
 public:
   RecoveryHandle *open_recovery_op() override;
@@ -82,62 +85,76 @@ public:
     RecoveryMessages *m
     );
 
-  //add by LYF
-  map<hobject_t, bool> xor_tech;
-  int* crs_hybrid_parity_group_selection;
-  int* crs_final_recovery_parity_vector;
-  int* rows_intersection_infor;
-  int* parity_group_selection;
-  int crs_hybrid_profit;
-  int crs_final_hybrid_profit;
-  map<pg_shard_t,vector<int> > solution_pg_shard_t;
-  map<int, vector<int> > solution_int;
-
-  map<pg_shard_t, vector<int> >  hybrid_recovery_solution(const hobject_t &hoid, int k, int m, int faild_disk_id);
-  int* crs_hybrid_recovery_solution(int k, int m, int w, int failed_disk_id,int *generator_matrix);
-  void construct_rows_intersection_infor_matrix(int m, int k, int w, int failed_disk_id, int *generator_matrix);
-  int different_failed_blocks(int m, int k, int w, int failed_disk_id, int param_row1, int param_row2, int *generator_matrix);
-  int count_rows_intersections_num(int m, int k, int w, int failed_disk_id, int param_row1, int param_row2, int *generator_matrix);
-  int calculate_blocks_savings( int m, int k, int w, int failed_disk_id, int *generator_matrix, int *crs_parity_group_selection);
-  int crs_better_recovery_exist(int m, int k, int w, int failed_disk_id, int* candidate_replace_parity_groups, int *generator_matrix);
-  int not_in_failed_disk_selection(int m, int k, int w, int failed_disk_id, int *generator_matrix,int row);
-  void int2bin(int integer, int *binary, int array_len);
-  int judge_the_better_candidate(int m, int w, int failed_disk_id, int candidate_one, int candidate_two);
-  void crs_adjust_recovery_vector(int m, int k, int w, int failed_disk_id, int fixed_parity_disk, int star_parity_disk, int *generator_matrix);
-  void crs_adjust_recovery_vector_in_adjustment(int m, int k, int w, int failed_disk_id, int fixed_parity_node, int star_parity_node, int pre_fixed_parity_node, int *generator_matrix);
-  void crs_store_selection_to_final(int m, int w);
-  void get_recovery_solution(int k, int m, int w, int failed_disk_id, int* generator_matrix,int* crs_parity_group_selection, map<int, vector<int> >& crs_solution);
+  /**
+   * SymbolRecoveryPlan
+   *
+   * How to rebuild one data shard from symbols: the parity rows chosen
+   * by the SA planner, the symbols to read from every other shard and
+   * the matching XOR decode.  A plan only depends on the code and on
+   * the failed shard, so it is computed once and cached.  The annealer
+   * runs on a planner thread, queued as soon as peering shows a data
+   * shard down or behind; until its plan is ready a shard is recovered
+   * with full chunk reads.  The PGs of a pool share their codec, and
+   * the planner keeps the plans of each codec, so a shard is annealed
+   * once per OSD.
+   */
+  struct SymbolRecoveryPlan {
+    int failed = -1;
+    int excluded = -1;                         ///< coding shard planned around
+    vector<int> parity_group_selection;        ///< m*w rows, 1 if selected
+    map<int, vector<int> > solution;           ///< shard -> symbols to read
+    ECUtil::xor_aggregation_plan_t xor_plan;   ///< empty if not invertible
+  };
+  /// symbol_recovery_plans, symbol_plans_in_flight, recovery_rx_bytes
+  mutable Mutex symbol_plan_lock;
+  /// where the planner thread delivers a plan.  Queued plans share it,
+  /// the destructor clears ec so that a plan finishing later is only
+  /// kept by the SymbolPlanner, and one not started yet is skipped
+  struct SymbolPlanTarget {
+    Mutex lock;  ///< ec
+    ECBackend *ec;
+    explicit SymbolPlanTarget(ECBackend *ec)
+      : lock("ECBackend::SymbolPlanTarget::lock"), ec(ec) {}
+  };
+  std::shared_ptr<SymbolPlanTarget> symbol_plan_target;
+  map<int, SymbolRecoveryPlan> symbol_recovery_plans;  ///< by failed shard
+  set<int> symbol_plans_in_flight;
+  SymbolPlanner *symbol_planner = nullptr;
+  SymbolRecoveryMetrics *symbol_metrics = nullptr;
+  PerfCounters *symbol_logger = nullptr;  ///< process wide, see ECBackend.cc
+  /// symbol bytes received by the recovery ops in flight, by helper
+  map<pg_shard_t, uint64_t> recovery_rx_bytes;
+  /// plans for a failed shard with one more coding shard unreachable,
+  /// by (failed, unreachable)
+  map<pair<int, int>, SymbolRecoveryPlan> symbol_recovery_replans;
+
+  bool supports_symbol_recovery() const {
+    return ec_caps.symbol_recovery;
+  }
+  /// true if the helper decodes per-object symbol masks and combinations
+  /// (OSD_EC_SYMBOL_READ); plans are only used when all helpers do
+  bool peer_supports_symbol_reads(pg_shard_t shard);
+  bool peers_support_symbol_reads(const map<pg_shard_t, vector<int> > &sources);
+  /// same for the helpers that XOR their symbols in xor_plan
+  bool peers_support_xor_plan(const ECUtil::xor_aggregation_plan_t &xor_plan,
+			      const map<pg_shard_t, vector<int> > &sources);
+  /// plans and per helper traffic, for dump_recovery_info and the
+  /// dump_ec_symbol_plans admin socket command
+  void dump_symbol_recovery(Formatter *f) const;
+  SymbolRecoveryPlan *get_symbol_recovery_plan(int failed);
+  void _queue_symbol_recovery_plan(int failed);
+  void queue_symbol_recovery_plans();
+  /// runs on the planner thread, without the backend
+  static void compute_symbol_recovery_plan(const ErasureCodeInterfaceRef &ec_impl,
+					   int failed, SymbolRecoveryPlan *plan);
+  void finish_symbol_recovery_plan(int failed, SymbolRecoveryPlan &&plan);
+  SymbolRecoveryPlan *get_symbol_recovery_replan(int failed, int excluded);
+
+  /// the helpers of plan that have hoid; a shard of the plan without
+  /// it is skipped and reported in unavailable
+  map<pg_shard_t, vector<int> >  hybrid_recovery_solution(const hobject_t &hoid, const SymbolRecoveryPlan &plan, int *unavailable = nullptr);
   int get_min_avail_to_read_shards_hybrid_solution(const hobject_t &hoid,const set<int> &want,bool for_recovery,bool do_redundant_reads,set<pg_shard_t> *to_read,map<pg_shard_t, vector<int> > solution);
   
-  //add by LYF
-  int* sa_crs_hybrid_parity_group_selection;
-  int* sa_crs_hybrid_parity_group_selection_index;
-  int* sa_crs_hybrid_parity_group_selection_best;
-  int* sa_crs_hybrid_parity_group_selection_best_index;
-  int* sa_crs_hybrid_parity_group_selection_temporary;
-  int* sa_crs_hybrid_parity_group_selection_temporary_index;
-
-  int** sa_crs_recovery_equation_group;
-  int** sa_crs_recovery_equation_group_index;
-  int* sa_crs_recovery_equation_group_index_number;
-
-  int sa_crs_hybrid_profit;
-
-  void init_crs_recovery_equation_group(int k,int m ,int w,int failed_disk_id,int *generator_matrix);
-  int calculate_row_profit(int k, int w, int row, int faild_disk_id,int *generator_matrix);
-  int calculate_all_profit(int k,int m,int w,int faild_disk_id,int *generator_matrix,int *sa_crs_hybrid_parity_group_selection);
-  bool judge_row_selected(int m,int w, int row);
-  void init_crs_hybrid_parity_group_selection(int k, int m, int w, int faild_disk_id, int *generator_matrix);
-  void init_crs_hybrid_parity_group_selection_best(int k,int m,int w, int* generator_matrix);
-  void init_crs_hybrid_parity_group_selection_temporary(int k, int m, int w,  int *generator_matrix);
-  void receive_replacement(int m,int w);
-  void remember_best(int m, int w);
-  bool judge_row_selected_temporary(int m, int w, int row);
-  void sa_int2bin(int integer, int *binary, int array_len);
-  bool sa_judge_in_failed_disk_selection(int k,int m,int w,int failed_disk_id,int* generator_matrix,int row, int* temporary_group_id);
-  void sa_search_recovery_solution(int k,int m,int w,int failed_disk_id,int *generator_matrix);
-  int* sa_crs_hybrid_recovery_solution(int k, int m, int w, int failed_disk_id, int *generator_matrix);
-
   /// @see ReadOp below
   void check_recovery_sources(const OSDMapRef& osdmap) override;
 
@@ -333,26 +350,70 @@ private:
       }
     }
 
-    // must be filled if state == WRITING
-    map<int, bufferlist> returned_data;
     map<string, bufferlist> xattrs;
     ECUtil::HashInfoRef hinfo;
     ObjectContextRef obc;
     set<pg_shard_t> waiting_on_pushes;
 
-    // valid in state READING
+    // last extent read
     pair<uint64_t, uint64_t> extent_requested;
 
+    /// set when the object is rebuilt from symbols; applies to the
+    /// extents read from now on
+    SymbolRecoveryPlan *symbol_plan = nullptr;
+    map<pg_shard_t, vector<int> > symbol_sources;
+    /// set when helpers pre-XOR their symbols for this object
+    ECUtil::xor_aggregation_plan_t xor_plan;
+    /// symbol bytes received for this object, by helper
+    map<pg_shard_t, uint64_t> rx_bytes;
+
+    /**
+     * An extent read ahead of the pushes.  Reads of later extents
+     * overlap the decode and push of earlier ones, up to
+     * osd_recovery_pipeline_depth extents and
+     * osd_recovery_pipeline_max_bytes; pushes still go out in order.
+     */
+    struct extent_t {
+      uint64_t length = 0;
+      /// how the extent was read, a replan only changes this extent
+      SymbolRecoveryPlan *symbol_plan = nullptr;
+      map<pg_shard_t, vector<int> > symbol_sources;
+      ECUtil::xor_aggregation_plan_t xor_plan;
+      /// symbols kept from before a replan, by shard: (mask, symbols)
+      map<int, pair<uint64_t, bufferlist> > reused_symbols;
+      /// decoded shards, must be filled before the extent is pushed
+      map<int, bufferlist> returned_data;
+      bool decoded = false;
+    };
+    map<uint64_t, extent_t> extents;  ///< by logical offset, not yet pushed
+    uint64_t read_to = 0;             ///< end of the last extent read
+    uint64_t extent_size = 0;         ///< logical bytes per extent read
+    uint64_t extents_bytes() const {
+      uint64_t bytes = 0;
+      for (auto &&i : extents)
+	bytes += i.second.length;
+      return bytes;
+    }
+
     void dump(Formatter *f) const;
 
     RecoveryOp() : state(IDLE) {}
   };
   friend ostream &operator<<(ostream &lhs, const RecoveryOp &rhs);
   map<hobject_t, RecoveryOp> recovery_ops;
+  /// drops the op and its share of recovery_rx_bytes
+  void erase_recovery_op(const hobject_t &hoid);
+
+  /// extent size for op: symbol reads cover whole packet rows and are
+  /// sized to move about osd_recovery_max_chunk bytes per round
+  uint64_t get_recovery_chunk_size(const RecoveryOp &op) const;
 
   void continue_recovery_op(
     RecoveryOp &op,
     RecoveryMessages *m);
+  bool issue_recovery_reads(
+    RecoveryOp &op,
+    RecoveryMessages *m);
   void dispatch_recovery_messages(RecoveryMessages &m, int priority);
   friend struct OnRecoveryReadComplete;
   void handle_recovery_read_complete(
@@ -397,7 +458,8 @@ public:
     list<
       boost::tuple<
 	uint64_t, uint64_t, map<pg_shard_t, bufferlist> > > returned;
-    read_result_t() : r(0) {}
+    bool symbol_reads;  ///< returned holds symbols, see read_request_t::solution
+    read_result_t() : r(0), symbol_reads(false) {}
   };
   struct read_request_t {
     const list<boost::tuple<uint64_t, uint64_t, uint32_t> > to_read;
@@ -405,6 +467,8 @@ public:
     const bool want_attrs;
     GenContext<pair<RecoveryMessages *, read_result_t& > &> *cb;
     map<pg_shard_t,vector<int> > solution;
+    /// shards that return partial parities instead of raw symbols
+    map<pg_shard_t, vector<uint64_t> > combinations;
     read_request_t(
       const list<boost::tuple<uint64_t, uint64_t, uint32_t> > &to_read,
       const set<pg_shard_t> &need,
@@ -463,6 +527,7 @@ public:
          if(!hpair.second.solution.empty())
          {
             this->solution.insert(hpair.second.solution.begin(),hpair.second.solution.end());
+            complete[hpair.first].symbol_reads = true;
          }
 	       for (auto &&extent: hpair.second.to_read) {
 	           returned.push_back(
@@ -481,6 +546,10 @@ public:
   void filter_read_op(
     const OSDMapRef& osdmap,
     ReadOp &op);
+  /// drops hoid from the other recovery read ops, the extents a
+  /// pipelined recovery op reads ahead; a read op left with nothing to
+  /// read goes away
+  void cancel_read_ahead(const hobject_t &hoid, ceph_tid_t except);
   void complete_read_op(ReadOp &rop, RecoveryMessages *m);
   friend ostream &operator<<(ostream &lhs, const ReadOp &rhs);
   map<ceph_tid_t, ReadOp> tid_to_read_map;
@@ -491,7 +560,10 @@ public:
     OpRequestRef op,
     bool do_redundant_reads, bool for_recovery);
 
-  void do_read_op(ReadOp &rop);
+  void do_read_op(ReadOp &rop, const set<hobject_t> &only = set<hobject_t>());
+  int replan_symbol_read(
+    const hobject_t &hoid,
+    ReadOp &rop);
   int send_all_remaining_reads(
     const hobject_t &hoid,
     ReadOp &rop);
@@ -630,7 +702,13 @@ public:
   bool try_finish_rmw();
   void check_ops();
 
+  /// shared with the other PGs of the pool, see
+  /// ErasureCodePluginRegistry::factory
   ErasureCodeInterfaceRef ec_impl;
+  /// queried once from ec_impl in the constructor, it does not change
+  /// for the life of the instance.  The op thread checks this instead of
+  /// the pool profile; the planner thread reads ec_impl directly
+  ErasureCodeCapabilities ec_caps;
 
 
   /**
@@ -698,6 +776,7 @@ public:
     CephContext *cct,
     ErasureCodeInterfaceRef ec_impl,
     uint64_t stripe_width);
+  ~ECBackend() override;
 
   /// Returns to_read replicas sufficient to reconstruct want
   int get_min_avail_to_read_shards(
@@ -163,8 +163,39 @@ void ECSubWriteReply::generate_test_instances(list<ECSubWriteReply*>& o)
   o.back()->applied = true;
 }
 
+uint64_t ECSubRead::symbols_to_mask(const vector<int> &symbol_ids)
+{
+  uint64_t mask = 0;
+  for (auto sid : symbol_ids) {
+    assert(sid >= 0 && sid < 64);
+    mask |= 1ull << sid;
+  }
+  return mask;
+}
+
+void ECSubRead::mask_to_symbols(uint64_t mask, vector<int> *symbol_ids)
+{
+  symbol_ids->clear();
+  for (int sid = 0; mask; ++sid, mask >>= 1) {
+    if (mask & 1)
+      symbol_ids->push_back(sid);
+  }
+}
+
 void ECSubRead::encode(bufferlist &bl, uint64_t features) const
 {
+  // peers that predate per-object masks apply one symbol list to every
+  // object in the message; only hand them a list if all objects agree.
+  vector<int> legacy_symbol_ids;
+  if (!symbol_masks.empty()) {
+    uint64_t mask = symbol_masks.begin()->second;
+    bool uniform = symbol_masks.size() == to_read.size();
+    for (auto &p : symbol_masks)
+      uniform = uniform && p.second == mask;
+    if (uniform)
+      mask_to_symbols(mask, &legacy_symbol_ids);
+  }
+
   if ((features & CEPH_FEATURE_OSD_FADVISE_FLAGS) == 0) {
     ENCODE_START(1, 1, bl);
     ::encode(from, bl);
@@ -181,23 +212,38 @@ void ECSubRead::encode(bufferlist &bl, uint64_t features) const
     }
     ::encode(tmp, bl);
     ::encode(attrs_to_read, bl);
-    ::encode(symbol_ids,bl);
+    ::encode(legacy_symbol_ids, bl);
+    ENCODE_FINISH(bl);
+    return;
+  }
+
+  if (!HAVE_FEATURE(features, OSD_EC_SYMBOL_READ)) {
+    // the primary only plans per-object masks and combinations for
+    // peers with the feature, see ECBackend::peer_supports_symbol_reads
+    ENCODE_START(2, 2, bl);
+    ::encode(from, bl);
+    ::encode(tid, bl);
+    ::encode(to_read, bl);
+    ::encode(attrs_to_read, bl);
+    ::encode(legacy_symbol_ids, bl);
     ENCODE_FINISH(bl);
     return;
   }
 
-  ENCODE_START(2, 2, bl);
+  ENCODE_START(4, 2, bl);
   ::encode(from, bl);
   ::encode(tid, bl);
   ::encode(to_read, bl);
   ::encode(attrs_to_read, bl);
-  ::encode(symbol_ids,bl);
+  ::encode(legacy_symbol_ids, bl);
+  ::encode(symbol_masks, bl);
+  ::encode(symbol_combinations, bl);
   ENCODE_FINISH(bl);
 }
 
 void ECSubRead::decode(bufferlist::iterator &bl)
 {
-  DECODE_START(2, bl);
+  DECODE_START(4, bl);
   ::decode(from, bl);
   ::decode(tid, bl);
   if (struct_v == 1) {
@@ -216,17 +262,33 @@ void ECSubRead::decode(bufferlist::iterator &bl)
     ::decode(to_read, bl);
   }
   ::decode(attrs_to_read, bl);
-  ::decode(symbol_ids,bl);
+  vector<int> legacy_symbol_ids;
+  ::decode(legacy_symbol_ids, bl);
+  symbol_masks.clear();
+  if (struct_v >= 3) {
+    ::decode(symbol_masks, bl);
+  } else if (!legacy_symbol_ids.empty()) {
+    uint64_t mask = symbols_to_mask(legacy_symbol_ids);
+    for (auto &p : to_read)
+      symbol_masks[p.first] = mask;
+  }
+  symbol_combinations.clear();
+  if (struct_v >= 4)
+    ::decode(symbol_combinations, bl);
   DECODE_FINISH(bl);
 }
 
 std::ostream &operator<<(
   std::ostream &lhs, const ECSubRead &rhs)
 {
-  return lhs
-    << "ECSubRead(tid=" << rhs.tid
-    << ", to_read=" << rhs.to_read
-    << ", attrs_to_read=" << rhs.attrs_to_read << ")";
+  lhs << "ECSubRead(tid=" << rhs.tid
+      << ", to_read=" << rhs.to_read
+      << ", attrs_to_read=" << rhs.attrs_to_read;
+  if (!rhs.symbol_masks.empty())
+    lhs << ", symbol_masks=" << rhs.symbol_masks;
+  if (!rhs.symbol_combinations.empty())
+    lhs << ", symbol_combinations=" << rhs.symbol_combinations;
+  return lhs << ")";
 }
 
 void ECSubRead::dump(Formatter *f) const
@@ -256,6 +318,27 @@ void ECSubRead::dump(Formatter *f) const
   }
   f->close_section();
 
+  f->open_array_section("symbol_masks");
+  for (auto &p : symbol_masks) {
+    f->open_object_section("object");
+    f->dump_stream("oid") << p.first;
+    f->dump_format("mask", "0x%llx", (unsigned long long)p.second);
+    f->close_section();
+  }
+  f->close_section();
+
+  f->open_array_section("symbol_combinations");
+  for (auto &p : symbol_combinations) {
+    f->open_object_section("object");
+    f->dump_stream("oid") << p.first;
+    f->open_array_section("combinations");
+    for (auto c : p.second)
+      f->dump_format("mask", "0x%llx", (unsigned long long)c);
+    f->close_section();
+    f->close_section();
+  }
+  f->close_section();
+
   f->open_array_section("object_attrs_requested");
   for (set<hobject_t>::const_iterator i = attrs_to_read.begin();
        i != attrs_to_read.end();
@@ -285,6 +368,14 @@ void ECSubRead::generate_test_instances(list<ECSubRead*>& o)
   o.back()->to_read[hoid2].push_back(boost::make_tuple(400, 600, 0));
   o.back()->to_read[hoid2].push_back(boost::make_tuple(2000, 600, 0));
   o.back()->attrs_to_read.insert(hoid2);
+  o.back()->symbol_masks[hoid1] = 0x5;
+  o.back()->symbol_masks[hoid2] = 0x82;
+  o.push_back(new ECSubRead());
+  o.back()->from = pg_shard_t(2, shard_id_t(-1));
+  o.back()->tid = 301;
+  o.back()->to_read[hoid1].push_back(boost::make_tuple(0, 4096, 0));
+  o.back()->symbol_combinations[hoid1].push_back(0x3);
+  o.back()->symbol_combinations[hoid1].push_back(0x6);
 }
 
 void ECSubReadReply::encode(bufferlist &bl) const
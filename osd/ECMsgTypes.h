@@ -102,12 +102,27 @@ struct ECSubWriteReply {
 };
 WRITE_CLASS_ENCODER(ECSubWriteReply)
 
+/*
+ * OSD_EC_SYMBOL_READ, allocated in include/ceph_features.h with the
+ * other feature bits and part of CEPH_FEATURES_ALL: OSDs that decode
+ * ECSubRead v3 (per-object symbol masks) and v4 (helper-side XOR
+ * combinations).  SA-RSR helpers without it only know the v2 symbol
+ * list, applied to every object of the message, and read objects in
+ * full when it is empty.
+ */
 struct ECSubRead {
   pg_shard_t from;
   ceph_tid_t tid;
   map<hobject_t, list<boost::tuple<uint64_t, uint64_t, uint32_t> >> to_read;
   set<hobject_t> attrs_to_read;
-  vector<int> symbol_ids;
+  /// symbols to read per object: bit i selects symbol i of every packet
+  /// row (w <= 64).  Objects without an entry are read in full.
+  map<hobject_t, uint64_t> symbol_masks;
+  /// helper-side aggregation: per object, one output packet per packet
+  /// row for each entry, the XOR of the symbols in that mask
+  map<hobject_t, vector<uint64_t> > symbol_combinations;
+  static uint64_t symbols_to_mask(const vector<int> &symbol_ids);
+  static void mask_to_symbols(uint64_t mask, vector<int> *symbol_ids);
   void encode(bufferlist &bl, uint64_t features) const;
   void decode(bufferlist::iterator &bl);
   void dump(Formatter *f) const;
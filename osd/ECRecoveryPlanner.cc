@@ -0,0 +1,805 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ECRecoveryPlanner.h"
+
+ECRecoveryPlanner::~ECRecoveryPlanner()
+{
+  free_crs_recovery_equation_group();
+}
+
+//add by LYF, climb_search
+int ECRecoveryPlanner::different_failed_blocks(int m, int k, int w, int failed_disk_id, int param_row1, int param_row2, int *generator_matrix)
+{
+	for (int j=0;j<w;j++)
+	{
+		if (generator_matrix[param_row1*k*w+failed_disk_id*w+j]!=generator_matrix[param_row2*k*w+failed_disk_id*w+j])
+		{
+			return 1;
+		}
+   	}
+	return 0;
+}
+int ECRecoveryPlanner::count_rows_intersections_num(int m, int k, int w, int failed_disk_id, int param_row1, int param_row2, int *generator_matrix)
+{
+	int intersections_count=0;
+	for (int i=0;i<(k*w);i++)
+	{
+       	if ((i/w)!=failed_disk_id)
+       	{
+       		if ((generator_matrix[param_row1*k*w+i]==0)&&(generator_matrix[param_row2*k*w+i]==0))
+       		{
+       			intersections_count++;
+       		}
+        }
+    }
+    return intersections_count;
+}
+void ECRecoveryPlanner::construct_rows_intersection_infor_matrix(int m, int k, int w, int failed_disk_id, int *generator_matrix)
+{
+	rows_intersection_infor= new int[(m*w)*(m*w)];
+	for (int i=0;i<(m*w);i++)
+	{
+		for (int j=i;j<(m*w);j++) 
+		{
+			if (i==j) 
+			{
+				rows_intersection_infor[i*m*w+j]= -1;
+			}
+			else 
+			{
+             	if (different_failed_blocks(m,k,w,failed_disk_id,i,j,generator_matrix)) 
+             	{
+             		rows_intersection_infor[i*m*w+j]=count_rows_intersections_num(m,k,w,failed_disk_id, i,j,generator_matrix);
+             	}
+				else 
+				{
+					rows_intersection_infor[i*m*w+j]= -1;
+				}
+				rows_intersection_infor[j*m*w+i]=rows_intersection_infor[i*m*w+j];
+			}
+		}
+	}
+}
+int ECRecoveryPlanner::calculate_blocks_savings( int m, int k, int w, int failed_disk_id, int *generator_matrix, int *crs_parity_group_selection) 
+{
+	int blocks_savings=0;
+	for (int i=0;i<k*w;i++) 
+	{
+		if ((i/w)!=failed_disk_id) 
+		{
+			int tmp_saving=1;
+			for (int j=0;j<m*w;j++) 
+			{
+				if (crs_parity_group_selection[j]==1) 
+				{
+					//This parity symbol is selected to participate in recovery
+					if (generator_matrix[j*k*w+i]==1) 
+					{
+						tmp_saving=0;
+						break;
+					}
+				}
+			}
+			blocks_savings=blocks_savings+tmp_saving;
+		}
+	}
+	return blocks_savings;
+}
+void ECRecoveryPlanner::int2bin(int integer, int *binary, int array_len) 
+{
+	int k = 0, n = 0;
+	int remain;
+	int *temp = new int[array_len];
+	do {
+		remain = integer % 2;
+		integer = integer / 2;
+		temp[k++] = remain;
+	} while (integer > 0);
+	//Fill 0 into the convert arra
+	while (k<array_len) 
+	{
+		temp[k++]=0;
+	}
+	while (k > 0) 
+	{
+		binary[n++] = temp[--k];
+	}
+	delete[] temp;
+}
+int ECRecoveryPlanner::not_in_failed_disk_selection(int m, int k, int w, int failed_disk_id, int *generator_matrix,int row) 
+{
+	int i, j, t;
+	j=0;
+	if (crs_hybrid_parity_group_selection[row]==1) 
+	{
+		return 0;
+	}//The line row is already in the selection and cannot be replaced again
+	int source_num, search_scale;
+	search_scale=0;
+	source_num=0; 
+	for (i=0;i<m*w;i++) 
+	{
+		if (crs_hybrid_parity_group_selection[i]==1) 
+		{
+			source_num++;
+		}
+	}//An option has been deleted, and it should be w-1
+	int* temp_array = new int[source_num];
+	for (i=0;i<m*w;i++) 
+	{
+		if (crs_hybrid_parity_group_selection[i]==1) 
+		{
+			temp_array[j]=i;
+			j++;
+		}
+	}//temp_array saves: the index of 1 in crs_hybrid_parity_group_selection, which represents which parity symbol participates in reconstruction
+	search_scale=1<<source_num; //Be equal to 2^source_num,When source_num is equal to 2, search_scale is equal to 4
+	int* binaryArray=new int[source_num];
+	int* temp_sum = new int[w];
+	int combination_found=0;
+	for (i=0;i<search_scale && !combination_found;i++) 
+	{
+		memset(temp_sum,0,sizeof(int)*w);
+		int2bin(i,binaryArray,source_num);
+		for (j=0;j<source_num;j++) 
+		{
+			if (binaryArray[j]==1) 
+			{
+				for (t=0;t<w;t++) 
+				{
+					if (generator_matrix[temp_array[j]*k*w+failed_disk_id*w+t]==temp_sum[t]) 
+					{
+						temp_sum[t]=0;
+					} 
+					else 
+					{
+						temp_sum[t]=1;
+					}
+				}
+			}
+		}
+		for (t=0;t<w;t++) 
+		{
+			if (temp_sum[t]!=generator_matrix[row*k*w+failed_disk_id*w+t]) 
+			{
+				break;
+			}
+		}
+		if (t==w) 
+		{
+			combination_found=1;
+		}
+
+	}
+	delete[] temp_array;
+	delete[] temp_sum;
+	delete[] binaryArray;
+	return !combination_found;
+}
+int ECRecoveryPlanner::judge_the_better_candidate(int m, int w, int failed_disk_id, int candidate_one, int candidate_two)
+{
+	int candidate1_sum, candidate2_sum;
+	candidate1_sum=0;
+	candidate2_sum=0;
+	for(int i=0;i<(m*w);i++)
+	{
+		if ((i != candidate_one) && (i != candidate_two) && ((i / w) != failed_disk_id)) 
+		{
+			candidate1_sum = candidate1_sum + rows_intersection_infor[candidate_one*m*w + i];
+		}
+	}
+	for (int i=0;i<(m*w);i++)
+	{
+		if ((i != candidate_one) && (i != candidate_two) && ((i / w) != failed_disk_id))
+		{
+			candidate2_sum = candidate2_sum + rows_intersection_infor[candidate_two*m*w + i];
+		}
+	}
+	if (candidate1_sum>=candidate2_sum)
+	{
+		return 1;
+	} 
+	else 
+	{
+		return 0;
+	}
+}
+int ECRecoveryPlanner::crs_better_recovery_exist(int m, int k, int w, int failed_disk_id, int* candidate_replace_parity_groups, int *generator_matrix)
+{
+	int i, j;
+	int optimal_j= -1; 
+	int selected_candidate= -1;
+	for (i=0;i<(m*w);i++) 
+	{
+		if (candidate_replace_parity_groups[i]== 1) 
+		{
+			for (j=0;j<(m*w);j++) 
+			{
+				if (crs_hybrid_parity_group_selection[j]== 1) 
+				{
+					crs_hybrid_parity_group_selection[j]= 0;
+					if (not_in_failed_disk_selection(m,k,w,failed_disk_id,generator_matrix, i))
+					{
+						crs_hybrid_parity_group_selection[i]=1;
+						int savings=calculate_blocks_savings(m,k,w,failed_disk_id, generator_matrix,crs_hybrid_parity_group_selection);
+						if (savings>crs_hybrid_profit) 
+						{
+							crs_hybrid_profit=savings;
+							optimal_j=j;
+							selected_candidate=i;
+						} 
+						else if (savings==crs_hybrid_profit) 
+						{
+							if (optimal_j == -1) 
+							{
+								crs_hybrid_profit = savings;
+								optimal_j = j;
+								selected_candidate = i;
+							}
+							else if(judge_the_better_candidate(m, w, failed_disk_id,j,optimal_j)== 1) 
+							{
+								crs_hybrid_profit=savings;
+								optimal_j=j;
+								selected_candidate=i;
+							}
+                	    }
+						crs_hybrid_parity_group_selection[i]= 0;
+					}
+					crs_hybrid_parity_group_selection[j]= 1;
+				}
+			}
+		}
+    	}	
+    	if (optimal_j != -1) 
+    	{
+        	crs_hybrid_parity_group_selection[optimal_j]= 0;
+        	crs_hybrid_parity_group_selection[selected_candidate]= 1;
+    	}
+	return selected_candidate;
+}
+void ECRecoveryPlanner::crs_adjust_recovery_vector_in_adjustment(int m, int k, int w, int failed_disk_id, int fixed_parity_node, int star_parity_node, int pre_fixed_parity_node, int *generator_matrix)
+{
+	int i, j;
+	int tmp_replaced;
+	int tmp_crs_hybrid_profit;
+	int* tmp_crs_failed_disk_selection = new int[m*w];
+	tmp_crs_hybrid_profit = crs_hybrid_profit;
+    for (i = 0; i<(m*w); i++) 
+    {
+		tmp_crs_failed_disk_selection[i] = crs_hybrid_parity_group_selection[i];
+	}
+	int* candidate_replace_parity_groups = new int[m*w];
+	for (i = 0; i<m; i++)
+	{
+		if (((i<pre_fixed_parity_node) || (i == star_parity_node)) || (i<fixed_parity_node))
+		{
+			for (j = 0; j<(m*w); j++) 
+			{
+				if ((j / w) == i) 
+				{
+					candidate_replace_parity_groups[j] = 1;
+				}
+				else 
+				{
+					candidate_replace_parity_groups[j] = 0;
+				}
+			}
+			while ((tmp_replaced = crs_better_recovery_exist(m, k, w, failed_disk_id, candidate_replace_parity_groups, generator_matrix)) != -1) 
+			{
+				candidate_replace_parity_groups[tmp_replaced] = 0;
+			}
+		}
+	}
+	if (crs_hybrid_profit <= tmp_crs_hybrid_profit) 
+	{
+		crs_hybrid_profit = tmp_crs_hybrid_profit;
+		for (i = 0; i<(m*w); i++) 
+		{
+			crs_hybrid_parity_group_selection[i] = tmp_crs_failed_disk_selection[i];
+		}
+	}
+	delete[] tmp_crs_failed_disk_selection;
+	delete[] candidate_replace_parity_groups;
+}
+void ECRecoveryPlanner::crs_adjust_recovery_vector(int m, int k, int w, int failed_disk_id, int fixed_parity_disk, int star_parity_disk, int *generator_matrix)
+{
+	int i, j;
+	int tmp_replaced;
+	int tmp_crs_hybrid_profit;
+	int* tmp_crs_failed_disk_selection = new int[m*w];
+	tmp_crs_hybrid_profit = crs_hybrid_profit;
+	for (i = 0; i<(m*w); i++)
+	{
+		tmp_crs_failed_disk_selection[i] = crs_hybrid_parity_group_selection[i];
+	}
+	int* candidate_replace_parity_groups = new int[m*w];
+	for (i = 0; i<m; i++)
+	{
+		if ((i<fixed_parity_disk) || (i == star_parity_disk))
+		{
+			for (j = 0; j<(m*w); j++)
+			{
+				if ((j / w) == i) 
+				{
+					candidate_replace_parity_groups[j] = 1;
+				}
+				else 
+				{
+					candidate_replace_parity_groups[j] = 0;
+				}
+			}
+			while ((tmp_replaced = crs_better_recovery_exist(m, k, w, failed_disk_id, candidate_replace_parity_groups, generator_matrix)) != -1)
+			{
+				candidate_replace_parity_groups[tmp_replaced] = 0;
+			}
+			crs_adjust_recovery_vector_in_adjustment(m, k, w, failed_disk_id, i, star_parity_disk, fixed_parity_disk, generator_matrix);
+		}
+	}
+	for (i = 0; i<(m*w); i++) 
+	{
+		if ((i / w) == fixed_parity_disk) 
+		{
+			candidate_replace_parity_groups[i] = 1;
+		}
+		else 
+		{
+			candidate_replace_parity_groups[i] = 0;
+		}
+	}
+	while ((tmp_replaced = crs_better_recovery_exist(m, k, w, failed_disk_id, candidate_replace_parity_groups, generator_matrix)) != -1)
+	{
+		candidate_replace_parity_groups[tmp_replaced] = 0;
+	}
+	crs_adjust_recovery_vector_in_adjustment(m, k, w, failed_disk_id, fixed_parity_disk, star_parity_disk, fixed_parity_disk, generator_matrix);
+	if (crs_hybrid_profit <= tmp_crs_hybrid_profit)
+	{
+		crs_hybrid_profit = tmp_crs_hybrid_profit;
+		for (i = 0; i<(m*w); i++)
+		{
+			crs_hybrid_parity_group_selection[i] = tmp_crs_failed_disk_selection[i];
+		}
+	}
+	delete[] tmp_crs_failed_disk_selection;
+	delete[] candidate_replace_parity_groups;
+}
+void ECRecoveryPlanner::crs_store_selection_to_final(int m, int w){
+	for (int i = 0; i<(m*w); i++)
+	{
+		crs_final_recovery_parity_vector[i] = crs_hybrid_parity_group_selection[i];
+	}
+}
+int* ECRecoveryPlanner::crs_hybrid_recovery_solution(int k, int m, int w, int failed_disk_id,int *generator_matrix)
+{
+	crs_hybrid_profit = 0;
+	crs_final_hybrid_profit = 0;
+	int* candidate_replace_parity_groups = new int[m*w];
+	crs_hybrid_parity_group_selection = new int[m*w];
+	crs_final_recovery_parity_vector = new int[m*w];
+	construct_rows_intersection_infor_matrix(m,k,w,failed_disk_id,generator_matrix);
+	for (int i=0;i<(m*w);i++)
+	{
+		crs_hybrid_parity_group_selection[i]=0;
+		candidate_replace_parity_groups[i]=0;
+		crs_final_recovery_parity_vector[i]=0;
+	}
+	int *optimal_conventional_recovery=new int[m];
+	for (int i=0;i<m;i++)
+	{
+		optimal_conventional_recovery[i]=1;
+	}
+	for (int j=0;j<m;j++)
+	{
+		if (optimal_conventional_recovery[j]==1)
+		{
+			for (int i=0;i<(m*w);i++)
+			{
+				if ((i/w)==j)
+				{
+					crs_hybrid_parity_group_selection[i]=1;
+				} 
+				else 
+				{
+					crs_hybrid_parity_group_selection[i]=0;
+				}
+			}
+			crs_hybrid_profit=calculate_blocks_savings(m,k,w,failed_disk_id,generator_matrix,crs_hybrid_parity_group_selection);
+			for (int t=0;t<m;t++)
+			{
+				if (t!=j)
+				{
+					for (int i=0;i<(m*w);i++)
+					{
+						if ((i/w)==t)
+						{
+							candidate_replace_parity_groups[i]= 1;
+						} else 
+						{
+							candidate_replace_parity_groups[i]= 0;
+						}
+					}
+           			int tmp_replaced = crs_better_recovery_exist(m, k, w, failed_disk_id, candidate_replace_parity_groups, generator_matrix);
+					while (tmp_replaced != -1)
+					{
+						candidate_replace_parity_groups[tmp_replaced]= 0;
+						tmp_replaced = crs_better_recovery_exist(m, k, w, failed_disk_id, candidate_replace_parity_groups, generator_matrix);
+					}
+					crs_adjust_recovery_vector(m, k, w, failed_disk_id, t, j, generator_matrix);
+				}
+			}
+		}
+		if (crs_hybrid_profit>=crs_final_hybrid_profit)
+		{
+			crs_final_hybrid_profit = crs_hybrid_profit;
+			crs_store_selection_to_final(m, w);
+		}
+	}	
+	delete[] candidate_replace_parity_groups;
+	delete[] crs_hybrid_parity_group_selection;
+	delete[] optimal_conventional_recovery;
+	delete[] rows_intersection_infor;
+	return crs_final_recovery_parity_vector;
+}
+void ECRecoveryPlanner::get_recovery_solution(int k, int m, int w, int failed_disk_id, int* generator_matrix,int* parity_group_selection, map<int, vector<int> >& solution)
+{
+	int* tmp_recovery_solution;
+	tmp_recovery_solution = new int[k*w];
+	int i, j;
+	for (i = 0; i < k*w;i++) 
+	{
+		for (j = 0; j < m*w;j++) 
+		{
+			if (parity_group_selection[j] == 1) 
+			{
+				if (generator_matrix[j*k*w + i] == 1) 
+				{
+					tmp_recovery_solution[i] = 1;
+					break;
+				}
+			}
+		}
+		if (j == m*w) 
+		{
+			tmp_recovery_solution[i] = 0;
+		}
+	}
+	for (i = 0; i < k*w;i++)
+	{
+		if (i/w == failed_disk_id)
+		{
+		
+		}
+		else if (tmp_recovery_solution[i]== 1)
+		{
+			map<int, vector<int> >::iterator solution_iterator = solution.find(i / w);
+			if (solution_iterator == solution.end())
+			{
+				vector<int> solution_index;
+				solution_index.insert(solution_index.end(), i%w);
+				solution.insert(map<int, vector<int> >::value_type(i / w, solution_index));
+			}
+			else
+			{
+				solution_iterator->second.push_back(i%w);
+			}
+		}
+	}
+	for (i = 0; i < m*w;i++)
+	{
+		if (parity_group_selection[i]== 1)
+		{
+			map<int, vector<int> >::iterator solution_iterator = solution.find(i/w+k);
+			if (solution_iterator == solution.end())
+			{
+				vector<int> solution_index;
+				solution_index.insert(solution_index.end(), i%w);
+				solution.insert(map<int, vector<int> >::value_type(i/w+k, solution_index));
+			}
+			else 
+			{
+				solution_iterator->second.insert(solution_iterator->second.end(), i%w);
+			}
+		}
+	}
+	delete[] tmp_recovery_solution;
+}
+
+//add  by LYF, sa_search
+void ECRecoveryPlanner::init_crs_recovery_equation_group(int k,int m ,int w,int failed_disk_id,int *generator_matrix) {
+	free_crs_recovery_equation_group();
+	sa_crs_recovery_equation_groups = w;
+	sa_crs_recovery_equation_group = new int*[w];
+	sa_crs_recovery_equation_group_index = new int*[w];
+	sa_crs_recovery_equation_group_index_number = new int[w];
+	for (int i = 0; i < w;i++) {
+		sa_crs_recovery_equation_group[i] = new int[m*w];
+		sa_crs_recovery_equation_group_index_number[i] = 0;
+		for (int j = 0; j < m*w; j++) {
+			sa_crs_recovery_equation_group[i][j] = 0;
+		}
+	}
+	for (int i = 0; i < m*w;i++) {
+		for (int j = 0; j < k*w;j++) {
+			if (j/w==failed_disk_id) {
+				if (generator_matrix[i*k*w+j]==1) {
+					sa_crs_recovery_equation_group[j%w][i] = 1;
+					sa_crs_recovery_equation_group_index_number[j%w]++;
+				}
+			}
+		}
+	}
+	//Initialization: sa_crs_recovery_equation_group_index
+	for (int i = 0; i < w; ++i) {
+		sa_crs_recovery_equation_group_index[i] = new int[sa_crs_recovery_equation_group_index_number[i]];
+		int index = 0;
+		for (int j = 0; j < m*w; ++j) {
+			if (sa_crs_recovery_equation_group[i][j] == 1) {
+				sa_crs_recovery_equation_group_index[i][index++] = j;
+			}
+		}
+	}
+}
+void ECRecoveryPlanner::free_crs_recovery_equation_group() {
+	for (int i = 0; i < sa_crs_recovery_equation_groups; ++i) {
+		delete[] sa_crs_recovery_equation_group[i];
+		delete[] sa_crs_recovery_equation_group_index[i];
+	}
+	delete[] sa_crs_recovery_equation_group;
+	delete[] sa_crs_recovery_equation_group_index;
+	delete[] sa_crs_recovery_equation_group_index_number;
+	sa_crs_recovery_equation_groups = 0;
+	sa_crs_recovery_equation_group = nullptr;
+	sa_crs_recovery_equation_group_index = nullptr;
+	sa_crs_recovery_equation_group_index_number = nullptr;
+}
+int ECRecoveryPlanner::calculate_row_profit(int k, int w, int row, int faild_disk_id,int *generator_matrix) {
+	int row_profit = 0;
+	for (int i = 0; i < k*w;i++) {
+		if (i/w!= faild_disk_id && generator_matrix[row*k*w+i]==1) {
+			row_profit++;
+		}
+	}
+	return row_profit;
+}
+int ECRecoveryPlanner::calculate_all_profit(int k,int m,int w,int faild_disk_id,int *generator_matrix,int *sa_crs_hybrid_parity_group_selection) {
+	int all_profit = 0;
+	for (int i = 0; i < k*w;i++) {
+		if (i/w!=faild_disk_id) {
+			for (int j = 0; j < m*w; j++) {
+				if (sa_crs_hybrid_parity_group_selection[j]==1) {//The row is selected as a recovery equation to participate in reconstruction
+					if (generator_matrix[j*k*w+i]==1) {
+						all_profit++;
+						break;
+					}
+				}
+			}
+		}
+	}
+	return all_profit;
+}
+bool ECRecoveryPlanner::judge_row_selected(int m,int w, int row) {
+	bool selected = false;
+	for (int i = 0; i < m*w; i++) {
+		if (sa_crs_hybrid_parity_group_selection[row] == 1) {
+			selected = true;
+		}
+	}
+	return selected;
+}
+void ECRecoveryPlanner::init_crs_hybrid_parity_group_selection(int k, int m, int w, int faild_disk_id, int *generator_matrix) {
+	//Randomly select the appropriate recovery solution
+	sa_crs_hybrid_parity_group_selection = new int[m*w];
+	sa_crs_hybrid_parity_group_selection_index = new int[w];
+	for (int i = 0; i < m*w; i++) {
+		sa_crs_hybrid_parity_group_selection[i] = 0;
+	}
+	for (int i = 0; i < w; ++i) {
+		int symbol_id = rand_r(&seed) % sa_crs_recovery_equation_group_index_number[i];
+		while (sa_crs_hybrid_parity_group_selection[sa_crs_recovery_equation_group_index[i][symbol_id]] == 1) {
+			symbol_id = rand_r(&seed) % sa_crs_recovery_equation_group_index_number[i];
+		}
+		sa_crs_hybrid_parity_group_selection[sa_crs_recovery_equation_group_index[i][symbol_id]] = 1;
+		sa_crs_hybrid_parity_group_selection_index[i] = sa_crs_recovery_equation_group_index[i][symbol_id];
+	}
+}
+void ECRecoveryPlanner::init_crs_hybrid_parity_group_selection_best(int k,int m,int w, int* generator_matrix) {
+	sa_crs_hybrid_parity_group_selection_best = new int[m*w];
+	sa_crs_hybrid_parity_group_selection_best_index = new int[w];
+	for (int i = 0; i < m*w; ++i) {
+		sa_crs_hybrid_parity_group_selection_best[i] = sa_crs_hybrid_parity_group_selection[i];
+	}
+	for (int i = 0; i < w; ++i) {
+		sa_crs_hybrid_parity_group_selection_best_index[i] = sa_crs_hybrid_parity_group_selection_index[i];
+	}
+}
+void ECRecoveryPlanner::init_crs_hybrid_parity_group_selection_temporary(int k, int m, int w,  int *generator_matrix) {
+	sa_crs_hybrid_parity_group_selection_temporary = new int[m*w];
+	sa_crs_hybrid_parity_group_selection_temporary_index = new int[w];
+	for (int i = 0; i < m*w; i++) {
+		sa_crs_hybrid_parity_group_selection_temporary[i] = sa_crs_hybrid_parity_group_selection[i];
+	}
+	for (int i = 0; i < w; i++) {
+		sa_crs_hybrid_parity_group_selection_temporary_index[i] = sa_crs_hybrid_parity_group_selection_index[i];
+	}
+}
+void ECRecoveryPlanner::receive_replacement(int m,int w) {
+	for (int i = 0; i < m*w; i++) {
+		sa_crs_hybrid_parity_group_selection[i] = sa_crs_hybrid_parity_group_selection_temporary[i];
+	}
+	for (int i = 0; i < w; i++) {
+		sa_crs_hybrid_parity_group_selection_index[i] = sa_crs_hybrid_parity_group_selection_temporary_index[i];
+	}
+}
+void ECRecoveryPlanner::remember_best(int m, int w) {
+	for (int i = 0; i < m*w; ++i) {
+		sa_crs_hybrid_parity_group_selection_best[i] = sa_crs_hybrid_parity_group_selection_temporary[i];
+	}
+	for (int i = 0; i < w; ++i) {
+		sa_crs_hybrid_parity_group_selection_best_index[i] = sa_crs_hybrid_parity_group_selection_temporary_index[i];
+	}
+}
+bool ECRecoveryPlanner::judge_row_selected_temporary(int m, int w, int row) {
+	bool selected = false;
+	if (sa_crs_hybrid_parity_group_selection_temporary[row] == 1) {
+		selected = true;
+	}
+	return selected;
+}
+void ECRecoveryPlanner::sa_int2bin(int integer, int *binary, int array_len) {
+	int k = 0, n = 0;
+	int remain;
+	int *temp = new int[array_len];
+	do {
+		remain = integer % 2;
+		integer = integer / 2;
+		temp[k++] = remain;
+	} while (integer > 0);
+	while (k<array_len) {
+		temp[k++] = 0;
+	}
+	while (k > 0) {
+		binary[n++] = temp[--k];
+	}
+	delete[] temp;
+}
+bool ECRecoveryPlanner::sa_judge_in_failed_disk_selection(int k,int m,int w,int failed_disk_id,int* generator_matrix,int row, int* temporary_group_id) {
+	if (sa_crs_hybrid_parity_group_selection_temporary[row] == 1) {
+		return true;
+	}
+	int temporary_group_id_index = 0;
+	for (int s = 0; s < k*w; s++) {
+		if (s / w == failed_disk_id) {
+			if (generator_matrix[row*k*w + s] == 1) {
+				temporary_group_id[temporary_group_id_index] = s%w;
+				temporary_group_id_index++;
+			}
+		}
+	}
+	int group_id = temporary_group_id[rand_r(&seed) % temporary_group_id_index];
+	sa_crs_hybrid_parity_group_selection_temporary[sa_crs_hybrid_parity_group_selection_temporary_index[group_id]] = 0;
+	int search_scale = 0;
+	int source_num = 0;
+	for (int i = 0; i < m*w;i++) {
+		if (sa_crs_hybrid_parity_group_selection_temporary[i]==1) {
+			source_num++;
+		}
+	}
+	int* temp_array = new int[source_num];
+	int index = 0;
+	for (int i = 0; i < m*w;i++) {
+		if (sa_crs_hybrid_parity_group_selection_temporary[i]==1) {
+			temp_array[index++] = i;
+		}
+	}
+	search_scale = 1 << source_num;
+	int* binaryArray = new int[source_num];
+	int* temp_sum = new int[w];
+	bool combination_found = false;
+	for (int i = 0; i < search_scale && !combination_found; i++) {
+		memset(temp_sum, 0, sizeof(int)*w);
+		sa_int2bin(i, binaryArray, source_num);
+		for (int j = 0; j<source_num; j++) {
+			if (binaryArray[j] == 1) {
+				for (int t = 0; t<w; t++) {
+					if (generator_matrix[temp_array[j] * k*w + failed_disk_id*w + t] == temp_sum[t]) {
+						temp_sum[t] = 0;
+					}
+					else {
+						temp_sum[t] = 1;
+					}
+				}
+			}
+		}
+		int t = 0;
+		for (t = 0; t<w; t++) {
+			if (temp_sum[t] != generator_matrix[row*k*w + failed_disk_id*w + t]) {
+				break;
+			}
+		}
+		if (t == w) {
+			combination_found = true;
+		}
+	}
+	delete[] temp_array;
+	delete[] temp_sum;
+	delete[] binaryArray;
+	sa_crs_hybrid_parity_group_selection_temporary[sa_crs_hybrid_parity_group_selection_temporary_index[group_id]] = 1;
+	return combination_found;
+}
+void ECRecoveryPlanner::sa_search_recovery_solution(int k,int m,int w,int failed_disk_id,int *generator_matrix) {
+	double K = 0.97, T= k*m*m*w*w, M = k*m*m*w*w, L = k*m*m*w*w;
+	double ini = M;
+	double remain_times = ini;
+	double random_probability = 0;
+	int all_profit = 0;
+	int all_profit_new = 0;
+	int all_profit_best = 0;
+	int* temporary_group_id = new int[w];
+	int all_profit_difference = 0;
+	while(remain_times > 0 && T > 0.001) {
+		for (int l = 0; l < L; l++) {
+			int symbol_id = rand_r(&seed) % (m*w);
+			while (sa_judge_in_failed_disk_selection(k, m, w, failed_disk_id, generator_matrix, symbol_id, temporary_group_id)) {
+				symbol_id = rand_r(&seed) % (m*w);
+			}
+			int temporary_group_id_index = 0;
+			for (int s = 0; s < k*w; s++) {
+				if (s / w == failed_disk_id) {
+					if (generator_matrix[symbol_id*k*w + s] == 1) {
+						temporary_group_id[temporary_group_id_index] = s%w;
+						temporary_group_id_index++;
+					}
+				}
+			}
+			int group_id = temporary_group_id[rand_r(&seed) % temporary_group_id_index];
+			all_profit = calculate_all_profit(k, m, w, failed_disk_id, generator_matrix,sa_crs_hybrid_parity_group_selection_temporary);
+			all_profit_best = calculate_all_profit(k, m, w, failed_disk_id, generator_matrix, sa_crs_hybrid_parity_group_selection_best);
+			
+			sa_crs_hybrid_parity_group_selection_temporary[sa_crs_hybrid_parity_group_selection_temporary_index[group_id]] = 0;
+			sa_crs_hybrid_parity_group_selection_temporary[symbol_id] = 1;
+			sa_crs_hybrid_parity_group_selection_temporary_index[group_id] = symbol_id;
+
+			all_profit_new = calculate_all_profit(k, m, w, failed_disk_id, generator_matrix, sa_crs_hybrid_parity_group_selection_temporary);
+			all_profit_difference = all_profit - all_profit_new;//The difference between the amount of data before replacement and the amount of data after replacement
+			if (all_profit_difference > 0) {
+				receive_replacement(m, w);
+				if (all_profit_best > all_profit_new) {
+					remember_best(m,w);
+				}
+			}
+			else {
+				random_probability = (double)(rand_r(&seed) / (double)RAND_MAX);
+				if (exp(all_profit_difference / T)>random_probability) {
+					receive_replacement(m, w);
+					T = K*T;
+				}
+				else {
+					remain_times--;
+					sa_crs_hybrid_parity_group_selection_temporary[symbol_id] = 0;
+					sa_crs_hybrid_parity_group_selection_temporary[sa_crs_hybrid_parity_group_selection_index[group_id]] = 1;
+					sa_crs_hybrid_parity_group_selection_temporary_index[group_id] = sa_crs_hybrid_parity_group_selection_index[group_id];
+				}
+			}
+		}
+	}
+	delete[] temporary_group_id;
+	delete[] sa_crs_hybrid_parity_group_selection_temporary;
+	delete[] sa_crs_hybrid_parity_group_selection_temporary_index;
+	delete[] sa_crs_hybrid_parity_group_selection;
+	delete[] sa_crs_hybrid_parity_group_selection_index;
+	delete[] sa_crs_hybrid_parity_group_selection_best_index;
+}
+int* ECRecoveryPlanner::sa_crs_hybrid_recovery_solution(int k, int m, int w, int failed_disk_id, int *generator_matrix) {
+	seed = (unsigned)time(NULL);
+	init_crs_recovery_equation_group(k,m,w,failed_disk_id,generator_matrix);
+	init_crs_hybrid_parity_group_selection(k, m, w, failed_disk_id,generator_matrix);
+	init_crs_hybrid_parity_group_selection_best(k,m,w,generator_matrix);
+	init_crs_hybrid_parity_group_selection_temporary(k, m, w,  generator_matrix);
+	sa_search_recovery_solution(k,m,w,failed_disk_id,generator_matrix);
+	return sa_crs_hybrid_parity_group_selection_best;
+}
@@ -0,0 +1,100 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef ECRECOVERYPLANNER_H
+#define ECRECOVERYPLANNER_H
+
+#include <map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * ECRecoveryPlanner
+ *
+ * Searches for the w parity rows of an (m*w) x (k*w) bitmatrix that
+ * rebuild one failed data shard while reading the fewest symbols from
+ * the other shards.  The climb search tries every coding shard as a
+ * starting point and swaps rows while that saves symbols; the SA search
+ * anneals over random row swaps.  Both return an m*w selection, 1 for
+ * a selected row, allocated with new[] and owned by the caller.
+ *
+ * An instance keeps the state of one search: use one per thread.  It
+ * does not depend on the OSD, see tools/ceph_erasure_code_recovery_sim.
+ */
+class ECRecoveryPlanner {
+public:
+  ECRecoveryPlanner() {}
+  ~ECRecoveryPlanner();
+  ECRecoveryPlanner(const ECRecoveryPlanner &) = delete;
+  ECRecoveryPlanner &operator=(const ECRecoveryPlanner &) = delete;
+
+  int* crs_hybrid_recovery_solution(int k, int m, int w, int failed_disk_id,int *generator_matrix);
+  int* sa_crs_hybrid_recovery_solution(int k, int m, int w, int failed_disk_id, int *generator_matrix);
+  /// symbols to read from every shard for a selection, by shard
+  static void get_recovery_solution(int k, int m, int w, int failed_disk_id, int* generator_matrix,int* crs_parity_group_selection, map<int, vector<int> >& crs_solution);
+
+private:
+  //add by LYF
+  int* crs_hybrid_parity_group_selection = nullptr;
+  int* crs_final_recovery_parity_vector = nullptr;
+  int* rows_intersection_infor = nullptr;
+  int crs_hybrid_profit = 0;
+  int crs_final_hybrid_profit = 0;
+
+  void construct_rows_intersection_infor_matrix(int m, int k, int w, int failed_disk_id, int *generator_matrix);
+  int different_failed_blocks(int m, int k, int w, int failed_disk_id, int param_row1, int param_row2, int *generator_matrix);
+  int count_rows_intersections_num(int m, int k, int w, int failed_disk_id, int param_row1, int param_row2, int *generator_matrix);
+  int calculate_blocks_savings( int m, int k, int w, int failed_disk_id, int *generator_matrix, int *crs_parity_group_selection);
+  int crs_better_recovery_exist(int m, int k, int w, int failed_disk_id, int* candidate_replace_parity_groups, int *generator_matrix);
+  int not_in_failed_disk_selection(int m, int k, int w, int failed_disk_id, int *generator_matrix,int row);
+  void int2bin(int integer, int *binary, int array_len);
+  int judge_the_better_candidate(int m, int w, int failed_disk_id, int candidate_one, int candidate_two);
+  void crs_adjust_recovery_vector(int m, int k, int w, int failed_disk_id, int fixed_parity_disk, int star_parity_disk, int *generator_matrix);
+  void crs_adjust_recovery_vector_in_adjustment(int m, int k, int w, int failed_disk_id, int fixed_parity_node, int star_parity_node, int pre_fixed_parity_node, int *generator_matrix);
+  void crs_store_selection_to_final(int m, int w);
+
+  //add by LYF
+  int* sa_crs_hybrid_parity_group_selection = nullptr;
+  int* sa_crs_hybrid_parity_group_selection_index = nullptr;
+  int* sa_crs_hybrid_parity_group_selection_best = nullptr;
+  int* sa_crs_hybrid_parity_group_selection_best_index = nullptr;
+  int* sa_crs_hybrid_parity_group_selection_temporary = nullptr;
+  int* sa_crs_hybrid_parity_group_selection_temporary_index = nullptr;
+
+  int sa_crs_recovery_equation_groups = 0;
+  int** sa_crs_recovery_equation_group = nullptr;
+  int** sa_crs_recovery_equation_group_index = nullptr;
+  int* sa_crs_recovery_equation_group_index_number = nullptr;
+
+  int sa_crs_hybrid_profit = 0;
+  /// rand_r state of the search, seeded once per search: srand would
+  /// reseed every other user of rand() in the process
+  unsigned int seed = 0;
+
+  void init_crs_recovery_equation_group(int k,int m ,int w,int failed_disk_id,int *generator_matrix);
+  void free_crs_recovery_equation_group();
+  int calculate_row_profit(int k, int w, int row, int faild_disk_id,int *generator_matrix);
+  int calculate_all_profit(int k,int m,int w,int faild_disk_id,int *generator_matrix,int *sa_crs_hybrid_parity_group_selection);
+  bool judge_row_selected(int m,int w, int row);
+  void init_crs_hybrid_parity_group_selection(int k, int m, int w, int faild_disk_id, int *generator_matrix);
+  void init_crs_hybrid_parity_group_selection_best(int k,int m,int w, int* generator_matrix);
+  void init_crs_hybrid_parity_group_selection_temporary(int k, int m, int w,  int *generator_matrix);
+  void receive_replacement(int m,int w);
+  void remember_best(int m, int w);
+  bool judge_row_selected_temporary(int m, int w, int row);
+  void sa_int2bin(int integer, int *binary, int array_len);
+  bool sa_judge_in_failed_disk_selection(int k,int m,int w,int failed_disk_id,int* generator_matrix,int row, int* temporary_group_id);
+  void sa_search_recovery_solution(int k,int m,int w,int failed_disk_id,int *generator_matrix);
+};
+
+#endif
@@ -1,6 +1,7 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 
 #include <errno.h>
+#include <string.h>
 #include "include/encoding.h"
 #include "ECUtil.h"
 
@@ -152,6 +153,366 @@ int ECUtil::decode_for_xor(
   return 0;
 }
 
+unsigned ECUtil::xor_aggregation_plan_t::shard_t::packets_per_row() const
+{
+  return aggregated ? combinations.size() : __builtin_popcountll(mask);
+}
+
+void ECUtil::xor_aggregation_plan_t::dump(Formatter *f) const
+{
+  f->dump_int("failed", failed);
+  f->open_array_section("equations");
+  for (auto e : equations)
+    f->dump_int("row", e);
+  f->close_section();
+  f->open_array_section("shards");
+  for (auto &p : shards) {
+    f->open_object_section("shard");
+    f->dump_int("shard", p.first);
+    f->dump_format("mask", "0x%llx", (unsigned long long)p.second.mask);
+    f->dump_bool("aggregated", p.second.aggregated);
+    f->dump_unsigned("packets_per_row", p.second.packets_per_row());
+    f->close_section();
+  }
+  f->close_section();
+}
+
+bool ECUtil::build_xor_aggregation_plan(
+  int k, int m, int w,
+  const int *bitmatrix,
+  int failed,
+  const int *parity_group_selection,
+  xor_aggregation_plan_t *plan)
+{
+  assert(plan);
+  *plan = xor_aggregation_plan_t();
+  if (!bitmatrix || !parity_group_selection ||
+      w <= 0 || w > 64 || failed < 0 || failed >= k)
+    return false;
+
+  const int cols = k * w;
+  vector<int> equations;
+  for (int r = 0; r < m * w; ++r) {
+    if (parity_group_selection[r] == 1)
+      equations.push_back(r);
+  }
+  if ((int)equations.size() != w)
+    return false;
+
+  // invert A[e][j] = B[equations[e]][failed * w + j] over GF(2); rows of
+  // a are masks over the unknowns, rows of inv masks over the equations
+  vector<uint64_t> a(w, 0), inv(w, 0);
+  for (int e = 0; e < w; ++e) {
+    for (int j = 0; j < w; ++j) {
+      if (bitmatrix[equations[e] * cols + failed * w + j])
+	a[e] |= 1ull << j;
+    }
+    inv[e] = 1ull << e;
+  }
+  for (int col = 0; col < w; ++col) {
+    int pivot = col;
+    while (pivot < w && !(a[pivot] & (1ull << col)))
+      ++pivot;
+    if (pivot == w)
+      return false;
+    std::swap(a[col], a[pivot]);
+    std::swap(inv[col], inv[pivot]);
+    for (int r = 0; r < w; ++r) {
+      if (r != col && (a[r] & (1ull << col))) {
+	a[r] ^= a[col];
+	inv[r] ^= inv[col];
+      }
+    }
+  }
+
+  plan->failed = failed;
+  plan->equations = equations;
+  plan->inverse = inv;
+
+  // surviving data shards: one partial parity per equation they feed,
+  // worth it only when that is fewer packets than the raw symbols
+  for (int d = 0; d < k; ++d) {
+    if (d == failed)
+      continue;
+    xor_aggregation_plan_t::shard_t shard;
+    for (int e = 0; e < w; ++e) {
+      uint64_t c = 0;
+      for (int j = 0; j < w; ++j) {
+	if (bitmatrix[equations[e] * cols + d * w + j])
+	  c |= 1ull << j;
+      }
+      if (!c)
+	continue;
+      shard.mask |= c;
+      shard.combinations.push_back(c);
+      shard.equations.push_back(e);
+    }
+    if (!shard.mask)
+      continue;
+    shard.aggregated =
+      shard.combinations.size() < (unsigned)__builtin_popcountll(shard.mask);
+    plan->shards[d] = shard;
+  }
+
+  // coding shards always ship the selected parity symbols themselves
+  for (int e = 0; e < w; ++e) {
+    xor_aggregation_plan_t::shard_t &shard = plan->shards[k + equations[e] / w];
+    uint64_t bit = 1ull << (equations[e] % w);
+    shard.mask |= bit;
+    shard.combinations.push_back(bit);
+    shard.equations.push_back(e);
+  }
+  return true;
+}
+
+static void region_xor(const char *src, char *dst, unsigned len)
+{
+  unsigned i = 0;
+  for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+    uint64_t a, b;
+    memcpy(&a, dst + i, sizeof(a));
+    memcpy(&b, src + i, sizeof(b));
+    a ^= b;
+    memcpy(dst + i, &a, sizeof(a));
+  }
+  for (; i < len; ++i)
+    dst[i] ^= src[i];
+}
+
+/// position of symbol bit among the symbols of mask
+static unsigned symbol_rank(uint64_t mask, int bit)
+{
+  return __builtin_popcountll(mask & ((1ull << bit) - 1));
+}
+
+bool ECUtil::replan_parity_group_selection(
+  int k, int m, int w,
+  const int *bitmatrix,
+  int failed,
+  const set<int> &excluded,
+  const int *previous,
+  vector<int> *selection)
+{
+  assert(selection);
+  if (!bitmatrix || !previous || w <= 0 || w > 64 || failed < 0 || failed >= k)
+    return false;
+  // a second data shard down adds unknowns the selection does not
+  // cancel, that is a job for a full decode
+  if (!excluded.empty() && *excluded.begin() < k)
+    return false;
+
+  const int cols = k * w;
+  // symbols a row reads besides the failed ones: data symbols then its
+  // own parity symbol
+  auto row_symbols = [&](int r, vector<bool> *out) {
+    for (int c = 0; c < cols; ++c) {
+      if (c / w != failed && bitmatrix[r * cols + c])
+	(*out)[c] = true;
+    }
+    (*out)[cols + r] = true;
+  };
+  auto usable = [&](int r) {
+    return !excluded.count(k + r / w);
+  };
+
+  vector<bool> have(cols + m * w, false);
+  for (int r = 0; r < m * w; ++r) {
+    if (previous[r] == 1 && usable(r))
+      row_symbols(r, &have);
+  }
+
+  // reduced basis over the failed shard's columns, indexed by pivot bit
+  vector<uint64_t> basis(w, 0);
+  auto reduce = [&](uint64_t v) {
+    for (int b = w - 1; b >= 0; --b) {
+      if ((v & (1ull << b)) && basis[b])
+	v ^= basis[b];
+    }
+    return v;
+  };
+  auto insert = [&](uint64_t v) {
+    v = reduce(v);
+    if (!v)
+      return false;
+    basis[63 - __builtin_clzll(v)] = v;
+    return true;
+  };
+  auto failed_bits = [&](int r) {
+    uint64_t v = 0;
+    for (int j = 0; j < w; ++j) {
+      if (bitmatrix[r * cols + failed * w + j])
+	v |= 1ull << j;
+    }
+    return v;
+  };
+
+  selection->assign(m * w, 0);
+  int rank = 0;
+  for (int r = 0; r < m * w; ++r) {
+    if (previous[r] == 1 && usable(r) && insert(failed_bits(r))) {
+      (*selection)[r] = 1;
+      ++rank;
+    }
+  }
+  vector<bool> reading(have);
+  while (rank < w) {
+    int best = -1, best_cost = 0;
+    for (int r = 0; r < m * w; ++r) {
+      if ((*selection)[r] || !usable(r) || !reduce(failed_bits(r)))
+	continue;
+      vector<bool> symbols(cols + m * w, false);
+      row_symbols(r, &symbols);
+      int cost = 0;
+      for (size_t s = 0; s < symbols.size(); ++s) {
+	if (symbols[s] && !reading[s])
+	  ++cost;
+      }
+      if (best < 0 || cost < best_cost) {
+	best = r;
+	best_cost = cost;
+      }
+    }
+    if (best < 0)
+      return false;
+    insert(failed_bits(best));
+    (*selection)[best] = 1;
+    row_symbols(best, &reading);
+    ++rank;
+  }
+  return true;
+}
+
+void ECUtil::merge_symbols(
+  bufferlist &a, uint64_t a_mask,
+  bufferlist &b, uint64_t b_mask,
+  uint64_t want,
+  int packet_size,
+  bufferlist *out)
+{
+  assert(out);
+  unsigned a_row = __builtin_popcountll(a_mask) * packet_size;
+  unsigned b_row = __builtin_popcountll(b_mask) * packet_size;
+  unsigned rows = a_row ? a.length() / a_row : b.length() / b_row;
+  assert(!a_row || a.length() == rows * a_row);
+  assert(!b_row || b.length() == rows * b_row);
+
+  for (unsigned row = 0; row < rows; ++row) {
+    for (int bit = 0; bit < 64 && (want >> bit); ++bit) {
+      if (!(want & (1ull << bit)))
+	continue;
+      bufferlist symbol;
+      if (a_mask & (1ull << bit)) {
+	symbol.substr_of(a, row * a_row + symbol_rank(a_mask, bit) * packet_size,
+			 packet_size);
+      } else {
+	assert(b_mask & (1ull << bit));
+	symbol.substr_of(b, row * b_row + symbol_rank(b_mask, bit) * packet_size,
+			 packet_size);
+      }
+      out->claim_append(symbol);
+    }
+  }
+}
+
+void ECUtil::xor_combine(
+  const bufferlist &symbols,
+  uint64_t mask,
+  const vector<uint64_t> &combinations,
+  int packet_size,
+  bufferlist *out)
+{
+  assert(out);
+  unsigned in_row = __builtin_popcountll(mask) * packet_size;
+  unsigned out_row = combinations.size() * packet_size;
+  if (!in_row || !out_row || !symbols.length())
+    return;
+  assert(symbols.length() % in_row == 0);
+  unsigned rows = symbols.length() / in_row;
+
+  bufferlist in(symbols);
+  const char *base = in.c_str();
+  bufferptr bp = buffer::create_page_aligned(rows * out_row);
+  bp.zero();
+  for (unsigned row = 0; row < rows; ++row) {
+    const char *src = base + row * in_row;
+    char *dst = bp.c_str() + row * out_row;
+    for (auto c : combinations) {
+      for (int bit = 0; bit < 64 && (c >> bit); ++bit) {
+	if (c & (1ull << bit))
+	  region_xor(src + symbol_rank(mask, bit) * packet_size, dst,
+		     packet_size);
+      }
+      dst += packet_size;
+    }
+  }
+  out->push_back(std::move(bp));
+}
+
+int ECUtil::decode_xor_aggregation(
+  const xor_aggregation_plan_t &plan,
+  int w,
+  int packet_size,
+  map<int, bufferlist> &to_decode,
+  bufferlist *out)
+{
+  assert(out);
+  assert(!plan.empty());
+  assert((int)plan.inverse.size() == w);
+
+  unsigned rows = 0;
+  map<int, const char*> data;
+  for (auto &p : plan.shards) {
+    auto i = to_decode.find(p.first);
+    if (i == to_decode.end())
+      return -EIO;
+    unsigned row_len = p.second.packets_per_row() * packet_size;
+    if (i->second.length() % row_len)
+      return -EIO;
+    unsigned r = i->second.length() / row_len;
+    if (data.empty())
+      rows = r;
+    else if (r != rows)
+      return -EIO;
+    data[p.first] = i->second.c_str();
+  }
+  if (rows == 0)
+    return 0;
+
+  bufferptr rhs(w * packet_size);
+  bufferptr bp = buffer::create_page_aligned(rows * w * packet_size);
+  bp.zero();
+  for (unsigned row = 0; row < rows; ++row) {
+    rhs.zero();
+    for (auto &p : plan.shards) {
+      const xor_aggregation_plan_t::shard_t &shard = p.second;
+      const char *src = data[p.first] +
+	row * shard.packets_per_row() * packet_size;
+      for (unsigned ci = 0; ci < shard.combinations.size(); ++ci) {
+	char *dst = rhs.c_str() + shard.equations[ci] * packet_size;
+	if (shard.aggregated) {
+	  region_xor(src + ci * packet_size, dst, packet_size);
+	  continue;
+	}
+	uint64_t c = shard.combinations[ci];
+	for (int bit = 0; bit < 64 && (c >> bit); ++bit) {
+	  if (c & (1ull << bit))
+	    region_xor(src + symbol_rank(shard.mask, bit) * packet_size, dst,
+		       packet_size);
+	}
+      }
+    }
+    char *dst = bp.c_str() + row * w * packet_size;
+    for (int j = 0; j < w; ++j, dst += packet_size) {
+      for (int e = 0; e < w; ++e) {
+	if (plan.inverse[j] & (1ull << e))
+	  region_xor(rhs.c_str() + e * packet_size, dst, packet_size);
+      }
+    }
+  }
+  out->push_back(std::move(bp));
+  return 0;
+}
+
 int ECUtil::encode(
   const stripe_info_t &sinfo,
   ErasureCodeInterfaceRef &ec_impl,
@@ -109,6 +109,78 @@ int decode_for_xor(
   int packet_size,
   int* parity_group_selection);//add by LYF
 
+/**
+ * Helper-side XOR aggregation for rebuilding a single data shard.
+ *
+ * Every selected parity equation e reads p_e = sum_c B[e][c] x_c.  A
+ * helper holding data shard d can ship the partial parity
+ * sum_j B[e][d*w+j] x_{d,j} instead of the raw symbols it contributes,
+ * and the primary only has to combine the partials per equation and
+ * multiply by the inverse of the failed shard's w x w sub-bitmatrix.
+ */
+struct xor_aggregation_plan_t {
+  struct shard_t {
+    uint64_t mask = 0;              ///< union of the symbols used
+    vector<uint64_t> combinations;  ///< symbols XORed into each output
+    vector<int> equations;          ///< equation index fed by each output
+    bool aggregated = false;        ///< helper XORs, or ships raw symbols
+    unsigned packets_per_row() const;
+  };
+  int failed = -1;
+  vector<int> equations;            ///< selected bitmatrix rows
+  vector<uint64_t> inverse;         ///< row j: equations summed into x_j
+  map<int, shard_t> shards;
+  bool empty() const { return shards.empty(); }
+  void dump(Formatter *f) const;
+};
+
+/// returns false if the selection cannot be decoded this way
+bool build_xor_aggregation_plan(
+  int k, int m, int w,
+  const int *bitmatrix,
+  int failed,
+  const int *parity_group_selection,
+  xor_aggregation_plan_t *plan);
+
+/**
+ * Pick w parity rows for rebuilding shard failed without the coding
+ * shards in excluded.  Rows of previous on surviving shards are kept,
+ * the rest are added greedily by the fewest symbols not already read
+ * for previous.  Returns false if no decodable selection remains.
+ */
+bool replan_parity_group_selection(
+  int k, int m, int w,
+  const int *bitmatrix,
+  int failed,
+  const set<int> &excluded,
+  const int *previous,
+  vector<int> *selection);
+
+/// interleave two symbol reads of one shard into the symbols of want,
+/// row by row; every symbol of want must be in a_mask or b_mask
+void merge_symbols(
+  bufferlist &a, uint64_t a_mask,
+  bufferlist &b, uint64_t b_mask,
+  uint64_t want,
+  int packet_size,
+  bufferlist *out);
+
+/// XOR the symbols selected by each combination, row by row; symbols
+/// holds the symbols of mask in ascending order for every packet row
+void xor_combine(
+  const bufferlist &symbols,
+  uint64_t mask,
+  const vector<uint64_t> &combinations,
+  int packet_size,
+  bufferlist *out);
+
+int decode_xor_aggregation(
+  const xor_aggregation_plan_t &plan,
+  int w,
+  int packet_size,
+  map<int, bufferlist> &to_decode,
+  bufferlist *out);
+
 int encode(
   const stripe_info_t &sinfo,
   ErasureCodeInterfaceRef &ec_impl,
@@ -0,0 +1,116 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "gtest/gtest.h"
+#include "erasure-code/isa/xor_op.h"
+
+typedef void (*xor_fn_t)(char **src, char *parity, int src_size,
+			 unsigned size, bool stream);
+
+static const int max_sources = 20;
+static const unsigned max_size = 20000;
+static const int guard = 64;
+
+static void call_region_xor(char **src, char *parity, int src_size,
+			    unsigned size, bool stream)
+{
+  region_xor((unsigned char **)src, (unsigned char *)parity, src_size, size,
+	     stream);
+}
+
+// compare xor with a bytewise xor of the sources: unaligned sources
+// and parity, sizes around the vector, pass block and streaming
+// thresholds, parity accumulated into as the jerasure kernels do
+static void check_xor(xor_fn_t xor_fn, const char *name)
+{
+  std::vector<unsigned> sizes;
+  for (unsigned size = 0; size <= 300; size++)
+    sizes.push_back(size);
+  const unsigned thresholds[] = { EC_ISA_STREAM_MIN_SIZE,
+				  EC_ISA_XOR_BLOCK_SIZE, 8192 };
+  for (unsigned t : thresholds)
+    for (unsigned size = t - 65; size <= t + 65; size += 13)
+      sizes.push_back(size);
+  sizes.push_back(max_size - 1);
+
+  char *pool = NULL;
+  ASSERT_EQ(0, posix_memalign((void **)&pool, 64,
+			      max_sources * (max_size + 128)));
+  char *out = NULL;
+  ASSERT_EQ(0, posix_memalign((void **)&out, 64, max_size + 128 + 2 * guard));
+  std::vector<char> expected(max_size);
+  unsigned seed = 1;
+  for (unsigned size : sizes) {
+    seed = seed * 1103515245 + 12345;
+    int n = 1 + (seed >> 16) % max_sources;
+    bool stream = (seed >> 8) & 1;
+    bool accumulate = n > 1 && ((seed >> 9) & 3) == 0;
+    char *parity = out + guard + (seed >> 11) % 64;
+    char *src[max_sources];
+    for (int i = 0; i < n; i++) {
+      src[i] = pool + i * (max_size + 128) + (seed >> (i % 16)) % 64;
+      for (unsigned j = 0; j < size; j++)
+	src[i][j] = (seed + i * 7919 + j) * 2654435761u >> 24;
+    }
+    memset(out, 0x5a, max_size + 128 + 2 * guard);
+    if (accumulate) {
+      for (unsigned j = 0; j < size; j++)
+	parity[j] = (seed + j) * 40503u >> 8;
+      src[0] = parity;
+    }
+    for (unsigned j = 0; j < size; j++) {
+      char x = 0;
+      for (int i = 0; i < n; i++)
+	x ^= src[i][j];
+      expected[j] = x;
+    }
+    xor_fn(src, parity, n, size, stream);
+    EXPECT_EQ(0, memcmp(&expected[0], parity, size))
+      << name << " sources=" << n << " size=" << size
+      << " parity offset=" << (parity - out - guard)
+      << " stream=" << stream << " accumulate=" << accumulate;
+    for (char *p = out; p < parity; p++)
+      ASSERT_EQ((char)0x5a, *p) << name << " wrote before parity";
+    for (char *p = parity + size; p < out + max_size + 128 + 2 * guard; p++)
+      ASSERT_EQ((char)0x5a, *p) << name << " wrote past parity size=" << size;
+  }
+  free(out);
+  free(pool);
+}
+
+TEST(IsaXor, region_xor)
+{
+  check_xor(call_region_xor, "region_xor");
+}
+
+#ifdef EC_ISA_VECTOR_AVX
+TEST(IsaXor, region_avx2_xor)
+{
+  if (!__builtin_cpu_supports("avx2")) {
+    std::cout << "SKIP: no AVX2" << std::endl;
+    return;
+  }
+  check_xor(region_avx2_xor, "region_avx2_xor");
+}
+
+TEST(IsaXor, region_avx512_xor)
+{
+  if (!__builtin_cpu_supports("avx512f")) {
+    std::cout << "SKIP: no AVX-512" << std::endl;
+    return;
+  }
+  check_xor(region_avx512_xor, "region_avx512_xor");
+}
+#endif
@@ -0,0 +1,101 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <errno.h>
+#include <string.h>
+#include "gtest/gtest.h"
+#include "erasure-code/jerasure/ErasureCodeJerasure.h"
+
+static ErasureCodeProfile cauchy_good_profile()
+{
+  ErasureCodeProfile profile;
+  profile["k"] = "4";
+  profile["m"] = "2";
+  profile["w"] = "8";
+  profile["jerasure-cauchy-search"] = "true";
+  return profile;
+}
+
+TEST(ErasureCodeJerasureCauchyGood, search_writes_points)
+{
+  ostringstream ss;
+  ErasureCodeProfile profile = cauchy_good_profile();
+  ErasureCodeJerasureCauchyGood created;
+  ASSERT_EQ(0, created.init(profile, &ss)) << ss.str();
+  ASSERT_TRUE(profile.count("jerasure-cauchy-points"));
+  ErasureCodeJerasureCauchySearch::result_ref searched =
+    ErasureCodeJerasureCauchySearch::search(4, 2, 8);
+  EXPECT_EQ(ErasureCodeJerasureCauchySearch::format_points(2, searched->points),
+	    profile["jerasure-cauchy-points"]);
+  EXPECT_EQ(searched->points, created.points);
+
+  // the OSDs rebuild the same matrix from the profile
+  ErasureCodeProfile osd_profile = created.get_profile();
+  ErasureCodeJerasureCauchyGood rebuilt;
+  ASSERT_EQ(0, rebuilt.init(osd_profile, &ss)) << ss.str();
+  EXPECT_EQ(created.get_profile(), rebuilt.get_profile());
+  EXPECT_EQ(created.points, rebuilt.points);
+  EXPECT_EQ(0, memcmp(created.bitmatrix, rebuilt.bitmatrix,
+		      4 * 2 * 8 * 8 * sizeof(int)));
+}
+
+TEST(ErasureCodeJerasureCauchyGood, points_from_profile)
+{
+  ostringstream ss;
+  ErasureCodeProfile profile = cauchy_good_profile();
+  profile["jerasure-cauchy-points"] = "0,5/1,2,3,4";
+  ErasureCodeJerasureCauchyGood given;
+  ASSERT_EQ(0, given.init(profile, &ss)) << ss.str();
+  EXPECT_EQ(std::vector<int>({ 0, 5, 1, 2, 3, 4 }), given.points);
+  // not searched, hence no cost written
+  EXPECT_FALSE(profile.count("jerasure-encode-xors"));
+
+  profile["jerasure-cauchy-points"] = "cauchy_good";
+  ErasureCodeJerasureCauchyGood kept;
+  ASSERT_EQ(0, kept.init(profile, &ss)) << ss.str();
+  EXPECT_TRUE(kept.points.empty());
+
+  profile["jerasure-cauchy-points"] = "0,5/1,2,3";
+  ErasureCodeJerasureCauchyGood invalid;
+  EXPECT_EQ(-EINVAL, invalid.init(profile, &ss));
+}
+
+TEST(ErasureCodeJerasureCauchyGood, packetsize_autotune)
+{
+  ostringstream ss;
+  ErasureCodeProfile profile;
+  profile["k"] = "4";
+  profile["m"] = "2";
+  profile["w"] = "8";
+  profile["jerasure-packetsize-autotune"] = "true";
+
+  // an OSD does not tune on its own hardware, it uses the default
+  {
+    ErasureCodeProfile osd_profile = profile;
+    ErasureCodeJerasureCauchyGood osd;
+    EXPECT_EQ(0, osd.init(osd_profile, &ss));
+    EXPECT_EQ(atoi(DEFAULT_PACKETSIZE), osd.packetsize);
+  }
+
+  // where the profile is created the packetsize is written in it
+  ErasureCodeJerasureCauchyGood created;
+  created.creates_profile = true;
+  ASSERT_EQ(0, created.init(profile, &ss)) << ss.str();
+  ASSERT_TRUE(profile.count("packetsize"));
+  EXPECT_EQ(std::to_string(created.packetsize), profile["packetsize"]);
+
+  // and the OSDs read it back
+  ErasureCodeProfile osd_profile = created.get_profile();
+  ErasureCodeJerasureCauchyGood osd;
+  ASSERT_EQ(0, osd.init(osd_profile, &ss)) << ss.str();
+  EXPECT_EQ(created.packetsize, osd.packetsize);
+}
@@ -0,0 +1,122 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <errno.h>
+#include <sstream>
+#include "gtest/gtest.h"
+#include "erasure-code/jerasure/ErasureCodeJerasureCauchySearch.h"
+extern "C" {
+#include "jerasure.h"
+}
+
+typedef ErasureCodeJerasureCauchySearch Search;
+
+// every pattern of m erased chunks decodes
+static bool is_mds(int k, int m, int w, const std::vector<int> &matrix)
+{
+  std::vector<int> copy(matrix);
+  int *bitmatrix = jerasure_matrix_to_bitmatrix(k, m, w, &copy[0]);
+  bool mds = true;
+  std::vector<int> erased(m);
+  for (int i = 0; i < m; i++)
+    erased[i] = i;
+  do {
+    std::vector<int> erasures(erased);
+    erasures.push_back(-1);
+    int **schedule = jerasure_generate_decoding_schedule(k, m, w, bitmatrix,
+							 &erasures[0], 1);
+    if (!schedule)
+      mds = false;
+    else
+      jerasure_free_schedule(schedule);
+    int i = m - 1;
+    while (i >= 0 && erased[i] == k + i)
+      i--;
+    if (i < 0)
+      break;
+    erased[i]++;
+    for (int j = i + 1; j < m; j++)
+      erased[j] = erased[j - 1] + 1;
+  } while (mds);
+  free(bitmatrix);
+  return mds;
+}
+
+TEST(CauchySearch, points_rebuild_the_matrix)
+{
+  const int configs[][3] = { { 3, 2, 4 }, { 4, 2, 8 }, { 6, 3, 8 } };
+  for (const auto &c : configs) {
+    const int k = c[0], m = c[1], w = c[2];
+    Search::result_ref searched = Search::search(k, m, w);
+    ASSERT_TRUE(searched);
+    EXPECT_TRUE(is_mds(k, m, w, searched->matrix));
+    std::string value = Search::format_points(m, searched->points);
+    std::vector<int> points;
+    std::ostringstream ss;
+    ASSERT_EQ(0, Search::parse_points(k, m, w, value, &points, &ss)) << ss.str();
+    EXPECT_EQ(searched->points, points);
+    if (points.empty()) {
+      EXPECT_EQ("cauchy_good", value);
+      continue;
+    }
+    int *matrix = Search::points_matrix(k, m, w, points);
+    ASSERT_TRUE(matrix);
+    EXPECT_EQ(searched->matrix, std::vector<int>(matrix, matrix + k * m))
+      << "k=" << k << " m=" << m << " w=" << w << " " << value;
+    free(matrix);
+  }
+}
+
+TEST(CauchySearch, parse_points)
+{
+  std::vector<int> points;
+  std::ostringstream ss;
+  EXPECT_EQ(0, Search::parse_points(3, 2, 4, "0,5/1,2,3", &points, &ss));
+  EXPECT_EQ(std::vector<int>({ 0, 5, 1, 2, 3 }), points);
+  EXPECT_EQ("0,5/1,2,3", Search::format_points(2, points));
+  int *matrix = Search::points_matrix(3, 2, 4, points);
+  EXPECT_TRUE(is_mds(3, 2, 4, std::vector<int>(matrix, matrix + 6)));
+  free(matrix);
+
+  EXPECT_EQ(0, Search::parse_points(3, 2, 4, "cauchy_good", &points, &ss));
+  EXPECT_TRUE(points.empty());
+
+  const char *invalid[] = {
+    "",             // no points
+    "0,5,1,2,3",    // no Y
+    "0/5,1,2,3",    // one X for m=2
+    "0,5/1,2",      // two Y for k=3
+    "0,5/1,2,3,4",  // four Y for k=3
+    "0,5/1,5,3",    // 5 in X and Y
+    "0,5/1,1,3",    // 1 twice in Y
+    "0,16/1,2,3",   // not in GF(2^4)
+    "0,-5/1,2,3",
+    "0,5/1,2,3/4",
+    "0,5/1,2,3,",
+    "0,5/1,2,x",
+  };
+  for (const char *value : invalid) {
+    EXPECT_EQ(-EINVAL, Search::parse_points(3, 2, 4, value, &points, &ss))
+      << value;
+    EXPECT_TRUE(points.empty());
+  }
+}
+
+TEST(CauchySearch, parse_points_w32)
+{
+  std::vector<int> points;
+  std::ostringstream ss;
+  EXPECT_EQ(0, Search::parse_points(2, 2, 32, "0,4294967295/1,2", &points, &ss));
+  EXPECT_EQ("0,4294967295/1,2", Search::format_points(2, points));
+  EXPECT_EQ(-EINVAL, Search::parse_points(2, 2, 32, "0,4294967296/1,2",
+					  &points, &ss));
+}
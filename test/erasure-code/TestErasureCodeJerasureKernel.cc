@@ -0,0 +1,172 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "gtest/gtest.h"
+#include "erasure-code/jerasure/ErasureCodeJerasureKernel.h"
+extern "C" {
+#include "jerasure.h"
+#include "cauchy.h"
+#include "liberation.h"
+}
+
+// the flags each specialized schedule is run with, isa_xor is the same
+// as 0 when the isa plugin is not built
+static const int kernel_flags[] = {
+  0,
+  JERASURE_STREAM_OUTPUT,
+  ErasureCodeJerasureKernel::isa_xor,
+  ErasureCodeJerasureKernel::isa_xor | JERASURE_STREAM_OUTPUT,
+};
+
+static const int guard = 64;
+
+// chunks at offset bytes past a 64 bytes boundary, with guard bytes
+// on both sides
+struct chunks_t {
+  std::vector<char *> buffers;
+  std::vector<char *> chunks;
+  int size;
+
+  chunks_t(int n, int size, int offset) : size(size) {
+    for (int i = 0; i < n; i++) {
+      char *b = NULL;
+      EXPECT_EQ(0, posix_memalign((void **)&b, 64, size + offset + 2 * guard));
+      memset(b, 0xa5, size + offset + 2 * guard);
+      buffers.push_back(b);
+      chunks.push_back(b + guard + offset);
+    }
+  }
+  ~chunks_t() {
+    for (char *b : buffers)
+      free(b);
+  }
+  void fill(unsigned seed) {
+    for (unsigned i = 0; i < chunks.size(); i++)
+      for (int j = 0; j < size; j++)
+	chunks[i][j] = (seed + i * 7919 + j) * 2654435761u >> 24;
+  }
+  void copy(const chunks_t &from) {
+    for (unsigned i = 0; i < chunks.size(); i++)
+      memcpy(chunks[i], from.chunks[i], size);
+  }
+  bool guards_intact() const {
+    for (unsigned i = 0; i < chunks.size(); i++) {
+      for (int j = 1; j <= guard; j++)
+	if (chunks[i][-j] != (char)0xa5 || chunks[i][size + j - 1] != (char)0xa5)
+	  return false;
+    }
+    return true;
+  }
+};
+
+// the interpreted and the specialized flat schedule of schedule
+static void flatten(int **schedule, int packetsize,
+		    jerasure_flat_schedule **interpreted,
+		    jerasure_flat_schedule **specialized)
+{
+  *interpreted = jerasure_schedule_to_flat(schedule, packetsize);
+  *specialized = jerasure_schedule_to_flat(schedule, packetsize);
+  ASSERT_TRUE(*interpreted && *specialized);
+  ASSERT_EQ(NULL, (*interpreted)->kernel);
+  ErasureCodeJerasureKernel::specialize(*specialized);
+  ASSERT_TRUE((*specialized)->kernel);
+}
+
+static void check_bitmatrix(int k, int m, int w, int *bitmatrix)
+{
+  const int packetsizes[] = { 8, 24, 1032, 1040, 2048 };
+  const int offsets[] = { 0, 8, 24 };
+  int **encoding = jerasure_smart_bitmatrix_to_schedule(k, m, w, bitmatrix);
+  ASSERT_TRUE(encoding);
+  for (int packetsize : packetsizes) {
+    const int size = 3 * w * packetsize;
+    jerasure_flat_schedule *interpreted, *specialized;
+    flatten(encoding, packetsize, &interpreted, &specialized);
+    for (int offset : offsets) {
+      chunks_t data(k, size, offset);
+      data.fill(packetsize + offset);
+      chunks_t expected(m, size, offset);
+      jerasure_flat_schedule_encode(k, m, w, interpreted, &data.chunks[0],
+				    &expected.chunks[0], size, 0);
+      for (int flags : kernel_flags) {
+	chunks_t coding(m, size, offset);
+	jerasure_flat_schedule_encode(k, m, w, specialized, &data.chunks[0],
+				      &coding.chunks[0], size, flags);
+	for (int i = 0; i < m; i++)
+	  EXPECT_EQ(0, memcmp(expected.chunks[i], coding.chunks[i], size))
+	    << "encode k=" << k << " m=" << m << " w=" << w
+	    << " packetsize=" << packetsize << " offset=" << offset
+	    << " flags=" << flags << " coding chunk " << i;
+	EXPECT_TRUE(coding.guards_intact());
+
+	// lose a data chunk and, with m > 1, a coding chunk
+	for (int lost = 0; lost < k; lost++) {
+	  int erasures[3] = { lost, m > 1 ? k + (lost % m) : -1, -1 };
+	  int **decoding = jerasure_generate_decoding_schedule(
+	    k, m, w, bitmatrix, erasures, 1);
+	  ASSERT_TRUE(decoding);
+	  jerasure_flat_schedule *dinterpreted, *dspecialized;
+	  flatten(decoding, packetsize, &dinterpreted, &dspecialized);
+	  chunks_t ddata(k, size, offset), dcoding(m, size, offset);
+	  ddata.copy(data);
+	  dcoding.copy(expected);
+	  memset(ddata.chunks[lost], 0, size);
+	  if (erasures[1] >= 0)
+	    memset(dcoding.chunks[erasures[1] - k], 0, size);
+	  EXPECT_EQ(0, jerasure_flat_schedule_decode(
+		      k, m, w, dspecialized, erasures, &ddata.chunks[0],
+		      &dcoding.chunks[0], size, flags));
+	  for (int i = 0; i < k; i++)
+	    EXPECT_EQ(0, memcmp(data.chunks[i], ddata.chunks[i], size))
+	      << "decode k=" << k << " m=" << m << " w=" << w
+	      << " packetsize=" << packetsize << " offset=" << offset
+	      << " flags=" << flags << " lost " << lost << " data chunk " << i;
+	  for (int i = 0; i < m; i++)
+	    EXPECT_EQ(0, memcmp(expected.chunks[i], dcoding.chunks[i], size))
+	      << "decode coding chunk " << i;
+	  EXPECT_TRUE(ddata.guards_intact() && dcoding.guards_intact());
+	  jerasure_free_flat_schedule(dinterpreted);
+	  jerasure_free_flat_schedule(dspecialized);
+	  jerasure_free_schedule(decoding);
+	}
+      }
+    }
+    jerasure_free_flat_schedule(interpreted);
+    jerasure_free_flat_schedule(specialized);
+  }
+  jerasure_free_schedule(encoding);
+}
+
+TEST(ErasureCodeJerasureKernel, cauchy_good)
+{
+  const int configs[][3] = { { 4, 2, 8 }, { 6, 3, 8 }, { 3, 1, 4 },
+			     { 10, 4, 8 }, { 4, 2, 16 } };
+  for (const auto &c : configs) {
+    int *matrix = cauchy_good_general_coding_matrix(c[0], c[1], c[2]);
+    ASSERT_TRUE(matrix);
+    int *bitmatrix = jerasure_matrix_to_bitmatrix(c[0], c[1], c[2], matrix);
+    check_bitmatrix(c[0], c[1], c[2], bitmatrix);
+    free(bitmatrix);
+    free(matrix);
+  }
+}
+
+TEST(ErasureCodeJerasureKernel, liberation)
+{
+  int *bitmatrix = liberation_coding_bitmatrix(5, 7);
+  ASSERT_TRUE(bitmatrix);
+  check_bitmatrix(5, 2, 7, bitmatrix);
+  free(bitmatrix);
+}
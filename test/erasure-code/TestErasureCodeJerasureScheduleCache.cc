@@ -0,0 +1,195 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "gtest/gtest.h"
+#include "erasure-code/jerasure/ErasureCodeJerasureScheduleCache.h"
+extern "C" {
+#include "jerasure.h"
+#include "cauchy.h"
+}
+
+typedef ErasureCodeJerasureScheduleCache Cache;
+
+// a cauchy_good bitmatrix and the chunks it encodes
+struct code_t {
+  int k, m, w, packetsize, size;
+  int *bitmatrix;
+  std::vector<std::vector<char> > chunks;
+
+  code_t(int k, int m, int w, int packetsize)
+    : k(k), m(m), w(w), packetsize(packetsize), size(2 * w * packetsize) {
+    int *matrix = cauchy_good_general_coding_matrix(k, m, w);
+    bitmatrix = jerasure_matrix_to_bitmatrix(k, m, w, matrix);
+    free(matrix);
+    chunks.resize(k + m, std::vector<char>(size));
+    for (int i = 0; i < k; i++)
+      for (int j = 0; j < size; j++)
+	chunks[i][j] = (i * 7919 + j) * 2654435761u >> 24;
+    std::vector<char *> data, coding;
+    pointers(&chunks, &data, &coding);
+    jerasure_bitmatrix_encode(k, m, w, bitmatrix, &data[0], &coding[0],
+			      size, packetsize);
+  }
+  ~code_t() {
+    free(bitmatrix);
+  }
+  std::string profile() const {
+    return Cache::profile_key("cauchy_good", k, m, w, packetsize);
+  }
+  void pointers(std::vector<std::vector<char> > *from,
+		std::vector<char *> *data, std::vector<char *> *coding) const {
+    for (int i = 0; i < k + m; i++)
+      (i < k ? data : coding)->push_back(&(*from)[i][0]);
+  }
+  // a copy of the chunks with the -1 terminated erasures zeroed
+  std::vector<std::vector<char> > erase(const int *erasures) const {
+    std::vector<std::vector<char> > erased(chunks);
+    for (int i = 0; erasures[i] != -1; i++)
+      memset(&erased[erasures[i]][0], 0, size);
+    return erased;
+  }
+};
+
+TEST(ErasureCodeJerasureScheduleCache, decode_matches_lazy)
+{
+  const int configs[][3] = { { 6, 3, 8 }, { 10, 4, 8 }, { 4, 3, 4 } };
+  for (const auto &c : configs) {
+    code_t code(c[0], c[1], c[2], 16);
+    int k = code.k, m = code.m;
+    const std::vector<std::vector<int> > signatures = {
+      { 0 },
+      { k },
+      { 1, k + m - 1 },
+      { 0, 2 },
+      { k + 1, 1, k },
+      { k - 1, k, k + 2 },
+      { 0, 1, 2 },
+    };
+    Cache cache;
+    for (auto erased : signatures) {
+      erased.push_back(-1);
+      Cache::schedule_ref schedule = cache.get_decoding_schedule(
+	code.profile(), k, m, code.w, code.packetsize, code.bitmatrix,
+	&erased[0]);
+      ASSERT_TRUE(schedule);
+
+      std::vector<std::vector<char> > cached = code.erase(&erased[0]);
+      std::vector<char *> data, coding;
+      code.pointers(&cached, &data, &coding);
+      EXPECT_EQ(0, jerasure_flat_schedule_decode(k, m, code.w, schedule->get(),
+						 &erased[0], &data[0],
+						 &coding[0], code.size, 0));
+
+      std::vector<std::vector<char> > lazy = code.erase(&erased[0]);
+      data.clear();
+      coding.clear();
+      code.pointers(&lazy, &data, &coding);
+      EXPECT_EQ(0, jerasure_schedule_decode_lazy(k, m, code.w, code.bitmatrix,
+						 &erased[0], &data[0],
+						 &coding[0], code.size,
+						 code.packetsize, 1));
+
+      for (int i = 0; i < k + m; i++) {
+	EXPECT_TRUE(lazy[i] == code.chunks[i])
+	  << "k=" << k << " m=" << m << " lazy chunk " << i;
+	EXPECT_TRUE(cached[i] == lazy[i])
+	  << "k=" << k << " m=" << m << " cached chunk " << i;
+      }
+    }
+    EXPECT_EQ((int)signatures.size(),
+	      cache.get_decoding_schedule_cache_size(code.profile()));
+  }
+}
+
+TEST(ErasureCodeJerasureScheduleCache, erasure_order)
+{
+  code_t code(6, 3, 8, 16);
+  Cache cache;
+  int erasures[] = { 7, 2, 0, -1 };
+  Cache::schedule_ref first = cache.get_decoding_schedule(
+    code.profile(), code.k, code.m, code.w, code.packetsize, code.bitmatrix,
+    erasures);
+  ASSERT_TRUE(first);
+  int reordered[] = { 0, 7, 2, -1 };
+  Cache::schedule_ref second = cache.get_decoding_schedule(
+    code.profile(), code.k, code.m, code.w, code.packetsize, code.bitmatrix,
+    reordered);
+  EXPECT_EQ(first.get(), second.get());
+  EXPECT_EQ(1, cache.get_decoding_schedule_cache_size(code.profile()));
+
+  // a different packetsize is a different profile
+  std::string other = Cache::profile_key("cauchy_good", code.k, code.m,
+					 code.w, 2 * code.packetsize);
+  Cache::schedule_ref third = cache.get_decoding_schedule(
+    other, code.k, code.m, code.w, 2 * code.packetsize, code.bitmatrix,
+    reordered);
+  EXPECT_NE(first.get(), third.get());
+  EXPECT_EQ(1, cache.get_decoding_schedule_cache_size(other));
+}
+
+TEST(ErasureCodeJerasureScheduleCache, eviction)
+{
+  code_t code(8, 4, 4, 8);
+  Cache cache;
+  const int length = Cache::decoding_schedules_lru_length;
+  // every pattern of one and two erasures, then three until the cache
+  // is one past full
+  std::vector<std::vector<int> > signatures;
+  int n = code.k + code.m;
+  for (int a = 0; a < n; a++)
+    signatures.push_back({ a, -1 });
+  for (int a = 0; a < n; a++)
+    for (int b = a + 1; b < n; b++)
+      signatures.push_back({ a, b, -1 });
+  for (int a = 0; a < n; a++)
+    for (int b = a + 1; b < n; b++)
+      for (int c = b + 1; c < n; c++)
+	signatures.push_back({ a, b, c, -1 });
+  ASSERT_GT((int)signatures.size(), length);
+  signatures.resize(length + 1);
+
+  std::vector<Cache::schedule_ref> schedules;
+  for (int i = 0; i < length; i++) {
+    schedules.push_back(cache.get_decoding_schedule(
+      code.profile(), code.k, code.m, code.w, code.packetsize, code.bitmatrix,
+      &signatures[i][0]));
+    ASSERT_TRUE(schedules.back());
+  }
+  EXPECT_EQ(length,
+	    cache.get_decoding_schedule_cache_size(code.profile()));
+
+  // touching the oldest entry makes the second oldest the one to go
+  EXPECT_EQ(schedules[0].get(), cache.get_decoding_schedule(
+	      code.profile(), code.k, code.m, code.w, code.packetsize,
+	      code.bitmatrix, &signatures[0][0]).get());
+  ASSERT_TRUE(cache.get_decoding_schedule(
+		code.profile(), code.k, code.m, code.w, code.packetsize,
+		code.bitmatrix, &signatures.back()[0]));
+  EXPECT_EQ(length,
+	    cache.get_decoding_schedule_cache_size(code.profile()));
+
+  EXPECT_EQ(schedules[0].get(), cache.get_decoding_schedule(
+	      code.profile(), code.k, code.m, code.w, code.packetsize,
+	      code.bitmatrix, &signatures[0][0]).get());
+  // the evicted schedule is still held here, a new one is built
+  Cache::schedule_ref rebuilt = cache.get_decoding_schedule(
+    code.profile(), code.k, code.m, code.w, code.packetsize, code.bitmatrix,
+    &signatures[1][0]);
+  ASSERT_TRUE(rebuilt);
+  EXPECT_NE(schedules[1].get(), rebuilt.get());
+  EXPECT_EQ(length,
+	    cache.get_decoding_schedule_cache_size(code.profile()));
+}
+
@@ -0,0 +1,169 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <errno.h>
+#include <sstream>
+#include "gtest/gtest.h"
+#include "erasure-code/ErasureCode.h"
+#include "erasure-code/ErasureCodePlugin.h"
+
+// a codec that normalizes its profile the way the real plugins do,
+// by filling in the defaults
+class ErasureCodeInterning : public ErasureCode {
+public:
+  int k = 0;
+
+  int init(ErasureCodeProfile &profile, ostream *ss) override {
+    int err = to_int("k", profile, &k, "2", ss);
+    if (err)
+      return err;
+    return ErasureCode::init(profile, ss);
+  }
+  int create_ruleset(const string &name, CrushWrapper &crush,
+		     ostream *ss) const override {
+    return -EOPNOTSUPP;
+  }
+  unsigned int get_chunk_count() const override {
+    return k + 1;
+  }
+  unsigned int get_data_chunk_count() const override {
+    return k;
+  }
+  unsigned int get_chunk_size(unsigned int object_size) const override {
+    return object_size / k;
+  }
+};
+
+class ErasureCodePluginInterning : public ErasureCodePlugin {
+public:
+  int built = 0;
+
+  int factory(const std::string &directory,
+	      ErasureCodeProfile &profile,
+	      ErasureCodeInterfaceRef *erasure_code,
+	      ostream *ss) override {
+    ErasureCodeInterning *codec = new ErasureCodeInterning;
+    int r = codec->init(profile, ss);
+    if (r) {
+      delete codec;
+      return r;
+    }
+    built++;
+    erasure_code->reset(codec);
+    return 0;
+  }
+};
+
+static const char *plugin_name = "interning";
+
+// registered directly rather than loaded: there is no library to close
+static ErasureCodePluginInterning *get_plugin()
+{
+  ErasureCodePluginRegistry &instance = ErasureCodePluginRegistry::instance();
+  Mutex::Locker l(instance.lock);
+  ErasureCodePlugin *plugin = instance.get(plugin_name);
+  if (!plugin) {
+    instance.disable_dlclose = true;
+    plugin = new ErasureCodePluginInterning;
+    EXPECT_EQ(0, instance.add(plugin_name, plugin));
+  }
+  return static_cast<ErasureCodePluginInterning*>(plugin);
+}
+
+static bool has_codec(const ErasureCodeProfile &profile)
+{
+  ErasureCodePluginRegistry &instance = ErasureCodePluginRegistry::instance();
+  Mutex::Locker l(instance.lock);
+  return instance.codecs.count(
+    ErasureCodePluginRegistry::codec_key(plugin_name, profile));
+}
+
+TEST(ErasureCodePlugin, same_profile)
+{
+  ErasureCodePluginInterning *plugin = get_plugin();
+  ErasureCodePluginRegistry &instance = ErasureCodePluginRegistry::instance();
+  int built = plugin->built;
+  ostringstream ss;
+  ErasureCodeProfile profile;
+  profile["k"] = "3";
+  ErasureCodeInterfaceRef first;
+  ASSERT_EQ(0, instance.factory(plugin_name, "", profile, &first, &ss));
+  ErasureCodeProfile again;
+  again["k"] = "3";
+  ErasureCodeInterfaceRef second;
+  ASSERT_EQ(0, instance.factory(plugin_name, "", again, &second, &ss));
+  EXPECT_EQ(first.get(), second.get());
+  EXPECT_EQ(built + 1, plugin->built);
+
+  ErasureCodeProfile other;
+  other["k"] = "4";
+  ErasureCodeInterfaceRef third;
+  ASSERT_EQ(0, instance.factory(plugin_name, "", other, &third, &ss));
+  EXPECT_NE(first.get(), third.get());
+  EXPECT_EQ(built + 2, plugin->built);
+}
+
+TEST(ErasureCodePlugin, normalized_profile)
+{
+  ErasureCodePluginInterning *plugin = get_plugin();
+  ErasureCodePluginRegistry &instance = ErasureCodePluginRegistry::instance();
+  int built = plugin->built;
+  ostringstream ss;
+  ErasureCodeProfile requested;
+  ErasureCodeInterfaceRef first;
+  ASSERT_EQ(0, instance.factory(plugin_name, "", requested, &first, &ss));
+  // the profile is normalized in place, both keys lead to the codec
+  ErasureCodeProfile normalized;
+  normalized["k"] = "2";
+  EXPECT_EQ(normalized, requested);
+  EXPECT_TRUE(has_codec(ErasureCodeProfile()));
+  EXPECT_TRUE(has_codec(normalized));
+
+  ErasureCodeInterfaceRef second;
+  ASSERT_EQ(0, instance.factory(plugin_name, "", normalized, &second, &ss));
+  EXPECT_EQ(first.get(), second.get());
+  ErasureCodeProfile empty;
+  ErasureCodeInterfaceRef third;
+  ASSERT_EQ(0, instance.factory(plugin_name, "", empty, &third, &ss));
+  EXPECT_EQ(first.get(), third.get());
+  EXPECT_EQ(normalized, empty);
+  EXPECT_EQ(built + 1, plugin->built);
+}
+
+TEST(ErasureCodePlugin, expired)
+{
+  ErasureCodePluginInterning *plugin = get_plugin();
+  ErasureCodePluginRegistry &instance = ErasureCodePluginRegistry::instance();
+  ostringstream ss;
+  ErasureCodeProfile profile;
+  profile["k"] = "5";
+  ErasureCodeInterfaceRef codec;
+  ASSERT_EQ(0, instance.factory(plugin_name, "", profile, &codec, &ss));
+  codec.reset();
+  ASSERT_TRUE(has_codec(profile));
+
+  // the last user went away, the next caller gets a new codec
+  int built = plugin->built;
+  ASSERT_EQ(0, instance.factory(plugin_name, "", profile, &codec, &ss));
+  EXPECT_EQ(built + 1, plugin->built);
+  ASSERT_TRUE(codec);
+  EXPECT_EQ(5u, codec->get_data_chunk_count());
+
+  // and building another codec forgets the ones nobody uses
+  codec.reset();
+  ErasureCodeProfile other;
+  other["k"] = "6";
+  ErasureCodeInterfaceRef kept;
+  ASSERT_EQ(0, instance.factory(plugin_name, "", other, &kept, &ss));
+  EXPECT_FALSE(has_codec(profile));
+  EXPECT_TRUE(has_codec(other));
+}
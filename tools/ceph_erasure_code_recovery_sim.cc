@@ -0,0 +1,627 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Offline evaluation of symbol recovery for an erasure code profile.
+ *
+ * Loads the profile through the plugin registry, then for every single
+ * failure (and with --failures 2 every pair of failures) runs each
+ * planner and reports the symbols read, the most read from one helper,
+ * the plan search time, the XORs needed per packet row and the decode
+ * throughput on random data.  The output is a Formatter dump, json by
+ * default, so runs over many profiles can be charted.
+ *
+ * --workload recovery benchmarks the hybrid decoding path instead: for
+ * one erased data shard it times the plan build, the cached plan lookup
+ * and copy, the symbol extraction, decode_chunks_for_xor and
+ * ECUtil::decode_for_xor over an object of --size bytes cut in stripes
+ * of --stripe-width bytes.  With the sa planner, the default, the plan
+ * is built by ECBackend::compute_symbol_recovery_plan as on an OSD.
+ *
+ *   ceph_erasure_code_recovery_sim --plugin jerasure \
+ *     --parameter technique=cauchy_good --parameter k=6 --parameter m=3 \
+ *     --parameter w=8 --parameter packetsize=2048 --failures 2
+ */
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/program_options/option.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <boost/program_options/cmdline.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include "global/global_context.h"
+#include "global/global_init.h"
+#include "common/ceph_argparse.h"
+#include "common/config.h"
+#include "common/Clock.h"
+#include "common/Formatter.h"
+#include "include/utime.h"
+#include "erasure-code/ErasureCode.h"
+#include "erasure-code/ErasureCodePlugin.h"
+#include "osd/ECBackend.h"
+#include "osd/ECUtil.h"
+#include "osd/ECRecoveryPlanner.h"
+
+namespace po = boost::program_options;
+
+class ErasureCodeRecoverySim {
+  boost::intrusive_ptr<CephContext> cct;
+  ErasureCodeProfile profile;
+  ErasureCodeInterfaceRef erasure_code;
+  ErasureCodeCapabilities caps;
+  string plugin;
+  unsigned size = 0;
+  int iterations = 0;
+  int failures = 1;
+  string workload;
+  int erased = 0;
+  unsigned stripe_width = 0;
+  vector<string> planners;
+  bool verbose = false;
+  boost::scoped_ptr<Formatter> f;
+
+  int k = 0;
+  int m = 0;
+  map<int, bufferlist> encoded;
+
+  struct plan_t {
+    vector<int> selection;
+    map<int, vector<int> > solution;
+    ECUtil::xor_aggregation_plan_t xor_plan;
+  };
+
+public:
+  int setup(int argc, char** argv);
+  int run();
+
+private:
+  int run_recovery();
+  void dump_stage(const char *stage, utime_t elapsed, uint64_t bytes);
+  void open_case(int failed, int other, const string &planner);
+  void plan(const string &planner, int failed, plan_t *p, utime_t *took);
+  void dump_plan(int failed, const plan_t &p);
+  void dump_conventional();
+  double decode(int failed, const plan_t &p);
+  double decode_aggregated(int failed, const plan_t &p);
+  void gather(int shard, uint64_t mask, bufferlist *out);
+};
+
+int ErasureCodeRecoverySim::setup(int argc, char** argv) {
+
+  po::options_description desc("Allowed options");
+  desc.add_options()
+    ("help,h", "produce help message")
+    ("verbose,v", "explain what happens")
+    ("size,s", po::value<int>()->default_value(1024 * 1024),
+     "size of the synthetic object decoded")
+    ("iterations,i", po::value<int>()->default_value(10),
+     "number of decodes timed per plan")
+    ("plugin,p", po::value<string>()->default_value("jerasure"),
+     "erasure code plugin name")
+    ("parameter,P", po::value<vector<string> >(),
+     "add a parameter to the erasure code profile")
+    ("failures,f", po::value<int>()->default_value(1),
+     "1 for every single failure, 2 for every pair as well")
+    ("planner", po::value<vector<string> >(),
+     "sa or climb, may be repeated (default: sa then climb)")
+    ("format", po::value<string>()->default_value("json-pretty"),
+     "output format")
+    ("workload,w", po::value<string>()->default_value("sim"),
+     "sim evaluates plans, recovery benchmarks the decoding path")
+    ("erased,e", po::value<int>()->default_value(0),
+     "data shard erased by the recovery workload")
+    ("stripe-width", po::value<int>()->default_value(0),
+     "stripe width of the recovery workload (default: --size)")
+    ;
+
+  po::variables_map vm;
+  po::parsed_options parsed =
+    po::command_line_parser(argc, argv).options(desc).allow_unregistered().run();
+  po::store(
+    parsed,
+    vm);
+  po::notify(vm);
+
+  vector<const char *> ceph_options, def_args;
+  vector<string> ceph_option_strings = po::collect_unrecognized(
+    parsed.options, po::include_positional);
+  ceph_options.reserve(ceph_option_strings.size());
+  for (vector<string>::iterator i = ceph_option_strings.begin();
+       i != ceph_option_strings.end();
+       ++i) {
+    ceph_options.push_back(i->c_str());
+  }
+
+  cct = global_init(
+    &def_args, ceph_options, CEPH_ENTITY_TYPE_CLIENT,
+    CODE_ENVIRONMENT_UTILITY,
+    CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+  common_init_finish(g_ceph_context);
+  g_ceph_context->_conf->apply_changes(NULL);
+
+  if (vm.count("help")) {
+    cout << desc << std::endl;
+    return 1;
+  }
+
+  if (vm.count("parameter")) {
+    const vector<string> &p = vm["parameter"].as< vector<string> >();
+    for (vector<string>::const_iterator i = p.begin();
+	 i != p.end();
+	 ++i) {
+      std::vector<std::string> strs;
+      boost::split(strs, *i, boost::is_any_of("="));
+      if (strs.size() != 2) {
+	cerr << "--parameter " << *i
+	     << " ignored because it does not contain exactly one =" << endl;
+      } else {
+	profile[strs[0]] = strs[1];
+      }
+    }
+  }
+
+  if (vm.count("planner"))
+    planners = vm["planner"].as< vector<string> >();
+  else
+    planners = { "sa", "climb" };
+  for (auto &p : planners) {
+    if (p != "sa" && p != "climb") {
+      cerr << "unknown planner " << p << ", expected sa or climb" << endl;
+      return -EINVAL;
+    }
+  }
+
+  size = vm["size"].as<int>();
+  iterations = vm["iterations"].as<int>();
+  failures = vm["failures"].as<int>();
+  plugin = vm["plugin"].as<string>();
+  workload = vm["workload"].as<string>();
+  erased = vm["erased"].as<int>();
+  stripe_width = vm["stripe-width"].as<int>();
+  if (workload != "sim" && workload != "recovery") {
+    cerr << "unknown workload " << workload << ", expected sim or recovery"
+	 << endl;
+    return -EINVAL;
+  }
+  verbose = vm.count("verbose") > 0 ? true : false;
+  if (failures < 1 || failures > 2) {
+    cerr << "--failures must be 1 or 2" << endl;
+    return -EINVAL;
+  }
+  f.reset(Formatter::create(vm["format"].as<string>(), "json-pretty",
+			    "json-pretty"));
+  return 0;
+}
+
+int ErasureCodeRecoverySim::run() {
+  ErasureCodePluginRegistry &instance = ErasureCodePluginRegistry::instance();
+  instance.disable_dlclose = true;
+  stringstream messages;
+  int code = instance.factory(plugin,
+			      g_conf->get_val<std::string>("erasure_code_dir"),
+			      profile, &erasure_code, &messages);
+  if (code) {
+    cerr << messages.str() << endl;
+    return code;
+  }
+  caps = erasure_code->get_capabilities();
+  if (!caps.symbol_recovery) {
+    cerr << "profile " << profile << " does not support symbol recovery"
+	 << endl;
+    return -ENOTSUP;
+  }
+  k = erasure_code->get_data_chunk_count();
+  m = erasure_code->get_coding_chunk_count();
+  if (workload == "recovery")
+    return run_recovery();
+  int w = caps.w;
+
+  // random object, encoded once and decoded from symbols for every plan
+  unsigned chunk_size = erasure_code->get_chunk_size(size);
+  bufferptr bp(buffer::create_page_aligned(chunk_size * k));
+  for (unsigned i = 0; i < bp.length(); ++i)
+    bp[i] = rand();
+  bufferlist in;
+  in.append(bp);
+  set<int> want_to_encode;
+  for (int i = 0; i < k + m; ++i)
+    want_to_encode.insert(i);
+  code = erasure_code->encode(want_to_encode, in, &encoded);
+  if (code)
+    return code;
+  if (chunk_size % (w * caps.packetsize)) {
+    cerr << "chunk size " << chunk_size << " is not a multiple of w * packetsize"
+	 << endl;
+    return -EINVAL;
+  }
+
+  f->open_object_section("recovery_sim");
+  f->dump_string("plugin", plugin);
+  f->dump_stream("profile") << profile;
+  f->dump_int("k", k);
+  f->dump_int("m", m);
+  f->dump_int("w", w);
+  f->dump_int("packetsize", caps.packetsize);
+  f->dump_unsigned("chunk_size", chunk_size);
+  f->dump_int("iterations", iterations);
+  // (failed, -1) for single failures, (failed, other) for pairs
+  vector<pair<int, int> > cases;
+  for (int failed = 0; failed < k + m; ++failed) {
+    cases.push_back(make_pair(failed, -1));
+    for (int other = failed + 1; failures > 1 && other < k + m; ++other)
+      cases.push_back(make_pair(failed, other));
+  }
+
+  f->open_array_section("cases");
+  for (auto &&c : cases) {
+    int failed = c.first;
+    int other = c.second;
+    if (failed >= k || (other >= 0 && other < k)) {
+      // no symbol plan rebuilds a coding shard or two data shards
+      open_case(failed, other, "conventional");
+      dump_conventional();
+      f->close_section();
+      continue;
+    }
+    for (auto &planner : planners) {
+      plan_t p;
+      utime_t took;
+      plan(planner, failed, &p, &took);
+      string name = planner;
+      if (other >= 0) {
+	// the second failure is a coding shard the plan must avoid
+	utime_t start = ceph_clock_now();
+	vector<int> selection;
+	set<int> excluded = { other };
+	if (!ECUtil::replan_parity_group_selection(
+	      k, m, w, caps.bitmatrix, failed, excluded,
+	      p.selection.data(), &selection)) {
+	  if (verbose)
+	    cerr << "no replan of " << failed << " without " << other << endl;
+	  continue;
+	}
+	took += ceph_clock_now() - start;
+	p = plan_t();
+	p.selection.swap(selection);
+	ECRecoveryPlanner::get_recovery_solution(
+	  k, m, w, failed, caps.bitmatrix, p.selection.data(), p.solution);
+	ECUtil::build_xor_aggregation_plan(
+	  k, m, w, caps.bitmatrix, failed, p.selection.data(), &p.xor_plan);
+	name += "+replan";
+      }
+      open_case(failed, other, name);
+      f->dump_float("plan_time_us", (double)took * 1000000.0);
+      dump_plan(failed, p);
+      f->close_section();
+      if (verbose)
+	cerr << "planned " << name << " for shard " << failed << endl;
+    }
+  }
+  f->close_section();
+  f->close_section();
+  f->flush(cout);
+  cout << std::endl;
+  return 0;
+}
+
+int ErasureCodeRecoverySim::run_recovery()
+{
+  int w = caps.w;
+  if (erased < 0 || erased >= k) {
+    cerr << "--erased " << erased << " is not a data shard" << endl;
+    return -EINVAL;
+  }
+  unsigned chunk_size = erasure_code->get_chunk_size(
+    stripe_width ? stripe_width : size);
+  if (stripe_width && chunk_size * k != stripe_width) {
+    cerr << "--stripe-width " << stripe_width << " is not k * "
+	 << chunk_size << endl;
+    return -EINVAL;
+  }
+  if (chunk_size % (w * caps.packetsize)) {
+    cerr << "chunk size " << chunk_size << " is not a multiple of w * packetsize"
+	 << endl;
+    return -EINVAL;
+  }
+  ECUtil::stripe_info_t sinfo(k, chunk_size * k);
+  uint64_t object_size = sinfo.logical_to_next_stripe_offset(size);
+  bufferptr bp(buffer::create_page_aligned(object_size));
+  for (unsigned i = 0; i < bp.length(); ++i)
+    bp[i] = rand();
+  bufferlist in;
+  in.append(bp);
+  set<int> want_to_encode;
+  for (int i = 0; i < k + m; ++i)
+    want_to_encode.insert(i);
+  ECUtil::encode(sinfo, erasure_code, in, want_to_encode, &encoded);
+
+  f->open_object_section("recovery_benchmark");
+  f->dump_string("plugin", plugin);
+  f->dump_stream("profile") << profile;
+  f->dump_string("planner", planners.front());
+  f->dump_int("erased", erased);
+  f->dump_unsigned("object_size", object_size);
+  f->dump_unsigned("stripe_width", sinfo.get_stripe_width());
+  f->dump_int("iterations", iterations);
+  f->open_array_section("stages");
+
+  // the whole plan, as the planner thread builds it once per shard
+  ECBackend::SymbolRecoveryPlan built;
+  utime_t begin = ceph_clock_now();
+  if (planners.front() == "sa") {
+    ECBackend::compute_symbol_recovery_plan(erasure_code, erased, &built);
+  } else {
+    plan_t climbed;
+    utime_t search;
+    plan(planners.front(), erased, &climbed, &search);
+    built.failed = erased;
+    built.parity_group_selection.swap(climbed.selection);
+    built.solution.swap(climbed.solution);
+    built.xor_plan = climbed.xor_plan;
+  }
+  dump_stage("plan_build", ceph_clock_now() - begin, 0);
+
+  plan_t p;
+  p.selection.swap(built.parity_group_selection);
+  p.solution.swap(built.solution);
+  p.xor_plan = built.xor_plan;
+
+  map<int, bufferlist> to_decode;
+  uint64_t gathered = 0;
+  begin = ceph_clock_now();
+  for (int i = 0; i < iterations; ++i) {
+    to_decode.clear();
+    for (auto &&s : p.solution) {
+      uint64_t mask = 0;
+      for (auto symbol : s.second)
+	mask |= 1ull << symbol;
+      gather(s.first, mask, &to_decode[s.first]);
+    }
+  }
+  for (auto &&s : to_decode)
+    gathered += s.second.length();
+  dump_stage("extract", ceph_clock_now() - begin, gathered * iterations);
+
+  // the plugin call alone, on the first stripe, set up as
+  // ErasureCode::decode_for_xor does
+  map<int, bufferlist> chunks;
+  for (auto &&s : to_decode)
+    chunks[s.first].substr_of(s.second, 0,
+			      chunk_size * p.solution[s.first].size() / w);
+  map<int, bufferlist> decoded;
+  for (int i = 0; i < k + m; ++i) {
+    if (chunks.count(i)) {
+      decoded[i] = chunks[i];
+      decoded[i].rebuild_aligned(ErasureCode::SIMD_ALIGN);
+    } else {
+      bufferptr ptr(buffer::create_aligned(chunk_size, ErasureCode::SIMD_ALIGN));
+      decoded[i].push_front(ptr);
+    }
+  }
+  set<int> want = { erased };
+  begin = ceph_clock_now();
+  for (int i = 0; i < iterations; ++i)
+    erasure_code->decode_chunks_for_xor(want, chunks, &decoded, chunk_size,
+					caps.packetsize, w, p.solution,
+					p.selection.data());
+  dump_stage("decode_chunks_for_xor", ceph_clock_now() - begin,
+	     (uint64_t)chunk_size * iterations);
+  bufferlist first;
+  first.substr_of(encoded[erased], 0, chunk_size);
+  if (!decoded[erased].contents_equal(first)) {
+    cerr << "decode_chunks_for_xor rebuilt shard " << erased << " wrong" << endl;
+    return -EIO;
+  }
+
+  begin = ceph_clock_now();
+  for (int i = 0; i < iterations; ++i) {
+    bufferlist out;
+    map<int, bufferlist*> target = { { erased, &out } };
+    ECUtil::decode_for_xor(sinfo, erasure_code, to_decode, target, p.solution,
+			   w, caps.packetsize, p.selection.data());
+    if (i == 0 && !out.contents_equal(encoded[erased])) {
+      cerr << "decode_for_xor rebuilt shard " << erased << " wrong" << endl;
+      return -EIO;
+    }
+  }
+  dump_stage("decode_for_xor", ceph_clock_now() - begin,
+	     encoded[erased].length() * iterations);
+
+  f->close_section();
+  f->close_section();
+  f->flush(cout);
+  cout << std::endl;
+  return 0;
+}
+
+void ErasureCodeRecoverySim::dump_stage(
+  const char *stage, utime_t elapsed, uint64_t bytes)
+{
+  f->open_object_section("stage");
+  f->dump_string("stage", stage);
+  f->dump_float("seconds", (double)elapsed);
+  f->dump_unsigned("bytes", bytes);
+  if (bytes && (double)elapsed > 0)
+    f->dump_float("mbps", bytes / (double)elapsed / 1000000.0);
+  f->close_section();
+}
+
+void ErasureCodeRecoverySim::open_case(
+  int failed, int other, const string &planner)
+{
+  f->open_object_section("case");
+  f->open_array_section("failed");
+  f->dump_int("shard", failed);
+  if (other >= 0)
+    f->dump_int("shard", other);
+  f->close_section();
+  f->dump_string("planner", planner);
+}
+
+void ErasureCodeRecoverySim::plan(
+  const string &planner, int failed, plan_t *p, utime_t *took)
+{
+  int w = caps.w;
+  utime_t start = ceph_clock_now();
+  ECRecoveryPlanner search;
+  int *selection = planner == "sa" ?
+    search.sa_crs_hybrid_recovery_solution(k, m, w, failed, caps.bitmatrix) :
+    search.crs_hybrid_recovery_solution(k, m, w, failed, caps.bitmatrix);
+  *took = ceph_clock_now() - start;
+  p->selection.assign(selection, selection + m * w);
+  delete[] selection;
+  ECRecoveryPlanner::get_recovery_solution(
+    k, m, w, failed, caps.bitmatrix, p->selection.data(), p->solution);
+  ECUtil::build_xor_aggregation_plan(
+    k, m, w, caps.bitmatrix, failed, p->selection.data(), &p->xor_plan);
+}
+
+void ErasureCodeRecoverySim::dump_conventional()
+{
+  int w = caps.w;
+  f->dump_int("symbols_read", k * w);
+  f->dump_int("symbols_full", k * w);
+  f->dump_int("max_helper_symbols", w);
+  f->dump_int("helpers", k);
+}
+
+void ErasureCodeRecoverySim::dump_plan(int failed, const plan_t &p)
+{
+  int w = caps.w;
+  // symbols per packet row, against k * w for whole chunks
+  unsigned read = 0, max_helper = 0;
+  for (auto &&i : p.solution) {
+    read += i.second.size();
+    max_helper = MAX(max_helper, i.second.size());
+  }
+  f->dump_unsigned("symbols_read", read);
+  f->dump_int("symbols_full", k * w);
+  f->dump_unsigned("max_helper_symbols", max_helper);
+  f->dump_unsigned("helpers", p.solution.size());
+
+  // per packet row: each equation XORs its surviving symbols into the
+  // parity, then every failed symbol sums the equations of its inverse row
+  unsigned xors = 0;
+  for (int row = 0; row < m * w; ++row) {
+    if (!p.selection[row])
+      continue;
+    for (int c = 0; c < k * w; ++c) {
+      if (c / w != failed && caps.bitmatrix[row * k * w + c])
+	++xors;
+    }
+  }
+  for (auto inv : p.xor_plan.inverse)
+    xors += __builtin_popcountll(inv) - 1;
+  f->dump_unsigned("xors_per_row", xors);
+  f->dump_float("decode_mbps", decode(failed, p));
+
+  f->dump_bool("aggregation", !p.xor_plan.empty());
+  if (!p.xor_plan.empty()) {
+    unsigned packets = 0, max_packets = 0;
+    for (auto &&i : p.xor_plan.shards) {
+      packets += i.second.packets_per_row();
+      max_packets = MAX(max_packets, i.second.packets_per_row());
+    }
+    f->dump_unsigned("aggregated_packets", packets);
+    f->dump_unsigned("max_helper_packets", max_packets);
+    f->dump_float("decode_aggregated_mbps", decode_aggregated(failed, p));
+  }
+}
+
+void ErasureCodeRecoverySim::gather(int shard, uint64_t mask, bufferlist *out)
+{
+  unsigned row_size = caps.w * caps.packetsize;
+  const bufferlist &chunk = encoded[shard];
+  for (unsigned row = 0; row < chunk.length(); row += row_size) {
+    for (unsigned s = 0; s < caps.w; ++s) {
+      if (mask & (1ull << s)) {
+	bufferlist packet;
+	packet.substr_of(chunk, row + s * caps.packetsize, caps.packetsize);
+	out->claim_append(packet);
+      }
+    }
+  }
+  out->rebuild();
+}
+
+double ErasureCodeRecoverySim::decode(int failed, const plan_t &p)
+{
+  int w = caps.w;
+  unsigned chunk_size = encoded[0].length();
+  ECUtil::stripe_info_t sinfo(k, chunk_size * k);
+  map<int, bufferlist> to_decode;
+  for (auto &&i : p.solution) {
+    uint64_t mask = 0;
+    for (auto s : i.second)
+      mask |= 1ull << s;
+    gather(i.first, mask, &to_decode[i.first]);
+  }
+
+  utime_t start = ceph_clock_now();
+  for (int i = 0; i < iterations; ++i) {
+    bufferlist out;
+    map<int, bufferlist*> target = { { failed, &out } };
+    ECUtil::decode_for_xor(sinfo, erasure_code, to_decode, target, p.solution,
+			   w, caps.packetsize,
+			   const_cast<int*>(p.selection.data()));
+    if (i == 0 && !out.contents_equal(encoded[failed])) {
+      cerr << "decode of shard " << failed << " from symbols is wrong" << endl;
+      return 0;
+    }
+  }
+  double elapsed = ceph_clock_now() - start;
+  return elapsed > 0 ? (double)chunk_size * iterations / elapsed / 1000000.0 : 0;
+}
+
+double ErasureCodeRecoverySim::decode_aggregated(int failed, const plan_t &p)
+{
+  unsigned chunk_size = encoded[0].length();
+  // helpers combine before shipping, that is not timed here
+  map<int, bufferlist> to_decode;
+  for (auto &&i : p.xor_plan.shards) {
+    bufferlist raw;
+    gather(i.first, i.second.mask, &raw);
+    if (i.second.aggregated)
+      ECUtil::xor_combine(raw, i.second.mask, i.second.combinations,
+			  caps.packetsize, &to_decode[i.first]);
+    else
+      to_decode[i.first].claim(raw);
+  }
+
+  utime_t start = ceph_clock_now();
+  for (int i = 0; i < iterations; ++i) {
+    bufferlist out;
+    ECUtil::decode_xor_aggregation(p.xor_plan, caps.w, caps.packetsize,
+				   to_decode, &out);
+    if (i == 0 && !out.contents_equal(encoded[failed])) {
+      cerr << "aggregated decode of shard " << failed << " is wrong" << endl;
+      return 0;
+    }
+  }
+  double elapsed = ceph_clock_now() - start;
+  return elapsed > 0 ? (double)chunk_size * iterations / elapsed / 1000000.0 : 0;
+}
+
+int main(int argc, char** argv) {
+  ErasureCodeRecoverySim sim;
+  try {
+    int err = sim.setup(argc, argv);
+    if (err)
+      return err;
+    return sim.run();
+  } catch(po::error &e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+}